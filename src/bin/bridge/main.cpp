@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <chrono>
 #include <atomic>
 #include <csignal>
@@ -11,6 +12,8 @@
 #include <bluetooth/profile_manager.h>
 #include <bluetooth/bluetooth_manager.h>
 #include <bluetooth/rfcomm/server.h>
+#include <bluetooth/rfcomm/transport.h>
+#include <utils/buffer_pool.h>
 #include <bluetooth/rfcomm/client.h>
 
 #include <utils/config.h>
@@ -44,10 +47,56 @@ int main(int argc, char* argv[])
 		// MQTT 发布时间间隔
 		int publishInterval = config.getInt("bluetooth.publish_interval_ms", 1000);
 
+		// 设备发现调度参数
+		DiscoveryScheduler::Options discoveryOptions;
+		discoveryOptions.scanWindowMs = config.getInt("bluetooth.discovery.scan_window_ms", 10000);
+		discoveryOptions.scanIntervalMs =
+			config.getInt("bluetooth.discovery.scan_interval_ms", 30000);
+		discoveryOptions.pauseDuringConnect =
+			config.getBool("bluetooth.discovery.pause_during_connect", true);
+		discoveryOptions.pauseWhileTransferring =
+			config.getBool("bluetooth.discovery.pause_while_transferring", true);
+		discoveryOptions.transferIdleMs =
+			config.getInt("bluetooth.discovery.transfer_idle_ms", 2000);
+		discoveryOptions.onDemandOnly = config.getBool("bluetooth.discovery.on_demand_only", false);
+
+		// BLE 广播数据批量发布
+		bool beaconEnabled = config.getBool("bluetooth.beacon.enabled", false);
+		int beaconInterval = config.getInt("bluetooth.beacon.publish_interval_ms", 1000);
+		int beaconTtl = config.getInt("bluetooth.beacon.ttl_ms", 10000);
+
+		// D-Bus 总线地址，为空时使用系统总线(可指向运行模拟 BlueZ 的私有总线)
+		std::string dbusAddress = config.getString("bluetooth.dbus_address", "");
+
 		// RFCOMM通信相关参数
 		int srvAcceptTimeout = config.getInt("bluetooth.server.socket_accpet_timeout_ms", 1000);
 		int srvRecvTimeout = config.getInt("bluetooth.server.socket_recv_timeout_ms", 1000);
 		int srvBufferSize = config.getInt("bluetooth.server.socket_buffer_size", 1024);
+		int srvChannel = config.getInt("bluetooth.server.channel", 0);
+		std::string srvMode = config.getString("bluetooth.server.mode", "profile");
+
+		// 串口传输层，unix/tcp 回环用于无蓝牙硬件时压测、调试
+		Transport::Options transportOptions;
+		transportOptions.type = config.getString("bluetooth.transport.type", "rfcomm");
+		transportOptions.path = config.getString("bluetooth.transport.path", "/tmp/bluetooth-bridge");
+		transportOptions.host = config.getString("bluetooth.transport.host", "127.0.0.1");
+		transportOptions.basePort = config.getInt("bluetooth.transport.base_port", 20000);
+		transportOptions.localAddress =
+			config.getString("bluetooth.transport.local_address", "02:00:00:00:00:01");
+
+		// 收发缓冲池，块大小应不小于 2 倍的 socket_buffer_size
+		int poolBlockSize = config.getInt("bluetooth.buffer_pool.block_size", 16384);
+		int poolMaxBlocks = config.getInt("bluetooth.buffer_pool.max_blocks", 1024);
+
+		// 下行合并写入，窗口内的多条 sendToDevice 合并为一次 writev
+		DownlinkWriter::Options downlinkOptions;
+		downlinkOptions.coalesce = config.getBool("bluetooth.downlink.coalesce", false);
+		downlinkOptions.maxDelay =
+			std::chrono::milliseconds(std::max(0, config.getInt("bluetooth.downlink.max_delay_ms", 2)));
+		downlinkOptions.maxBytes =
+			static_cast<size_t>(std::max(1, config.getInt("bluetooth.downlink.max_bytes", 1000)));
+		downlinkOptions.maxQueuedBytes = static_cast<size_t>(
+			std::max(1, config.getInt("bluetooth.downlink.max_queued_bytes", 256 * 1024)));
 
 		// 蓝牙配对/连接相关参数
 		int maxRepairCount = config.getInt("bluetooth.max_repair_count", 3);
@@ -55,12 +104,26 @@ int main(int argc, char* argv[])
 		int pairTimeout = config.getInt("bluetooth.timeout_pair_ms", 1000);
 		int connectTimeout = config.getInt("bluetooth.timeout_connect_ms", 1000);
 
+		// 广播更新合并/限速参数
+		AdvertisementFilter::Options advOptions;
+		advOptions.minIntervalMs = config.getInt("bluetooth.advertisement.min_interval_ms", 1000);
+		advOptions.rssiHysteresis = config.getInt("bluetooth.advertisement.rssi_hysteresis", 4);
+		advOptions.maxDeviceUpdatesPerSec =
+			config.getInt("bluetooth.advertisement.max_device_updates_per_sec", 2);
+		advOptions.maxGlobalUpdatesPerSec =
+			config.getInt("bluetooth.advertisement.max_global_updates_per_sec", 200);
+
 
 		LOG_INFO("===========启动蓝牙设备管理器===========");
 
-		auto conn_adapter = sdbus::createSystemBusConnection();
-		auto conn_devices = sdbus::createSystemBusConnection();
-		auto conn_agent = sdbus::createSystemBusConnection();
+		auto createConnection = [&dbusAddress]() {
+			return dbusAddress.empty() ? sdbus::createSystemBusConnection()
+									   : sdbus::createSessionBusConnectionWithAddress(dbusAddress);
+		};
+
+		auto conn_adapter = createConnection();
+		auto conn_devices = createConnection();
+		auto conn_agent = createConnection();
 
 		// 1. 设备发现
 		BluetoothManager bluetoothMgr(*conn_adapter, *conn_devices);
@@ -68,6 +131,10 @@ int main(int argc, char* argv[])
 		bluetoothMgr.setMaxReconnectCount(maxReconnectCount);
 		bluetoothMgr.setPairTimeout(pairTimeout);
 		bluetoothMgr.setConnectTimeout(connectTimeout);
+		bluetoothMgr.setAdvertisementOptions(advOptions);
+		bluetoothMgr.getBeaconCollector().setTtl(std::chrono::milliseconds(beaconTtl));
+		bluetoothMgr.getBeaconCollector().setEnabled(beaconEnabled);
+		bluetoothMgr.getDiscoveryScheduler().setOptions(discoveryOptions);
 
 		// 2.设备配对/连接
 		// 2.1 单独创建一个连接用于代理注册和配对处理
@@ -77,6 +144,9 @@ int main(int argc, char* argv[])
 		conn_devices->enterEventLoopAsync();
 		conn_agent->enterEventLoopAsync();
 
+		// 1.1 按扫描窗口调度设备发现
+		bluetoothMgr.getDiscoveryScheduler().start();
+
 
 		// 2.2 注册用于配对的代理
 		sdbus::ObjectPath agnet_path("/com/example/bluetooth/agent");
@@ -99,19 +169,70 @@ int main(int argc, char* argv[])
 			agent_manager.requestDefaultAgent(agnet_path);
 		}
 
-		// 3 启动RFCOMM服务器监听连接
-		BluetoothServer server("Bluetooth RFCOMM Server", 0);
+		// 3 启动RFCOMM服务器，接收缓冲区与 MQTT 发布共用缓冲池(须比服务器和MQTT代理存活更久)
+		BufferPool bufferPool(static_cast<size_t>(poolBlockSize), 32, static_cast<size_t>(poolMaxBlocks));
+		DownlinkStats downlinkStats;
+
+		BluetoothServer server("Bluetooth RFCOMM Server", static_cast<uint8_t>(srvChannel));
 		server.setBufferSize(srvBufferSize);
 		server.setAcceptTimeout(srvAcceptTimeout);
 		server.setRecvTimeout(srvRecvTimeout);
-		server.start();
+		server.setTransport(Transport::create(transportOptions));
+		server.setBufferPool(&bufferPool);
+		server.setDownlink(downlinkOptions, &downlinkStats);
+		// Profile1 仅适用于 RFCOMM，其他传输总是自行监听
+		server.setListenMode(srvMode == "listen" || std::string(server.getTransport()->name()) != "rfcomm");
 
-		// 4. 配置MQTT代理
+		// 4. 配置MQTT代理，须在接受连接前安装服务器回调，否则启动时交入的连接没有回调处理
 		MqttProxy mqtt(bluetoothMgr, server, config);
 		mqtt.setup();
 
+		server.start();
+
+		// 3.1 通过 ProfileManager1 注册SPP，连接由 BlueZ 在 NewConnection 中交入
+		sdbus::ObjectPath profile_path("/org/booway/bluetooth/profile/spp");
+		std::unique_ptr<ProfileManager> profile_manager;
+		std::unique_ptr<Profile> profile;
+
+		if (!server.isListenMode())
+		{
+			profile = std::make_unique<Profile>(*conn_agent, profile_path);
+
+			profile->setConnectionCallback([&server](const std::string& address, int fd) {
+				server.attachClient(fd, address);
+			});
+
+			profile->setDisconnectionCallback([&server](const std::string& address) {
+				int clientId = server.findClient(address);
+				if (clientId >= 0)
+					server.disconnectClient(clientId);
+			});
+
+			std::map<std::string, sdbus::Variant> options;
+			options["Name"] = sdbus::Variant(std::string("Bluetooth RFCOMM Server"));
+			options["Role"] = sdbus::Variant(std::string("server"));
+			options["RequireAuthentication"] = sdbus::Variant(false);
+			options["RequireAuthorization"] = sdbus::Variant(false);
+
+			if (srvChannel > 0)
+				options["Channel"] = sdbus::Variant(static_cast<uint16_t>(srvChannel));
+
+			try
+			{
+				profile_manager = std::make_unique<ProfileManager>(*conn_agent);
+				profile_manager->registerProfile(profile_path, BluetoothServer::SPP_UUID, options);
+				LOG_INFO("已注册SPP Profile - {}", profile_path);
+			}
+			catch (const sdbus::Error& e)
+			{
+				LOG_ERROR("注册SPP Profile失败 ({}/{})", e.getName(), e.getMessage());
+			}
+		}
+
 		std::chrono::milliseconds ellapse(0);
+		std::chrono::milliseconds beaconEllapse(0);
 		auto preTime = std::chrono::steady_clock::now();
+		std::string beaconBody;
 
 		// 主循环，等待设备发现
 		while (running)
@@ -119,9 +240,23 @@ int main(int argc, char* argv[])
 			std::this_thread::sleep_for(std::chrono::milliseconds(50));
 
 			auto curTime = std::chrono::steady_clock::now();
-			ellapse += std::chrono::duration_cast<std::chrono::milliseconds>(curTime - preTime);
+			auto delta = std::chrono::duration_cast<std::chrono::milliseconds>(curTime - preTime);
+			ellapse += delta;
+			beaconEllapse += delta;
 			preTime = curTime;
 
+			if (beaconEnabled && beaconEllapse.count() >= beaconInterval)
+			{
+				// 合并发布所有设备变化的广播数据
+				if (bluetoothMgr.getBeaconCollector().flush(beaconBody))
+				{
+					std::vector<uint8_t> payload(beaconBody.begin(), beaconBody.end());
+					mqtt.publish("/org/booway/bluetooth/beacons", payload);
+				}
+
+				beaconEllapse = std::chrono::milliseconds(0);
+			}
+
 			if (ellapse.count() >= publishInterval)
 			{
 				// MQTT 发布订阅
@@ -135,10 +270,43 @@ int main(int argc, char* argv[])
 				payload = std::vector<uint8_t>(body.begin(), body.end());
 				mqtt.publish("/org/booway/bluetooth/getDevices", payload);
 
+				// 运行统计
+				Json::Value statsJson;
+				statsJson["discovery"] = bluetoothMgr.getDiscoveryScheduler().getStats();
+				statsJson["bufferPool"] = bufferPool.getStats();
+				statsJson["downlink"] = downlinkStats.getStats();
+				statsJson["mqtt"] = mqtt.getStats();
+				body = statsJson.toStyledString();
+				payload = std::vector<uint8_t>(body.begin(), body.end());
+				mqtt.publish("/org/booway/bluetooth/getStats", payload);
+
+				// 离线下行队列状态(启用时)
+				Json::Value offlineJson = mqtt.getOfflineQueueStats();
+				if (!offlineJson.isNull())
+				{
+					body = offlineJson.toStyledString();
+					payload = std::vector<uint8_t>(body.begin(), body.end());
+					mqtt.publish("/org/booway/bluetooth/offlineQueue", payload);
+				}
+
 				ellapse = std::chrono::milliseconds(0);
 			}
 		}
 
+		bluetoothMgr.getDiscoveryScheduler().stop();
+
+		if (profile_manager)
+		{
+			try
+			{
+				profile_manager->unregisterProfile(profile_path);
+			}
+			catch (const sdbus::Error& e)
+			{
+				LOG_WARN("注销SPP Profile失败 ({}/{})", e.getName(), e.getMessage());
+			}
+		}
+
 		server.stop();
 		conn_adapter->leaveEventLoop();
 		conn_devices->leaveEventLoop();
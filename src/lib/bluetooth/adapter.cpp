@@ -0,0 +1,40 @@
+#include <bluetooth/adapter.h>
+
+const std::unordered_map<std::string_view, Adapter::PropertySetter> Adapter::_setters = {
+	{ "Address",
+	  [](Adapter& a, const sdbus::Variant& v) { a._properties.address = v.get<std::string>(); } },
+	{ "AddressType",
+	  [](Adapter& a, const sdbus::Variant& v) {
+		  a._properties.addressType = v.get<std::string>();
+	  } },
+	{ "Alias",
+	  [](Adapter& a, const sdbus::Variant& v) { a._properties.alias = v.get<std::string>(); } },
+	{ "Class",
+	  [](Adapter& a, const sdbus::Variant& v) {
+		  a._properties.classType = v.get<std::uint32_t>();
+	  } },
+	{ "Discoverable",
+	  [](Adapter& a, const sdbus::Variant& v) { a._properties.discoverable = v.get<bool>(); } },
+	{ "DiscoverableTimeout",
+	  [](Adapter& a, const sdbus::Variant& v) {
+		  a._properties.discoverableTimeout = v.get<std::uint32_t>();
+	  } },
+	{ "Discovering",
+	  [](Adapter& a, const sdbus::Variant& v) { a._properties.discovering = v.get<bool>(); } },
+	{ "Modalias",
+	  [](Adapter& a, const sdbus::Variant& v) { a._properties.modalias = v.get<std::string>(); } },
+	{ "Name",
+	  [](Adapter& a, const sdbus::Variant& v) { a._properties.name = v.get<std::string>(); } },
+	{ "Pairable",
+	  [](Adapter& a, const sdbus::Variant& v) { a._properties.pairable = v.get<bool>(); } },
+	{ "PairableTimeout",
+	  [](Adapter& a, const sdbus::Variant& v) {
+		  a._properties.pairableTimeout = v.get<std::uint32_t>();
+	  } },
+	{ "Powered",
+	  [](Adapter& a, const sdbus::Variant& v) { a._properties.powered = v.get<bool>(); } },
+	{ "UUIDs",
+	  [](Adapter& a, const sdbus::Variant& v) {
+		  a._properties.uuids = v.get<std::vector<std::string>>();
+	  } },
+};
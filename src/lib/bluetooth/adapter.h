@@ -2,6 +2,8 @@
 #define BLUETOOTH_ADAPTER_H
 
 #include <map>
+#include <string_view>
+#include <unordered_map>
 
 #include <json/json.h>
 #include <bluetooth/proxy/adapter_proxy.h>
@@ -68,67 +70,19 @@ public:
 
 
 private:
+	using PropertySetter = void (*)(Adapter&, const sdbus::Variant&);
+
+	// 属性名 -> 字段写入函数，属性变更时单次遍历查表分发
+	static const std::unordered_map<std::string_view, PropertySetter> _setters;
+
 	void onPropertiesChanged(const sdbus::InterfaceName& interfaceName,
 							 const std::map<sdbus::PropertyName, sdbus::Variant>& changedProperties,
 							 const std::vector<sdbus::PropertyName>& invalidatedProperties) override
 	{
-		if (const auto key = sdbus::MemberName("Address"); changedProperties.count(key))
-		{
-			_properties.address = changedProperties.at(key).get<std::string>();
-		}
-		if (const auto key = sdbus::MemberName("AddressType"); changedProperties.count(key))
-		{
-			_properties.addressType = changedProperties.at(key).get<std::string>();
-		}
-		if (const auto key = sdbus::MemberName("Alias"); changedProperties.count(key))
-		{
-			_properties.alias = changedProperties.at(key).get<std::string>();
-		}
-		if (const auto key = sdbus::MemberName("Class"); changedProperties.count(key))
-		{
-			_properties.classType = changedProperties.at(key).get<std::uint32_t>();
-		}
-		if (const auto key = sdbus::MemberName("Discoverable"); changedProperties.count(key))
-		{
-			_properties.discoverable = changedProperties.at(key).get<bool>();
-		}
-		if (const auto key = sdbus::MemberName("DiscoverableTimeout");
-			changedProperties.count(key))
-		{
-			_properties.discoverableTimeout = changedProperties.at(key).get<std::uint32_t>();
-		}
-		if (const auto key = sdbus::MemberName("Discovering"); changedProperties.count(key))
-		{
-			_properties.discovering = changedProperties.at(key).get<bool>();
-
-			if (!_properties.discovering)
-			{
-				this->startDiscovery();
-			}
-		}
-		if (const auto key = sdbus::MemberName("Modalias"); changedProperties.count(key))
-		{
-			_properties.modalias = changedProperties.at(key).get<std::string>();
-		}
-		if (const auto key = sdbus::MemberName("Name"); changedProperties.count(key))
-		{
-			_properties.name = changedProperties.at(key).get<std::string>();
-		}
-		if (const auto key = sdbus::MemberName("Pairable"); changedProperties.count(key))
-		{
-			_properties.pairable = changedProperties.at(key).get<bool>();
-		}
-		if (const auto key = sdbus::MemberName("PairableTimeout"); changedProperties.count(key))
-		{
-			_properties.pairableTimeout = changedProperties.at(key).get<std::uint32_t>();
-		}
-		if (const auto key = sdbus::MemberName("Powered"); changedProperties.count(key))
-		{
-			_properties.powered = changedProperties.at(key).get<bool>();
-		}
-		if (const auto key = sdbus::MemberName("UUIDs"); changedProperties.count(key))
+		for (const auto& [name, value] : changedProperties)
 		{
-			_properties.uuids = changedProperties.at(key).get<std::vector<std::string>>();
+			if (const auto it = _setters.find(name); it != _setters.end())
+				it->second(*this, value);
 		}
 	}
 
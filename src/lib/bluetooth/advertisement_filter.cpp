@@ -0,0 +1,73 @@
+#include <bluetooth/advertisement_filter.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+bool AdvertisementFilter::Bucket::take(int ratePerSec, Clock::time_point now)
+{
+	if (ratePerSec <= 0)
+		return true;
+
+	if (tokens < 0.0)
+	{
+		tokens = ratePerSec;
+		lastRefill = now;
+	}
+	else
+	{
+		std::chrono::duration<double> elapsed = now - lastRefill;
+		tokens = std::min<double>(ratePerSec, tokens + elapsed.count() * ratePerSec);
+		lastRefill = now;
+	}
+
+	if (tokens < 1.0)
+		return false;
+
+	tokens -= 1.0;
+	return true;
+}
+
+void AdvertisementFilter::setOptions(const Options& options)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_options = options;
+	_options.minIntervalMs = std::max(0, _options.minIntervalMs);
+	_options.rssiHysteresis = std::max(0, _options.rssiHysteresis);
+}
+
+AdvertisementFilter::Options AdvertisementFilter::getOptions() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _options;
+}
+
+bool AdvertisementFilter::isRssiJitter(std::int16_t current, std::int16_t incoming) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return std::abs(static_cast<int>(incoming) - static_cast<int>(current)) <=
+		   _options.rssiHysteresis;
+}
+
+bool AdvertisementFilter::admit(Budget& budget, Clock::time_point now)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (budget.lastUpdate != Clock::time_point{} &&
+		now - budget.lastUpdate < std::chrono::milliseconds(_options.minIntervalMs))
+		return false;
+
+	// 先检查设备额度再检查全局额度，设备额度不足时不消耗全局令牌
+	Bucket deviceBucket = budget.bucket;
+	if (!deviceBucket.take(_options.maxDeviceUpdatesPerSec, now))
+	{
+		budget.bucket = deviceBucket;
+		return false;
+	}
+
+	if (!_global.take(_options.maxGlobalUpdatesPerSec, now))
+		return false;
+
+	budget.bucket = deviceBucket;
+	budget.lastUpdate = now;
+	return true;
+}
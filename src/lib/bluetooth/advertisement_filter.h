@@ -0,0 +1,59 @@
+#ifndef BLUETOOTH_ADVERTISEMENT_FILTER_H_
+#define BLUETOOTH_ADVERTISEMENT_FILTER_H_
+
+#include <defines.h>
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+// 广播更新(RSSI/ManufacturerData/ServiceData)合并与限速
+// 设备持有各自的 Budget，过滤器本身只保存配置和全局令牌桶
+class CORE_API AdvertisementFilter
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	struct Options
+	{
+		int minIntervalMs = 1000;			// 同一设备两次可见变更的最小间隔
+		int rssiHysteresis = 4;				// RSSI 变化不超过该值视为抖动
+		int maxDeviceUpdatesPerSec = 2;		// 单设备每秒可见变更上限，0 表示不限制
+		int maxGlobalUpdatesPerSec = 200;	// 全部设备每秒可见变更上限，0 表示不限制
+	};
+
+	// 令牌桶
+	struct Bucket
+	{
+		double tokens = -1.0; // 小于0表示尚未初始化
+		Clock::time_point lastRefill{};
+
+		bool take(int ratePerSec, Clock::time_point now);
+	};
+
+	// 单个设备的限速状态
+	struct Budget
+	{
+		Clock::time_point lastUpdate{};
+		Bucket bucket;
+	};
+
+	AdvertisementFilter() = default;
+
+	void setOptions(const Options& options);
+
+	Options getOptions() const;
+
+	// 判断新的 RSSI 是否落在滞回区间内
+	bool isRssiJitter(std::int16_t current, std::int16_t incoming) const;
+
+	// 判断设备此刻是否允许产生一次可见变更，允许时扣除设备和全局额度
+	bool admit(Budget& budget, Clock::time_point now);
+
+private:
+	mutable std::mutex _mutex;
+	Options _options;
+	Bucket _global;
+};
+
+#endif // BLUETOOTH_ADVERTISEMENT_FILTER_H_
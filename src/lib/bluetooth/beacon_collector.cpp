@@ -0,0 +1,216 @@
+#include <bluetooth/beacon_collector.h>
+#include <utils/base64.h>
+
+#include <chrono>
+
+namespace {
+
+	// 比较 D-Bus 字节数组与已保存的负载，不同则覆盖，返回是否发生变化
+	template <typename Key>
+	bool assignPayloads(std::map<Key, std::vector<std::uint8_t>>& stored,
+						const std::map<Key, sdbus::Variant>& data)
+	{
+		bool changed = stored.size() != data.size();
+
+		for (const auto& [key, value] : data)
+		{
+			auto bytes = value.template get<std::vector<std::uint8_t>>();
+			auto it = stored.find(key);
+
+			if (it == stored.end())
+			{
+				stored.emplace(key, std::move(bytes));
+				changed = true;
+			}
+			else if (it->second != bytes)
+			{
+				it->second = std::move(bytes);
+				changed = true;
+			}
+		}
+
+		if (changed)
+		{
+			// 移除本次未出现的键
+			for (auto it = stored.begin(); it != stored.end();)
+			{
+				if (!data.count(it->first))
+					it = stored.erase(it);
+				else
+					++it;
+			}
+		}
+
+		return changed;
+	}
+
+	void appendBase64(std::string& body, const std::vector<std::uint8_t>& bytes)
+	{
+		body += '"';
+		body += base64_encode(bytes.data(), bytes.size());
+		body += '"';
+	}
+}
+
+void BeaconCollector::setTtl(std::chrono::milliseconds ttl)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_ttl = ttl;
+}
+
+size_t BeaconCollector::getEntryCount() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _entries.size();
+}
+
+void BeaconCollector::markDirty(const std::string& address, Entry& entry)
+{
+	if (!entry.dirty)
+	{
+		entry.dirty = true;
+		_dirty.push_back(address);
+	}
+}
+
+void BeaconCollector::onManufacturerData(const std::string& address,
+										 const std::map<std::uint16_t, sdbus::Variant>& data)
+{
+	if (!_enabled || address.empty())
+		return;
+
+	++_received;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto& entry = _entries[address];
+	entry.lastSeen = Clock::now();
+
+	if (assignPayloads(entry.manufacturerData, data))
+		markDirty(address, entry);
+	else
+		++_duplicates;
+}
+
+void BeaconCollector::onServiceData(const std::string& address,
+									const std::map<std::string, sdbus::Variant>& data)
+{
+	if (!_enabled || address.empty())
+		return;
+
+	++_received;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto& entry = _entries[address];
+	entry.lastSeen = Clock::now();
+
+	if (assignPayloads(entry.serviceData, data))
+		markDirty(address, entry);
+	else
+		++_duplicates;
+}
+
+void BeaconCollector::onRssi(const std::string& address, std::int16_t rssi)
+{
+	if (!_enabled || address.empty())
+		return;
+
+	// RSSI 只随负载一起上报，不单独触发发布
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto it = _entries.find(address);
+	if (it != _entries.end())
+	{
+		it->second.rssi = rssi;
+		it->second.lastSeen = Clock::now();
+	}
+}
+
+void BeaconCollector::prune(Clock::time_point now)
+{
+	if (_ttl.count() <= 0)
+		return;
+
+	// 待发布的设备刚收到过广播，不会在这里被移除
+	for (auto it = _entries.begin(); it != _entries.end();)
+	{
+		if (!it->second.dirty && now - it->second.lastSeen > _ttl)
+			it = _entries.erase(it);
+		else
+			++it;
+	}
+}
+
+bool BeaconCollector::flush(std::string& body)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	prune(Clock::now());
+
+	if (_dirty.empty())
+		return false;
+
+	auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::system_clock::now().time_since_epoch());
+
+	// 格式: {"timestamp":ms,"beacons":[{"address":"..","rssi":-60,"m":{"76":".."},"s":{"uuid":".."}}]}
+	body.clear();
+	body.reserve(64 + _dirty.size() * 96);
+	body += "{\"timestamp\":";
+	body += std::to_string(now.count());
+	body += ",\"beacons\":[";
+
+	bool firstEntry = true;
+
+	for (const auto& address : _dirty)
+	{
+		auto it = _entries.find(address);
+		if (it == _entries.end())
+			continue;
+
+		auto& entry = it->second;
+		entry.dirty = false;
+
+		if (!firstEntry)
+			body += ',';
+		firstEntry = false;
+
+		body += "{\"address\":\"";
+		body += address;
+		body += "\",\"rssi\":";
+		body += std::to_string(entry.rssi);
+
+		body += ",\"m\":{";
+		bool first = true;
+		for (const auto& [company, bytes] : entry.manufacturerData)
+		{
+			if (!first)
+				body += ',';
+			first = false;
+
+			body += '"';
+			body += std::to_string(company);
+			body += "\":";
+			appendBase64(body, bytes);
+		}
+
+		body += "},\"s\":{";
+		first = true;
+		for (const auto& [uuid, bytes] : entry.serviceData)
+		{
+			if (!first)
+				body += ',';
+			first = false;
+
+			body += '"';
+			body += uuid;
+			body += "\":";
+			appendBase64(body, bytes);
+		}
+
+		body += "}}";
+	}
+
+	body += "]}";
+	_dirty.clear();
+
+	return true;
+}
@@ -0,0 +1,75 @@
+#ifndef BLUETOOTH_BEACON_COLLECTOR_H_
+#define BLUETOOTH_BEACON_COLLECTOR_H_
+
+#include <defines.h>
+#include <sdbus-c++/sdbus-c++.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// BLE 广播数据(ManufacturerData/ServiceData)采集
+// 按设备去重相同负载，周期性地把所有变化设备合并为一条紧凑消息
+class CORE_API BeaconCollector
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	BeaconCollector() = default;
+
+	void setEnabled(bool enabled) { _enabled = enabled; }
+
+	// 超过 ttl 未收到广播的设备在 flush 时移除，轮换的随机地址不会无限累积
+	void setTtl(std::chrono::milliseconds ttl);
+
+	bool isEnabled() const { return _enabled; }
+
+	void onManufacturerData(const std::string& address,
+							const std::map<std::uint16_t, sdbus::Variant>& data);
+
+	void onServiceData(const std::string& address,
+					   const std::map<std::string, sdbus::Variant>& data);
+
+	void onRssi(const std::string& address, std::int16_t rssi);
+
+	// 输出自上次调用以来负载发生变化的设备，没有变化时返回 false
+	bool flush(std::string& body);
+
+	std::uint64_t getReceivedCount() const { return _received; }
+
+	std::uint64_t getDuplicateCount() const { return _duplicates; }
+
+	// 当前跟踪的设备数
+	size_t getEntryCount() const;
+
+private:
+	struct Entry
+	{
+		std::map<std::uint16_t, std::vector<std::uint8_t>> manufacturerData;
+		std::map<std::string, std::vector<std::uint8_t>> serviceData;
+		std::int16_t rssi = 0;
+		bool dirty = false;
+		Clock::time_point lastSeen;
+	};
+
+	void markDirty(const std::string& address, Entry& entry);
+
+	// 移除过期设备，调用方持有锁
+	void prune(Clock::time_point now);
+
+	std::atomic<bool> _enabled{ false };
+	std::atomic<std::uint64_t> _received{ 0 };
+	std::atomic<std::uint64_t> _duplicates{ 0 };
+
+	mutable std::mutex _mutex;
+	std::chrono::milliseconds _ttl{ 10000 };
+	std::unordered_map<std::string, Entry> _entries;
+	std::vector<std::string> _dirty;
+};
+
+#endif // BLUETOOTH_BEACON_COLLECTOR_H_
@@ -19,9 +19,54 @@ BluetoothManager::BluetoothManager(sdbus::IConnection& conn_adpater,
 	{
 		onInterfacesAdded(object, interfaceAndProperties);
 	}
+
+	_discovery_scheduler.setControl([this](bool enable) { return setDiscovering(enable); },
+									[this]() { return isDiscovering(); });
+}
+
+BluetoothManager::~BluetoothManager()
+{
+	_discovery_scheduler.stop();
+	unregisterProxy();
+}
+
+bool BluetoothManager::setDiscovering(bool enable)
+{
+	std::scoped_lock lock(_adapters_mutex);
+	bool success = false;
+
+	for (const auto& [objectPath, adapter] : _adapters)
+	{
+		try
+		{
+			if (enable)
+				adapter->startDiscovery();
+			else
+				adapter->stopDiscovery();
+
+			success = true;
+		}
+		catch (const sdbus::Error& e)
+		{
+			LOG_WARN("{}设备发现失败 ({}/{})", enable ? "开启" : "关闭", e.getName(), e.getMessage());
+		}
+	}
+
+	return success;
 }
 
-BluetoothManager::~BluetoothManager() { unregisterProxy(); }
+bool BluetoothManager::isDiscovering()
+{
+	std::scoped_lock lock(_adapters_mutex);
+
+	for (const auto& [objectPath, adapter] : _adapters)
+	{
+		if (adapter->getProperties().discovering)
+			return true;
+	}
+
+	return false;
+}
 
 Json::Value BluetoothManager::getAdapters()
 {
@@ -46,9 +91,15 @@ Json::Value BluetoothManager::getDevices()
 {
 	Json::Value root;
 	Json::Value devicesValue(Json::arrayValue);
+	auto now = AdvertisementFilter::Clock::now();
+
+	std::scoped_lock lock(_devices_mutex);
 
 	for (const auto& [objectPath, device] : _devices)
 	{
+		// 提交限速期间被合并的广播更新
+		device->flushAdvertisement(now);
+
 		Json::Value deviceValue = device->getProperties().toJson();
 		devicesValue.append(deviceValue);
 	}
@@ -331,7 +382,9 @@ void BluetoothManager::onInterfacesAdded(
 				auto device = std::make_unique<Device>(getProxy().getConnection(),
 													   sdbus::ServiceName(INTERFACE_NAME),
 													   objectPath,
-													   properties);
+													   properties,
+													   &_advertisement_filter,
+													   &_beacon_collector);
 
 				_devices[objectPath] = std::move(device);
 			}
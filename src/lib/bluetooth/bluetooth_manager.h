@@ -4,6 +4,7 @@
 #include <defines.h>
 #include <bluetooth/adapter.h>
 #include <bluetooth/device.h>
+#include <bluetooth/discovery_scheduler.h>
 
 #include <json/json.h>
 
@@ -41,6 +42,20 @@ public:
 
 	void setConnectTimeout(int timeoutMs) { _timeout_connect_ms = std::max(0, timeoutMs); }
 
+	void setAdvertisementOptions(const AdvertisementFilter::Options& options)
+	{
+		_advertisement_filter.setOptions(options);
+	}
+
+	BeaconCollector& getBeaconCollector() { return _beacon_collector; }
+
+	DiscoveryScheduler& getDiscoveryScheduler() { return _discovery_scheduler; }
+
+	// 开启/关闭所有适配器的设备发现
+	bool setDiscovering(bool enable);
+
+	bool isDiscovering();
+
 private:
 	void onInterfacesAdded(
 		const sdbus::ObjectPath& objectPath,
@@ -64,12 +79,21 @@ private:
 	int _timeout_pair_ms;
 	int _timeout_connect_ms;
 
+	// 广播更新合并与限速(所有设备共享)
+	AdvertisementFilter _advertisement_filter;
+
+	// BLE 广播数据采集(所有设备共享)
+	BeaconCollector _beacon_collector;
+
 	std::mutex _adapters_mutex;
 	std::mutex _devices_mutex;
 
 	std::map<sdbus::ObjectPath, std::unique_ptr<Adapter>> _adapters;
 	std::map<sdbus::ObjectPath, std::unique_ptr<Device>> _devices;
 
+	// 设备发现调度，析构时最先停止
+	DiscoveryScheduler _discovery_scheduler;
+
 	std::mutex _pincodes_mutex;
 	std::map<std::string, std::string> _pairing_pincodes;
 
@@ -0,0 +1,149 @@
+#include <bluetooth/device.h>
+
+#include <cctype>
+
+namespace {
+
+	bool isHex4(std::string_view s)
+	{
+		if (s.size() < 4)
+			return false;
+
+		for (size_t i = 0; i < 4; ++i)
+		{
+			if (!std::isxdigit(static_cast<unsigned char>(s[i])))
+				return false;
+		}
+
+		return true;
+	}
+}
+
+std::optional<Device::Modalias> Device::parseModalias(std::string_view mod_alias)
+{
+	// 格式: usb:vXXXXpXXXXdXXXX 或 bluetooth:vXXXXpXXXXdXXXX
+	for (const std::string_view prefix : { std::string_view("usb:v"), std::string_view("bluetooth:v") })
+	{
+		const auto pos = mod_alias.find(prefix);
+		if (pos == std::string_view::npos)
+			continue;
+
+		const auto body = mod_alias.substr(pos + prefix.size());
+
+		if (body.size() >= 14 && isHex4(body) && body[4] == 'p' && isHex4(body.substr(5)) &&
+			body[9] == 'd' && isHex4(body.substr(10)))
+		{
+			return Modalias{ std::string(body.substr(0, 4)),
+							 std::string(body.substr(5, 4)),
+							 std::string(body.substr(10, 4)) };
+		}
+	}
+
+	LOG_ERROR("解析模态失败 - {}", mod_alias);
+	return {};
+}
+
+bool Device::flushAdvertisement(AdvertisementFilter::Clock::time_point now)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (!_filter || _pending.empty())
+		return false;
+
+	return commitAdvertisement(now);
+}
+
+bool Device::commitAdvertisement(AdvertisementFilter::Clock::time_point now)
+{
+	// 仅有 RSSI 抖动时直接丢弃，不标记设备变更
+	if (_pending.rssi && _filter->isRssiJitter(_properties.rssi, *_pending.rssi))
+		_pending.rssi.reset();
+
+	if (_pending.empty() || !_filter->admit(_budget, now))
+		return false;
+
+	if (_pending.rssi)
+		_properties.rssi = *_pending.rssi;
+
+	if (_pending.manufacturerData)
+		_properties.manufacturerData = std::move(*_pending.manufacturerData);
+
+	if (_pending.serviceData)
+		_properties.serviceData = std::move(*_pending.serviceData);
+
+	_pending = PendingAdvertisement{};
+	return true;
+}
+
+const std::unordered_map<std::string_view, Device::PropertySetter> Device::_setters = {
+	{ "Adapter",
+	  [](Device& d, const sdbus::Variant& v) {
+		  d._properties.adapter = v.get<sdbus::ObjectPath>();
+	  } },
+	{ "Address",
+	  [](Device& d, const sdbus::Variant& v) { d._properties.address = v.get<std::string>(); } },
+	{ "AddressType",
+	  [](Device& d, const sdbus::Variant& v) {
+		  d._properties.address_type = v.get<std::string>();
+	  } },
+	{ "Alias",
+	  [](Device& d, const sdbus::Variant& v) { d._properties.alias = v.get<std::string>(); } },
+	{ "Bonded", [](Device& d, const sdbus::Variant& v) { d._properties.bonded = v.get<bool>(); } },
+	{ "Blocked",
+	  [](Device& d, const sdbus::Variant& v) { d._properties.blocked = v.get<bool>(); } },
+	{ "Connected",
+	  [](Device& d, const sdbus::Variant& v) { d._properties.connected = v.get<bool>(); } },
+	{ "LegacyPairing",
+	  [](Device& d, const sdbus::Variant& v) { d._properties.legacyPairing = v.get<bool>(); } },
+	{ "Paired", [](Device& d, const sdbus::Variant& v) { d._properties.paired = v.get<bool>(); } },
+	{ "Modalias",
+	  [](Device& d, const sdbus::Variant& v) {
+		  d._properties.modalias = parseModalias(v.get<std::string>());
+	  } },
+	{ "Name", [](Device& d, const sdbus::Variant& v) { d._properties.name = v.get<std::string>(); } },
+	// 广播数据在过滤前交给采集器，Address 按键序先于这些属性处理
+	{ "ManufacturerData",
+	  [](Device& d, const sdbus::Variant& v) {
+		  auto data = v.get<std::map<std::uint16_t, sdbus::Variant>>();
+
+		  if (d._beacons)
+			  d._beacons->onManufacturerData(d._properties.address, data);
+
+		  if (d._filter)
+			  d._pending.manufacturerData = std::move(data);
+		  else
+			  d._properties.manufacturerData = std::move(data);
+	  } },
+	{ "ServiceData",
+	  [](Device& d, const sdbus::Variant& v) {
+		  auto data = v.get<std::map<std::string, sdbus::Variant>>();
+
+		  if (d._beacons)
+			  d._beacons->onServiceData(d._properties.address, data);
+
+		  if (d._filter)
+			  d._pending.serviceData = std::move(data);
+		  else
+			  d._properties.serviceData = std::move(data);
+	  } },
+	{ "RSSI",
+	  [](Device& d, const sdbus::Variant& v) {
+		  auto rssi = v.get<std::int16_t>();
+
+		  if (d._beacons)
+			  d._beacons->onRssi(d._properties.address, rssi);
+
+		  if (d._filter)
+			  d._pending.rssi = rssi;
+		  else
+			  d._properties.rssi = rssi;
+	  } },
+	{ "ServicesResolved",
+	  [](Device& d, const sdbus::Variant& v) { d._properties.servicesResolved = v.get<bool>(); } },
+	{ "Trusted",
+	  [](Device& d, const sdbus::Variant& v) { d._properties.trusted = v.get<bool>(); } },
+	{ "UUIDs",
+	  [](Device& d, const sdbus::Variant& v) {
+		  d._properties.uuids = v.get<std::vector<std::string>>();
+	  } },
+};
@@ -3,11 +3,15 @@
 
 #include <defines.h>
 #include <bluetooth/proxy/device_proxy.h>
+#include <bluetooth/advertisement_filter.h>
+#include <bluetooth/beacon_collector.h>
 #include <utils/logger.h>
 #include <json/json.h>
 
-#include <regex>
+#include <mutex>
 #include <optional>
+#include <string_view>
+#include <unordered_map>
 
 class CORE_API Device final
 	: public sdbus::ProxyInterfaces<sdbus::Properties_proxy, org::bluez::Device1_proxy>
@@ -80,105 +84,78 @@ public:
 	Device(sdbus::IConnection& connection,
 		   const sdbus::ServiceName(&destination),
 		   const sdbus::ObjectPath(&objectPath),
-		   const std::map<sdbus::PropertyName, sdbus::Variant>& properties)
-		: ProxyInterfaces{ connection, destination, objectPath }
+		   const std::map<sdbus::PropertyName, sdbus::Variant>& properties,
+		   AdvertisementFilter* filter = nullptr,
+		   BeaconCollector* beacons = nullptr)
+		: ProxyInterfaces{ connection, destination, objectPath }, _beacons(beacons)
 	{
+		// 初始属性直接生效，之后的广播更新才经过过滤器；均在注册信号之前完成
+		applyProperties(properties);
+		_filter = filter;
+
 		registerProxy();
-		onPropertiesChanged(sdbus::InterfaceName(Device1_proxy::INTERFACE_NAME), properties, {});
 	}
 	~Device() { unregisterProxy(); }
 
-	[[nodiscard]] const Properties& getProperties() const { return _properties; }
-
-
-	static std::optional<Modalias> parseModalias(const std::string& mod_alias)
+	// 属性快照，D-Bus 线程会同时更新属性，不返回引用
+	[[nodiscard]] Properties getProperties() const
 	{
-		const std::regex re(R"(usb:v([0-9A-Fa-f]{4})p([0-9A-Fa-f]{4})d([0-9A-Fa-f]{4}))");
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _properties;
+	}
 
-		if (std::smatch match; std::regex_search(mod_alias, match, re) && match.size() == 4)
-		{
-			return Modalias{ match[1].str(), match[2].str(), match[3].str() };
-		}
+	// 尝试提交被延迟的广播更新(突发更新只保留最新值)，返回是否产生了可见变更
+	bool flushAdvertisement(AdvertisementFilter::Clock::time_point now);
 
-		const std::regex re2(R"(bluetooth:v([0-9A-Fa-f]{4})p([0-9A-Fa-f]{4})d([0-9A-Fa-f]{4}))");
+	// 应用一组属性变更，与收到 PropertiesChanged 信号时相同
+	void applyProperties(const std::map<sdbus::PropertyName, sdbus::Variant>& changedProperties)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
 
-		if (std::smatch match; std::regex_search(mod_alias, match, re2) && match.size() == 4)
+		for (const auto& [name, value] : changedProperties)
 		{
-			return Modalias{ match[1].str(), match[2].str(), match[3].str() };
+			if (const auto it = _setters.find(name); it != _setters.end())
+				it->second(*this, value);
 		}
 
-		LOG_ERROR("解析模态失败 - {}", mod_alias);
-		return {};
+		if (!_pending.empty())
+			commitAdvertisement(AdvertisementFilter::Clock::now());
 	}
 
+	static std::optional<Modalias> parseModalias(std::string_view mod_alias);
+
 private:
+	using PropertySetter = void (*)(Device&, const sdbus::Variant&);
+
+	// 尚未提交到 _properties 的广播数据
+	struct PendingAdvertisement
+	{
+		std::optional<std::int16_t> rssi;
+		std::optional<std::map<std::uint16_t, sdbus::Variant>> manufacturerData;
+		std::optional<std::map<std::string, sdbus::Variant>> serviceData;
+
+		bool empty() const { return !rssi && !manufacturerData && !serviceData; }
+	};
+
+	bool commitAdvertisement(AdvertisementFilter::Clock::time_point now);
+
 	Properties _properties{};
 
+	mutable std::mutex _mutex;
+	BeaconCollector* _beacons = nullptr;
+	AdvertisementFilter* _filter = nullptr;
+	AdvertisementFilter::Budget _budget;
+	PendingAdvertisement _pending;
+
+	// 属性名 -> 字段写入函数，属性变更时单次遍历查表分发
+	static const std::unordered_map<std::string_view, PropertySetter> _setters;
+
 	void onPropertiesChanged(const sdbus::InterfaceName& interfaceName,
 							 const std::map<sdbus::PropertyName, sdbus::Variant>& changedProperties,
 							 const std::vector<sdbus::PropertyName>& invalidatedProperties) override
 	{
-		if (const auto key = sdbus::MemberName("Adapter"); changedProperties.count(key))
-		{
-			_properties.adapter = changedProperties.at(key).get<sdbus::ObjectPath>();
-		}
-		if (const auto key = sdbus::MemberName("Address"); changedProperties.count(key))
-		{
-			_properties.address = changedProperties.at(key).get<std::string>();
-		}
-		if (const auto key = sdbus::MemberName("AddressType"); changedProperties.count(key))
-		{
-			_properties.address_type = changedProperties.at(key).get<std::string>();
-		}
-		if (const auto key = sdbus::MemberName("Bonded"); changedProperties.count(key))
-		{
-			_properties.bonded = changedProperties.at(key).get<bool>();
-		}
-		if (const auto key = sdbus::MemberName("Blocked"); changedProperties.count(key))
-		{
-			_properties.blocked = changedProperties.at(key).get<bool>();
-		}
-		if (const auto key = sdbus::MemberName("Connected"); changedProperties.count(key))
-		{
-			_properties.connected = changedProperties.at(key).get<bool>();
-		}
-		if (const auto key = sdbus::MemberName("LegacyPairing"); changedProperties.count(key))
-		{
-			_properties.legacyPairing = changedProperties.at(key).get<bool>();
-		}
-		if (const auto key = sdbus::MemberName("Paired"); changedProperties.count(key))
-		{
-			_properties.paired = changedProperties.at(key).get<bool>();
-		}
-		if (const auto key = sdbus::MemberName("Modalias"); changedProperties.count(key))
-		{
-			_properties.modalias = parseModalias(changedProperties.at(key).get<std::string>());
-		}
-		if (const auto key = sdbus::MemberName("Name"); changedProperties.count(key))
-		{
-			_properties.name = changedProperties.at(key).get<std::string>();
-		}
-		if (const auto key = sdbus::MemberName("ServiceData"); changedProperties.count(key))
-		{
-			_properties.serviceData =
-				changedProperties.at(key).get<std::map<std::string, sdbus::Variant>>();
-		}
-		if (const auto key = sdbus::MemberName("RSSI"); changedProperties.count(key))
-		{
-			_properties.rssi = changedProperties.at(key).get<std::int16_t>();
-		}
-		if (const auto key = sdbus::MemberName("ServicesResolved"); changedProperties.count(key))
-		{
-			_properties.servicesResolved = changedProperties.at(key).get<bool>();
-		}
-		if (const auto key = sdbus::MemberName("Trusted"); changedProperties.count(key))
-		{
-			_properties.trusted = changedProperties.at(key).get<bool>();
-		}
-		if (const auto key = sdbus::MemberName("UUIDs"); changedProperties.count(key))
-		{
-			_properties.uuids = changedProperties.at(key).get<std::vector<std::string>>();
-		}
+		applyProperties(changedProperties);
+
 #if 0
     Utils::print_changed_properties(interfaceName, changedProperties,
                                     invalidatedProperties);
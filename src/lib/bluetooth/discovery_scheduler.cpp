@@ -0,0 +1,266 @@
+#include <bluetooth/discovery_scheduler.h>
+#include <utils/logger.h>
+
+#include <algorithm>
+
+namespace {
+	constexpr auto SCHEDULER_TICK = std::chrono::milliseconds(200);
+	constexpr auto RESTART_INTERVAL = std::chrono::seconds(1);
+	constexpr auto MAX_RETRY_INTERVAL = std::chrono::seconds(30);
+	constexpr auto CONNECT_WAIT_TIMEOUT = std::chrono::seconds(1);
+}
+
+DiscoveryScheduler::DiscoveryScheduler()
+	: _running(false),
+	  _connecting(0),
+	  _lastTraffic(0),
+	  _retryDelay(RESTART_INTERVAL),
+	  _lastReason(PauseReason::None),
+	  _scanning(false),
+	  _scanTime(0),
+	  _scanCount(0),
+	  _startFailures(0),
+	  _pausedForConnect(0),
+	  _pausedForTraffic(0),
+	  _onDemandRequests(0)
+{
+}
+
+DiscoveryScheduler::~DiscoveryScheduler() { stop(); }
+
+void DiscoveryScheduler::setOptions(const Options& options)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_options = options;
+	_options.scanWindowMs = std::max(0, _options.scanWindowMs);
+	_options.scanIntervalMs = std::max(_options.scanWindowMs, _options.scanIntervalMs);
+	_options.transferIdleMs = std::max(0, _options.transferIdleMs);
+}
+
+void DiscoveryScheduler::setControl(DiscoveryControl control, DiscoveryQuery query)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_control = std::move(control);
+	_query = std::move(query);
+}
+
+void DiscoveryScheduler::start()
+{
+	if (_running)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_cycleStart = Clock::now();
+	}
+
+	_running = true;
+	_thread = std::thread(&DiscoveryScheduler::schedulerThread, this);
+}
+
+void DiscoveryScheduler::stop()
+{
+	if (!_running)
+		return;
+
+	_running = false;
+	_cv.notify_all();
+
+	if (_thread.joinable())
+		_thread.join();
+}
+
+void DiscoveryScheduler::beginConnect()
+{
+	++_connecting;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (!_running || !_options.pauseDuringConnect)
+		return;
+
+	_cv.notify_all();
+	_cv.wait_for(lock, CONNECT_WAIT_TIMEOUT, [this] { return !_scanning; });
+}
+
+void DiscoveryScheduler::endConnect()
+{
+	--_connecting;
+	_cv.notify_all();
+}
+
+void DiscoveryScheduler::notifyTraffic()
+{
+	_lastTraffic.store(Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+void DiscoveryScheduler::requestScan(int durationMs)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_onDemandUntil = std::max(_onDemandUntil,
+								  Clock::now() + std::chrono::milliseconds(std::max(0, durationMs)));
+		++_onDemandRequests;
+	}
+
+	_cv.notify_all();
+}
+
+bool DiscoveryScheduler::isScanning() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _scanning;
+}
+
+Json::Value DiscoveryScheduler::getStats() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto scanTime = _scanTime;
+	if (_scanning)
+		scanTime += std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - _lastStart);
+
+	Json::Value root;
+	root["scanning"] = _scanning;
+	root["scanTimeMs"] = static_cast<Json::UInt64>(scanTime.count());
+	root["scanCount"] = static_cast<Json::UInt64>(_scanCount);
+	root["startFailures"] = static_cast<Json::UInt64>(_startFailures);
+	root["pausedForConnect"] = static_cast<Json::UInt64>(_pausedForConnect);
+	root["pausedForTraffic"] = static_cast<Json::UInt64>(_pausedForTraffic);
+	root["onDemandRequests"] = static_cast<Json::UInt64>(_onDemandRequests);
+	return root;
+}
+
+DiscoveryScheduler::PauseReason DiscoveryScheduler::evaluate(Clock::time_point now) const
+{
+	if (_options.pauseDuringConnect && _connecting > 0)
+		return PauseReason::Connect;
+
+	if (_options.pauseWhileTransferring)
+	{
+		auto lastTraffic = Clock::time_point(Clock::duration(_lastTraffic.load()));
+		if (now - lastTraffic < std::chrono::milliseconds(_options.transferIdleMs))
+			return PauseReason::Traffic;
+	}
+
+	if (now < _onDemandUntil)
+		return PauseReason::None;
+
+	if (_options.onDemandOnly || _options.scanWindowMs == 0)
+		return PauseReason::Window;
+
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - _cycleStart);
+	if (elapsed.count() % _options.scanIntervalMs < _options.scanWindowMs)
+		return PauseReason::None;
+
+	return PauseReason::Window;
+}
+
+void DiscoveryScheduler::setScanning(bool scanning, Clock::time_point now)
+{
+	if (scanning == _scanning)
+		return;
+
+	if (scanning)
+	{
+		_lastStart = now;
+		++_scanCount;
+	}
+	else
+	{
+		_scanTime += std::chrono::duration_cast<std::chrono::milliseconds>(now - _lastStart);
+	}
+
+	_scanning = scanning;
+}
+
+void DiscoveryScheduler::updateRetry(bool success, Clock::time_point now)
+{
+	if (success)
+	{
+		_retryDelay = RESTART_INTERVAL;
+		_retryAt = Clock::time_point();
+		return;
+	}
+
+	// 适配器不可用时按指数退避重试，避免每个调度周期都重复失败并输出告警
+	++_startFailures;
+	_retryAt = now + _retryDelay;
+	_retryDelay = std::min(_retryDelay * 2,
+						   std::chrono::duration_cast<std::chrono::milliseconds>(MAX_RETRY_INTERVAL));
+}
+
+void DiscoveryScheduler::schedulerThread()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (_running)
+	{
+		auto now = Clock::now();
+		auto reason = evaluate(now);
+		bool wanted = reason == PauseReason::None;
+
+		if (reason != _lastReason)
+		{
+			if (reason == PauseReason::Connect)
+				++_pausedForConnect;
+			else if (reason == PauseReason::Traffic)
+				++_pausedForTraffic;
+
+			_lastReason = reason;
+		}
+
+		if (_control)
+		{
+			auto control = _control;
+			auto query = _query;
+
+			if (wanted != _scanning)
+			{
+				if (!wanted || now >= _retryAt)
+				{
+					if (wanted)
+						_lastAttempt = now;
+
+					lock.unlock();
+					bool success = control(wanted);
+					lock.lock();
+
+					if (wanted)
+						updateRetry(success, now);
+
+					if (success || !wanted)
+						setScanning(wanted, Clock::now());
+
+					_cv.notify_all();
+				}
+			}
+			else if (wanted && now - _lastAttempt >= RESTART_INTERVAL && now >= _retryAt)
+			{
+				// 适配器自行停止了发现，在窗口内重新开启
+				_lastAttempt = now;
+				bool success = true;
+
+				lock.unlock();
+				if (query && !query())
+				{
+					LOG_DEBUG("设备发现已停止，重新开启");
+					success = control(true);
+				}
+				lock.lock();
+
+				updateRetry(success, now);
+			}
+		}
+
+		_cv.wait_for(lock, SCHEDULER_TICK);
+	}
+
+	if (_scanning && _control)
+	{
+		auto control = _control;
+		lock.unlock();
+		control(false);
+		lock.lock();
+		setScanning(false, Clock::now());
+	}
+}
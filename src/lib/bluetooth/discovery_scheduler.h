@@ -0,0 +1,130 @@
+#ifndef BLUETOOTH_DISCOVERY_SCHEDULER_H_
+#define BLUETOOTH_DISCOVERY_SCHEDULER_H_
+
+#include <defines.h>
+#include <json/json.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// 设备发现调度器
+// 按扫描窗口周期性开启/关闭发现，在建立连接或链路有数据传输时让出射频
+class CORE_API DiscoveryScheduler
+{
+public:
+	using Clock = std::chrono::steady_clock;
+	using DiscoveryControl = std::function<bool(bool enable)>;
+	using DiscoveryQuery = std::function<bool()>;
+
+	struct Options
+	{
+		int scanWindowMs = 10000;			// 每个周期内的扫描时长
+		int scanIntervalMs = 30000;			// 扫描周期，与窗口相等时持续扫描
+		bool pauseDuringConnect = true;		// 配对/连接期间暂停扫描
+		bool pauseWhileTransferring = true; // 链路有数据收发时暂停扫描
+		int transferIdleMs = 2000;			// 最后一次收发后持续暂停的时间
+		bool onDemandOnly = false;			// 仅在收到按需扫描请求时扫描
+	};
+
+	// 连接期间暂停扫描的作用域对象
+	class ConnectGuard
+	{
+	public:
+		explicit ConnectGuard(DiscoveryScheduler& scheduler) : _scheduler(scheduler)
+		{
+			_scheduler.beginConnect();
+		}
+
+		~ConnectGuard() { _scheduler.endConnect(); }
+
+		ConnectGuard(const ConnectGuard&) = delete;
+		ConnectGuard& operator=(const ConnectGuard&) = delete;
+
+	private:
+		DiscoveryScheduler& _scheduler;
+	};
+
+	DiscoveryScheduler();
+
+	~DiscoveryScheduler();
+
+	DiscoveryScheduler(const DiscoveryScheduler&) = delete;
+	DiscoveryScheduler& operator=(const DiscoveryScheduler&) = delete;
+
+	void setOptions(const Options& options);
+
+	void setControl(DiscoveryControl control, DiscoveryQuery query);
+
+	void start();
+
+	void stop();
+
+	// 开始连接，等待扫描停止后返回
+	void beginConnect();
+
+	void endConnect();
+
+	// 链路收发数据时调用
+	void notifyTraffic();
+
+	// 按需扫描指定时长
+	void requestScan(int durationMs);
+
+	bool isScanning() const;
+
+	Json::Value getStats() const;
+
+private:
+	enum class PauseReason
+	{
+		None,
+		Window,
+		Connect,
+		Traffic
+	};
+
+	void schedulerThread();
+
+	PauseReason evaluate(Clock::time_point now) const;
+
+	void setScanning(bool scanning, Clock::time_point now);
+
+	// 记录一次开启发现的结果，失败时推迟下次尝试
+	void updateRetry(bool success, Clock::time_point now);
+
+private:
+	Options _options;
+	DiscoveryControl _control;
+	DiscoveryQuery _query;
+
+	mutable std::mutex _mutex;
+	std::condition_variable _cv;
+	std::thread _thread;
+	std::atomic<bool> _running;
+
+	std::atomic<int> _connecting;
+	std::atomic<Clock::rep> _lastTraffic;
+
+	Clock::time_point _cycleStart;
+	Clock::time_point _onDemandUntil;
+	Clock::time_point _lastStart;
+	Clock::time_point _lastAttempt;
+	Clock::time_point _retryAt;
+	std::chrono::milliseconds _retryDelay;
+	PauseReason _lastReason;
+	bool _scanning;
+
+	// 统计
+	std::chrono::milliseconds _scanTime;
+	std::uint64_t _scanCount;
+	std::uint64_t _startFailures;
+	std::uint64_t _pausedForConnect;
+	std::uint64_t _pausedForTraffic;
+	std::uint64_t _onDemandRequests;
+};
+
+#endif // BLUETOOTH_DISCOVERY_SCHEDULER_H_
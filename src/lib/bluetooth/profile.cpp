@@ -1,4 +1,9 @@
 #include <bluetooth/profile.h>
+#include <bluetooth/utils.h>
+#include <utils/logger.h>
+
+#include <cstring>
+#include <unistd.h>
 
 
 Profile::Profile(sdbus::IConnection& connection, sdbus::ObjectPath objectPath)
@@ -13,24 +18,57 @@ uint16_t Profile::getRfcommChannel() const { return _rfcommChannel; }
 
 void Profile::setRfcommChannel(uint16_t channel) { _rfcommChannel = channel; }
 
+void Profile::setConnectionCallback(ConnectionCallback callback)
+{
+	_connectionCallback = std::move(callback);
+}
+
+void Profile::setDisconnectionCallback(DisconnectionCallback callback)
+{
+	_disconnectionCallback = std::move(callback);
+}
+
+void Profile::setReleaseCallback(ReleaseCallback callback)
+{
+	_releaseCallback = std::move(callback);
+}
+
 void Profile::onNewConnection(const sdbus::ObjectPath& device,
 							  const sdbus::UnixFd& fd,
 							  const std::map<std::string, sdbus::Variant>& properties)
 {
-	
+	std::string address = Utils::devicePathToAddress(device);
+	LOG_INFO("Profile新连接 - {}", address);
+
+	if (!_connectionCallback)
+		throw sdbus::Error(sdbus::Error::Name("org.bluez.Error.Rejected"), "Connection rejected");
+
+	// UnixFd 析构时会关闭自身持有的描述符，复制一份交给连接处理
+	int socket = ::dup(fd.get());
+	if (socket < 0)
+	{
+		LOG_ERROR("Profile复制文件描述符失败 - {}", strerror(errno));
+		throw sdbus::Error(sdbus::Error::Name("org.bluez.Error.Rejected"), strerror(errno));
+	}
+
+	_connectionCallback(address, socket);
 }
 
 void Profile::onRequestDisconnection(const sdbus::ObjectPath& device)
 {
-	
-}
+	std::string address = Utils::devicePathToAddress(device);
+	LOG_INFO("Profile请求断开连接 - {}", address);
 
-void Profile::onCancel()
-{
-	
+	if (_disconnectionCallback)
+		_disconnectionCallback(address);
 }
 
+void Profile::onCancel() { LOG_WARN("Profile请求已取消"); }
+
 void Profile::onRelease()
 {
-	
-}
\ No newline at end of file
+	LOG_WARN("Profile已被 BlueZ 释放");
+
+	if (_releaseCallback)
+		_releaseCallback();
+}
@@ -10,6 +10,11 @@
 class CORE_API Profile : public sdbus::AdaptorInterfaces<org::bluez::Profile1_adaptor>
 {
 public:
+	// 回调函数类型定义，文件描述符的所有权转移给回调
+	using ConnectionCallback = std::function<void(const std::string& address, int fd)>;
+	using DisconnectionCallback = std::function<void(const std::string& address)>;
+	using ReleaseCallback = std::function<void()>;
+
 	Profile(sdbus::IConnection& connection, sdbus::ObjectPath objectPath);
 
 	~Profile();
@@ -18,6 +23,12 @@ public:
 
 	void setRfcommChannel(uint16_t rfcommChanel);
 
+	void setConnectionCallback(ConnectionCallback callback);
+
+	void setDisconnectionCallback(DisconnectionCallback callback);
+
+	void setReleaseCallback(ReleaseCallback callback);
+
 private:
 	void onNewConnection(const sdbus::ObjectPath& device,
 						 const sdbus::UnixFd& fd,
@@ -31,7 +42,11 @@ private:
 
 private:
 	uint16_t _rfcommChannel = 1;
+
+	ConnectionCallback _connectionCallback;
+	DisconnectionCallback _disconnectionCallback;
+	ReleaseCallback _releaseCallback;
 };
 
 
-#endif // BLUETOOTH_PROFILE_H_
\ No newline at end of file
+#endif // BLUETOOTH_PROFILE_H_
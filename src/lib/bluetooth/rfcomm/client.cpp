@@ -1,5 +1,5 @@
 #include <bluetooth/rfcomm/client.h>
-#include <bluetooth/rfcomm/sdp.h>
+#include <bluetooth/rfcomm/rfcomm_transport.h>
 #include <utils/logger.h>
 
 #include <cstring>
@@ -19,10 +19,13 @@ BluetoothClient::BluetoothClient(const std::string& clientName)
 	  _clientName(clientName),
 	  _connected(false),
 	  _running(false),
+	  _transport(std::make_shared<RfcommTransport>()),
 	  _channel(0),
 	  _connectCallback(nullptr),
 	  _disconnectCallback(nullptr),
-	  _dataReceivedCallback(nullptr)
+	  _dataReceivedCallback(nullptr),
+	  _bufferPool(nullptr),
+	  _downlinkStats(nullptr)
 {
 
 	_connectCallback = [this](const std::string& address, uint8_t channel) {
@@ -33,8 +36,8 @@ BluetoothClient::BluetoothClient(const std::string& clientName)
 		LOG_INFO("已断开: {} -> {}/{}", _localAddress, channel, address);
 	};
 
-	_dataReceivedCallback = [](const std::string& address, const uint8_t* data, size_t size) {
-		LOG_INFO("已接收: {}/{} BYTES -> CLIENT", address, size);
+	_dataReceivedCallback = [](const std::string& address, const BufferSlice& frame) {
+		LOG_INFO("已接收: {}/{} BYTES -> CLIENT", address, frame.size());
 	};
 }
 
@@ -51,7 +54,7 @@ bool BluetoothClient::connect(const std::string& deviceAddress, uint8_t channel)
 	if (channel == 0)
 	{
 		// 自动查询可用通道
-		if (!sdp::findAvailableSPPChannel(deviceAddress, _channel))
+		if (!_transport->resolveChannel(deviceAddress, _channel))
 			return false;
 	}
 	else
@@ -62,6 +65,12 @@ bool BluetoothClient::connect(const std::string& deviceAddress, uint8_t channel)
 	if (!connectToDevice(deviceAddress, _channel))
 		return false;
 
+	{
+		std::lock_guard<std::mutex> lock(_socketMutex);
+		_session = std::make_shared<Session>(
+			deviceAddress, Session::Role::Outbound, _socket, _downlinkOptions, _downlinkStats);
+	}
+
 	_running = true;
 	_connected = true;
 	// 启动数据接收线程
@@ -86,6 +95,10 @@ void BluetoothClient::disconnect()
 	if (_receiveThread.joinable())
 		_receiveThread.join();
 
+	// 写出剩余下行数据，须在关闭套接字之前
+	if (std::shared_ptr<Session> session = getSession())
+		session->shutdown();
+
 	// 清理客户端资源
 	{
 		std::lock_guard<std::mutex> lock(_socketMutex);
@@ -103,22 +116,21 @@ void BluetoothClient::disconnect()
 
 ssize_t BluetoothClient::send(const std::vector<uint8_t>& data)
 {
-	if (!_connected || _socket < 0)
+	std::shared_ptr<Session> session = getSession();
+
+	if (!_connected || !session)
 	{
 		LOG_WARN("RFCOMM 客户端未连接");
 		return -1;
 	}
 
-	std::lock_guard<std::mutex> lock(_socketMutex);
-	ssize_t sent = ::send(_socket, data.data(), data.size(), 0);
-
-	if (sent < 0)
-	{
-		LOG_ERROR("RFCOMM 客户端内部错误(send) - {}", strerror(errno));
-		return -1;
-	}
+	return session->send(data);
+}
 
-	return sent;
+std::shared_ptr<Session> BluetoothClient::getSession() const
+{
+	std::lock_guard<std::mutex> lock(_socketMutex);
+	return _session;
 }
 
 std::string BluetoothClient::getLocalAddress() const
@@ -129,16 +141,7 @@ std::string BluetoothClient::getLocalAddress() const
 		return "未知";
 	}
 
-	struct sockaddr_rc localAddr;
-	socklen_t len = sizeof(localAddr);
-
-	if (getsockname(_socket, (struct sockaddr*)&localAddr, &len) < 0)
-	{
-		LOG_ERROR("RFCOMM 客户端内部错误 - {}", strerror(errno));
-		return "未知";
-	}
-
-	return bdaddrToString(localAddr);
+	return _transport->socketAddress(_socket);
 }
 
 std::string BluetoothClient::getRemoteAddress() const { return _remoteAddress; }
@@ -146,10 +149,19 @@ std::string BluetoothClient::getRemoteAddress() const { return _remoteAddress; }
 void BluetoothClient::receiveThread()
 {
 	int bufferSize = std::max(_bufferSize, 1024);
-	std::vector<uint8_t> buffer(bufferSize, 0);
+
+	// 接收数据直接写入分帧缓冲区，按完整帧回调
+	FrameAssembler assembler(_decoderFactory ? _decoderFactory(_remoteAddress) : nullptr,
+							 bufferSize * 2,
+							 _bufferPool);
+	auto onFrame = [this](const BufferSlice& frame) { _dataReceivedCallback(_remoteAddress, frame); };
 
 	while (_running && _connected)
 	{
+		// 上行积压时暂停读取，数据留在内核与 RFCOMM 窗口中反压设备
+		if (_readGate && !_readGate(_remoteAddress))
+			continue;
+
 		fd_set readfds;
 		FD_ZERO(&readfds);
 		FD_SET(_socket, &readfds);
@@ -182,7 +194,7 @@ void BluetoothClient::receiveThread()
 
 		if (FD_ISSET(_socket, &readfds))
 		{
-			ssize_t received = recv(_socket, buffer.data(), bufferSize, 0);
+			ssize_t received = recv(_socket, assembler.prepare(bufferSize), bufferSize, 0);
 
 			if (received <= 0)
 			{
@@ -196,87 +208,54 @@ void BluetoothClient::receiveThread()
 
 			// 调用数据接收回调
 			std::lock_guard<std::mutex> lock(_callbackMutex);
-			_dataReceivedCallback(getRemoteAddress(), buffer.data(), received);
+			assembler.commit(static_cast<size_t>(received), onFrame);
 		}
 	}
 
+	if (assembler.pending() > 0 || assembler.dropped() > 0)
+		LOG_WARN("{} 断开时丢弃不完整帧 {} 字节，失步丢弃 {} 字节",
+				 _remoteAddress,
+				 assembler.pending(),
+				 assembler.dropped());
+
 	// 开启短线程断开连接
 	std::thread([this]() { this->disconnect(); }).detach();
 }
 
 bool BluetoothClient::connectToDevice(const std::string& address, uint8_t channel)
 {
-	_socket = socket(AF_BLUETOOTH, SOCK_STREAM, BTPROTO_RFCOMM);
+	// 尝试连接
+	bool pending = false;
+	_socket = _transport->connect(address, channel, pending);
 	if (_socket < 0)
-	{
-		LOG_ERROR("RFCOMM 客户端内部错误 - {}", strerror(errno));
 		return false;
-	}
 
-	// 设置非阻塞模式
-	int flags = fcntl(_socket, F_GETFL, 0);
-	if (flags < 0 || fcntl(_socket, F_SETFL, flags | O_NONBLOCK) < 0)
+	if (pending)
 	{
-		close(_socket);
-		_socket = -1;
-
-		LOG_ERROR("RFCOMM 客户端内部错误 - {}", strerror(errno));
-		return false;
-	}
-
-	struct sockaddr_rc addr;
-	memset(&addr, 0, sizeof(addr));
-	addr.rc_family = AF_BLUETOOTH;
-	addr.rc_channel = channel;
-
-	if (!stringTobaddr(address, addr.rc_bdaddr))
-	{
-		close(_socket);
-		_socket = -1;
-
-		LOG_WARN("无效的 RFCOMM 服务器地址: {}", address);
-		return false;
-	}
-
-	// 尝试连接
-	int result = ::connect(_socket, (struct sockaddr*)&addr, sizeof(addr));
-	if (result < 0)
-	{
-		if (errno == EINPROGRESS)
+		// 非阻塞连接，等待连接完成
+		fd_set writefds, errorfds;
+		FD_ZERO(&writefds);
+		FD_ZERO(&errorfds);
+		FD_SET(_socket, &writefds);
+		FD_SET(_socket, &errorfds);
+
+		struct timeval tv = { 0, std::max(0, _connectTimeout) * 1000 };
+		if (tv.tv_usec >= 1000000)
 		{
-			// 非阻塞连接，等待连接完成
-			fd_set writefds, errorfds;
-			FD_ZERO(&writefds);
-			FD_ZERO(&errorfds);
-			FD_SET(_socket, &writefds);
-			FD_SET(_socket, &errorfds);
-
-			struct timeval tv = { 0, std::max(0, _connectTimeout) * 1000 };
-			if (tv.tv_usec >= 1000000)
-			{
-				tv.tv_sec += tv.tv_usec / 1000000;
-				tv.tv_usec %= 1000000;
-			}
+			tv.tv_sec += tv.tv_usec / 1000000;
+			tv.tv_usec %= 1000000;
+		}
 
-			result = select(_socket + 1, nullptr, &writefds, &errorfds, &tv);
+		int result = select(_socket + 1, nullptr, &writefds, &errorfds, &tv);
 
-			if (result > 0)
+		if (result > 0)
+		{
+			if (FD_ISSET(_socket, &writefds))
 			{
-				if (FD_ISSET(_socket, &writefds))
-				{
-					// 检查连接是否成功
-					int error = 0;
-					socklen_t len = sizeof(error);
-					if (getsockopt(_socket, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0)
-					{
-						close(_socket);
-						_socket = -1;
-
-						LOG_ERROR("RFCOMM 客户端内部错误(connect) - {}", strerror(errno));
-						return false;
-					}
-				}
-				else if (FD_ISSET(_socket, &errorfds))
+				// 检查连接是否成功
+				int error = 0;
+				socklen_t len = sizeof(error);
+				if (getsockopt(_socket, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0)
 				{
 					close(_socket);
 					_socket = -1;
@@ -285,12 +264,12 @@ bool BluetoothClient::connectToDevice(const std::string& address, uint8_t channe
 					return false;
 				}
 			}
-			else
+			else if (FD_ISSET(_socket, &errorfds))
 			{
 				close(_socket);
 				_socket = -1;
 
-				LOG_ERROR("RFCOMM 服务器连接超时 - {}", strerror(errno));
+				LOG_ERROR("RFCOMM 客户端内部错误(connect) - {}", strerror(errno));
 				return false;
 			}
 		}
@@ -299,7 +278,7 @@ bool BluetoothClient::connectToDevice(const std::string& address, uint8_t channe
 			close(_socket);
 			_socket = -1;
 
-			LOG_ERROR("RFCOMM 客户端内部错误(connect) - {}", strerror(errno));
+			LOG_ERROR("RFCOMM 服务器连接超时 - {}", strerror(errno));
 			return false;
 		}
 	}
@@ -313,15 +292,3 @@ bool BluetoothClient::connectToDevice(const std::string& address, uint8_t channe
 
 	return true;
 }
-
-std::string BluetoothClient::bdaddrToString(const sockaddr_rc& addr)
-{
-	char str[20];
-	ba2str(&addr.rc_bdaddr, str);
-	return std::string(str);
-}
-
-bool BluetoothClient::stringTobaddr(const std::string& str, bdaddr_t& addr)
-{
-	return str2ba(str.c_str(), &addr) == 0;
-}
@@ -5,25 +5,27 @@
 #include <functional>
 #include <mutex>
 #include <thread>
+#include <memory>
 #include <string>
+#include <vector>
 
-#include <bluetooth/bluetooth.h>
-#include <bluetooth/rfcomm.h>
-#include <bluetooth/hci.h>
-#include <bluetooth/hci_lib.h>
-#include <bluetooth/sdp.h>
-#include <bluetooth/sdp_lib.h>
+#include <sys/types.h>
 
-struct sockaddr_rc;
+#include <bluetooth/rfcomm/downlink_writer.h>
+#include <bluetooth/rfcomm/frame_decoder.h>
+#include <bluetooth/rfcomm/session.h>
+#include <bluetooth/rfcomm/transport.h>
 
 class BluetoothClient
 {
 public:
 	// 回调函数类型定义
 	using ClientCallback = std::function<void(const std::string&, uint8_t)>;
-	using DataCallback = std::function<void(const std::string&, const uint8_t*, size_t)>;
+	using DataCallback = std::function<void(const std::string&, const BufferSlice&)>;
 	using ErrorCallback = std::function<void(const std::string&)>;
 	using StatusCallback = std::function<void(bool connected)>;
+	using DecoderFactory = std::function<std::unique_ptr<FrameDecoder>(const std::string&)>;
+	using ReadGate = std::function<bool(const std::string&)>;
 
 	explicit BluetoothClient(const std::string& clientName = "Bluetooth SPP Client");
 
@@ -46,6 +48,9 @@ public:
 
 	std::string getRemoteAddress() const;
 
+	// 当前连接的会话，可脱离客户端直接发送；未连接过时返回空
+	std::shared_ptr<Session> getSession() const;
+
 	// 设置回调函数
 	void setConnectCallback(ClientCallback callback) { _connectCallback = std::move(callback); }
 
@@ -59,12 +64,31 @@ public:
 		_dataReceivedCallback = std::move(callback);
 	}
 
+	// 按设备地址创建分帧器，未设置时每次接收的数据作为一帧
+	void setDecoderFactory(DecoderFactory factory) { _decoderFactory = std::move(factory); }
+
+	// 接收缓冲区来源，未设置时从堆上分配
+	void setBufferPool(BufferPool* pool) { _bufferPool = pool; }
+
+	// 下行写入方式与统计，需在 connect 之前调用；stats 可为空
+	void setDownlink(const DownlinkWriter::Options& options, DownlinkStats* stats)
+	{
+		_downlinkOptions = options;
+		_downlinkStats = stats;
+	}
+
+	// 接收线程每次读取前调用，返回 false 时本轮不读取(上行反压)，由回调自行限时等待
+	void setReadGate(ReadGate gate) { _readGate = std::move(gate); }
+
 	void setBufferSize(int size) { _bufferSize = size; }
 
 	void setConnectTimeout(int seconds) { _connectTimeout = seconds; }
 
 	void setRecvTimeout(int seconds) { _recvTimeout = seconds; }
 
+	// 设置传输层，默认为 RFCOMM；需在 connect 之前调用
+	void setTransport(std::shared_ptr<Transport> transport) { _transport = std::move(transport); }
+
 private:
 	// 线程函数
 	void receiveThread();
@@ -73,10 +97,6 @@ private:
 	bool connectToDevice(const std::string& address, uint8_t channel);
 	void cleanupConnection();
 
-	// 蓝牙地址转换
-	static std::string bdaddrToString(const sockaddr_rc& addr);
-	static bool stringTobaddr(const std::string& str, bdaddr_t& addr);
-
 private:
 	// 客户端配置
 	int _socket;
@@ -87,6 +107,7 @@ private:
 	std::string _clientName;
 	std::atomic<bool> _connected;
 	std::atomic<bool> _running;
+	std::shared_ptr<Transport> _transport;
 
 	// 地址信息
 	std::string _localAddress;
@@ -100,6 +121,12 @@ private:
 	ClientCallback _connectCallback;
 	ClientCallback _disconnectCallback;
 	DataCallback _dataReceivedCallback;
+	DecoderFactory _decoderFactory;
+	ReadGate _readGate;
+	BufferPool* _bufferPool;
+	DownlinkWriter::Options _downlinkOptions;
+	DownlinkStats* _downlinkStats;
+	std::shared_ptr<Session> _session; // 由 _socketMutex 保护
 
 	// 互斥锁
 	mutable std::mutex _socketMutex;
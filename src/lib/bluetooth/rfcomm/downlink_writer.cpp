@@ -0,0 +1,292 @@
+#include <bluetooth/rfcomm/downlink_writer.h>
+#include <utils/logger.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+namespace {
+
+	// 单次 writev 的最大分段数
+	constexpr size_t kMaxIov = std::min<size_t>(IOV_MAX, 64);
+
+	// 发送超时，写线程借此检查停止标记，避免对端无响应时阻塞断开流程
+	constexpr int kSendTimeoutSec = 2;
+
+	// 链路拥塞时等待可写的间隔，期间检查停止标记
+	constexpr int kWritableWaitMs = 100;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+DownlinkStats::DownlinkStats()
+	: _payloads(0),
+	  _writes(0),
+	  _bytes(0),
+	  _dropped(0),
+	  _errors(0),
+	  _lastTime(Clock::now()),
+	  _lastPayloads(0),
+	  _lastWrites(0)
+{
+}
+
+void DownlinkStats::record(uint64_t payloads, uint64_t writes, uint64_t bytes)
+{
+	_payloads += payloads;
+	_writes += writes;
+	_bytes += bytes;
+}
+
+Json::Value DownlinkStats::getStats() const
+{
+	uint64_t payloads = _payloads.load();
+	uint64_t writes = _writes.load();
+	uint64_t bytes = _bytes.load();
+
+	double payloadsPerSec = 0;
+	double writesPerSec = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(_rateMutex);
+
+		auto now = Clock::now();
+		double seconds = std::chrono::duration<double>(now - _lastTime).count();
+
+		if (seconds > 0)
+		{
+			payloadsPerSec = static_cast<double>(payloads - _lastPayloads) / seconds;
+			writesPerSec = static_cast<double>(writes - _lastWrites) / seconds;
+		}
+
+		_lastTime = now;
+		_lastPayloads = payloads;
+		_lastWrites = writes;
+	}
+
+	Json::Value root;
+	root["payloads"] = static_cast<Json::UInt64>(payloads);
+	root["writes"] = static_cast<Json::UInt64>(writes);
+	root["bytes"] = static_cast<Json::UInt64>(bytes);
+	root["bytesPerWrite"] = static_cast<Json::UInt64>(writes ? bytes / writes : 0);
+	root["payloadsPerSec"] = static_cast<Json::UInt64>(payloadsPerSec);
+	root["writesPerSec"] = static_cast<Json::UInt64>(writesPerSec);
+	root["dropped"] = static_cast<Json::UInt64>(_dropped.load());
+	root["errors"] = static_cast<Json::UInt64>(_errors.load());
+	return root;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+DownlinkWriter::DownlinkWriter(int socket,
+							   const std::string& address,
+							   const Options& options,
+							   DownlinkStats* stats)
+	: _socket(socket),
+	  _address(address),
+	  _options(options),
+	  _stats(stats),
+	  _queuedBytes(0),
+	  _stopping(false),
+	  _failed(false)
+{
+	if (_options.maxBytes == 0)
+		_options.maxBytes = 1;
+
+	struct timeval tv = { kSendTimeoutSec, 0 };
+	setsockopt(_socket, SOL_SOCKET, SO_SNDTIMEO, (const char*)&tv, sizeof tv);
+
+	_thread = std::thread(&DownlinkWriter::run, this);
+}
+
+DownlinkWriter::~DownlinkWriter()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+
+	_cv.notify_one();
+
+	if (_thread.joinable())
+		_thread.join();
+}
+
+bool DownlinkWriter::write(std::vector<uint8_t> data)
+{
+	return enqueue({ std::move(data), Buffer(), Clock::now() });
+}
+
+bool DownlinkWriter::write(Buffer data)
+{
+	return enqueue({ std::vector<uint8_t>(), std::move(data), Clock::now() });
+}
+
+bool DownlinkWriter::enqueue(Pending pending)
+{
+	size_t size = pending.size();
+
+	if (size == 0)
+		return true;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if (_stopping || _failed || _queuedBytes + size > _options.maxQueuedBytes)
+		{
+			if (_stats)
+				_stats->recordDropped(1);
+
+			LOG_WARN("{} 下行队列已满或连接异常，丢弃 {} 字节", _address, size);
+			return false;
+		}
+
+		_queue.push_back(std::move(pending));
+		_queuedBytes += size;
+	}
+
+	_cv.notify_one();
+	return true;
+}
+
+ssize_t DownlinkWriter::tryWrite(const uint8_t* data, size_t size)
+{
+	if (size == 0)
+		return 0;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if (_stopping || _failed)
+			return -1;
+
+		if (_queuedBytes + size > _options.maxQueuedBytes / 2)
+			return 0;
+
+		_queue.push_back({ std::vector<uint8_t>(data, data + size), Buffer(), Clock::now() });
+		_queuedBytes += size;
+	}
+
+	_cv.notify_one();
+	return static_cast<ssize_t>(size);
+}
+
+void DownlinkWriter::run()
+{
+	std::vector<Pending> batch;
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (true)
+	{
+		_cv.wait(lock, [this]() { return !_queue.empty() || _stopping; });
+
+		if (_queue.empty())
+			break;
+
+		// 等待窗口到期或累计达到单次写入上限，停止时立即写出
+		Clock::time_point deadline = _queue.front().enqueued + _options.maxDelay;
+		_cv.wait_until(lock, deadline, [this]() {
+			return _queuedBytes >= _options.maxBytes || _stopping;
+		});
+
+		// 至少取一条，超过 maxBytes 的单条数据单独写出
+		size_t bytes = 0;
+		while (!_queue.empty() && batch.size() < kMaxIov &&
+			   (batch.empty() || bytes + _queue.front().size() <= _options.maxBytes))
+		{
+			bytes += _queue.front().size();
+			batch.push_back(std::move(_queue.front()));
+			_queue.pop_front();
+		}
+
+		_queuedBytes -= bytes;
+		lock.unlock();
+
+		bool ok = writeAll(batch, bytes);
+		batch.clear();
+
+		lock.lock();
+
+		if (!ok)
+		{
+			// 连接已不可写，丢弃剩余数据，由接收线程发现断开
+			if (_stats)
+				_stats->recordDropped(_queue.size());
+
+			_failed = true;
+			_queue.clear();
+			_queuedBytes = 0;
+		}
+	}
+}
+
+bool DownlinkWriter::writeAll(std::vector<Pending>& batch, size_t bytes)
+{
+	struct iovec iov[kMaxIov];
+	size_t count = batch.size();
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		iov[i].iov_base = const_cast<uint8_t*>(batch[i].bytes());
+		iov[i].iov_len = batch[i].size();
+	}
+
+	struct iovec* first = iov;
+	size_t remaining = bytes;
+	uint64_t writes = 0;
+
+	while (remaining > 0)
+	{
+		ssize_t written = writev(_socket, first, static_cast<int>(count));
+
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			// 发送超时或非阻塞套接字(主动连接的会话)写满：链路拥塞但未断开时等待可写后重试，
+			// 停止时放弃；连接出错时由下一次 writev 返回错误
+			if ((errno == EAGAIN || errno == EWOULDBLOCK) && !_stopping)
+			{
+				struct pollfd pfd = { _socket, POLLOUT, 0 };
+				poll(&pfd, 1, kWritableWaitMs);
+				continue;
+			}
+
+			LOG_ERROR("RFCOMM 下行写入失败(writev) - {} - {}", _address, strerror(errno));
+
+			if (_stats)
+			{
+				_stats->recordError();
+				_stats->recordDropped(batch.size());
+			}
+
+			return false;
+		}
+
+		++writes;
+		remaining -= static_cast<size_t>(written);
+
+		// 部分写入，跳过已写出的分段
+		size_t n = static_cast<size_t>(written);
+		while (count > 0 && n >= first->iov_len)
+		{
+			n -= first->iov_len;
+			++first;
+			--count;
+		}
+
+		if (count > 0)
+		{
+			first->iov_base = static_cast<uint8_t*>(first->iov_base) + n;
+			first->iov_len -= n;
+		}
+	}
+
+	if (_stats)
+		_stats->record(batch.size(), writes, bytes);
+
+	return true;
+}
@@ -0,0 +1,122 @@
+#ifndef BLUETOOTH_RFCOMM_DOWNLINK_WRITER_H_
+#define BLUETOOTH_RFCOMM_DOWNLINK_WRITER_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/types.h>
+
+#include <json/json.h>
+
+#include <utils/buffer_pool.h>
+
+// 下行写入统计，服务端与各客户端连接共用
+class DownlinkStats
+{
+public:
+	DownlinkStats();
+
+	// payloads 条下行数据以 writes 次系统调用写出 bytes 字节
+	void record(uint64_t payloads, uint64_t writes, uint64_t bytes);
+
+	void recordDropped(uint64_t payloads) { _dropped += payloads; }
+
+	void recordError() { ++_errors; }
+
+	// 累计值以及距上次调用的每秒条数/写入次数
+	Json::Value getStats() const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	std::atomic<uint64_t> _payloads;
+	std::atomic<uint64_t> _writes;
+	std::atomic<uint64_t> _bytes;
+	std::atomic<uint64_t> _dropped;
+	std::atomic<uint64_t> _errors;
+
+	mutable std::mutex _rateMutex;
+	mutable Clock::time_point _lastTime;
+	mutable uint64_t _lastPayloads;
+	mutable uint64_t _lastWrites;
+};
+
+// 下行合并写入
+//
+// 同一连接的下行数据先入队，由写线程在窗口(maxDelay)内合并，累计不超过 maxBytes
+// (约为 RFCOMM MTU)时以一次 writev 写出，减少系统调用和空口帧数；按入队顺序写出。
+class DownlinkWriter
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	struct Options
+	{
+		bool coalesce = false;					 // 是否启用合并写入
+		std::chrono::milliseconds maxDelay{ 2 }; // 首条数据入队后最多等待的时间
+		size_t maxBytes = 1000;					 // 单次写入的最大字节数
+		size_t maxQueuedBytes = 256 * 1024;		 // 队列上限，超出时丢弃新数据
+	};
+
+	DownlinkWriter(int socket, const std::string& address, const Options& options, DownlinkStats* stats);
+
+	// 写出剩余数据后退出写线程，须在关闭套接字之前析构
+	~DownlinkWriter();
+
+	DownlinkWriter(const DownlinkWriter&) = delete;
+	DownlinkWriter& operator=(const DownlinkWriter&) = delete;
+
+	// 入队，队列已满或写线程已退出时返回 false
+	bool write(std::vector<uint8_t> data);
+
+	// 同上，持有缓冲区的引用直到写出，不复制数据
+	bool write(Buffer data);
+
+	// 队列占用不超过上限一半时入队，否则返回 0 且不计为丢弃(留出余量给普通下行)；
+	// 写线程已退出时返回 -1
+	ssize_t tryWrite(const uint8_t* data, size_t size);
+
+private:
+	// 数据在 data 或 buffer 之一中
+	struct Pending
+	{
+		std::vector<uint8_t> data;
+		Buffer buffer;
+		Clock::time_point enqueued;
+
+		const uint8_t* bytes() const { return buffer ? buffer.data() : data.data(); }
+
+		size_t size() const { return buffer ? buffer.size() : data.size(); }
+	};
+
+	bool enqueue(Pending pending);
+
+	void run();
+
+	// 写出全部数据，处理部分写入，失败时返回 false
+	bool writeAll(std::vector<Pending>& batch, size_t bytes);
+
+private:
+	int _socket;
+	std::string _address;
+	Options _options;
+	DownlinkStats* _stats;
+
+	std::mutex _mutex;
+	std::condition_variable _cv;
+	std::deque<Pending> _queue;
+	size_t _queuedBytes;
+	std::atomic<bool> _stopping;
+	bool _failed;
+
+	std::thread _thread;
+};
+
+#endif // BLUETOOTH_RFCOMM_DOWNLINK_WRITER_H_
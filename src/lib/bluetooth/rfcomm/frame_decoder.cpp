@@ -0,0 +1,226 @@
+#include <bluetooth/rfcomm/frame_decoder.h>
+#include <utils/logger.h>
+#include <utils/string_utils.h>
+
+#include <algorithm>
+#include <cstring>
+
+long LengthPrefixDecoder::decode(const uint8_t* data, size_t size)
+{
+	const std::string& magic = _options.magic;
+
+	// 校验帧头(可能只收到部分)
+	size_t n = std::min(size, magic.size());
+	if (n > 0 && std::memcmp(data, magic.data(), n) != 0)
+		return resync(data, size);
+
+	size_t header = _options.lengthOffset + _options.lengthSize;
+	if (size < std::max(header, magic.size()))
+		return 0;
+
+	const uint8_t* p = data + _options.lengthOffset;
+	uint64_t length = 0;
+
+	for (size_t i = 0; i < _options.lengthSize; ++i)
+	{
+		size_t shift = _options.littleEndian ? i : _options.lengthSize - 1 - i;
+		length |= static_cast<uint64_t>(p[i]) << (8 * shift);
+	}
+
+	long total = static_cast<long>(length) + _options.lengthAdjust;
+
+	if (total < static_cast<long>(header) || total > static_cast<long>(_options.maxFrameSize))
+	{
+		LOG_WARN("帧长度无效({})，重新同步", total);
+		return resync(data, size);
+	}
+
+	if (size < static_cast<size_t>(total))
+		return 0;
+
+	return total;
+}
+
+long LengthPrefixDecoder::resync(const uint8_t* data, size_t size) const
+{
+	const std::string& magic = _options.magic;
+
+	if (magic.empty())
+		return -1;
+
+	// 跳到下一个可能的帧头
+	for (size_t i = 1; i < size; ++i)
+	{
+		size_t n = std::min(size - i, magic.size());
+		if (std::memcmp(data + i, magic.data(), n) == 0)
+			return -static_cast<long>(i);
+	}
+
+	return -static_cast<long>(size);
+}
+
+long DelimiterDecoder::decode(const uint8_t* data, size_t size)
+{
+	if (_delimiter.empty())
+		return static_cast<long>(size);
+
+	size_t from = _scanned >= _delimiter.size() ? _scanned - _delimiter.size() + 1 : 0;
+
+	const uint8_t* end = data + size;
+	const uint8_t* found =
+		std::search(data + from, end, _delimiter.begin(), _delimiter.end(), [](uint8_t a, char b) {
+			return a == static_cast<uint8_t>(b);
+		});
+
+	if (found != end)
+	{
+		_scanned = 0;
+		size_t length = static_cast<size_t>(found - data) + _delimiter.size();
+
+		// 同一次接收中可能一并收到超长帧和它的分隔符
+		if (length > _maxFrameSize)
+		{
+			LOG_WARN("帧长度({})超过最大帧长({})，丢弃", length, _maxFrameSize);
+			return -static_cast<long>(length);
+		}
+
+		return static_cast<long>(length);
+	}
+
+	if (size > _maxFrameSize)
+	{
+		LOG_WARN("超过最大帧长({})仍未找到分隔符，丢弃", _maxFrameSize);
+		_scanned = 0;
+		return -static_cast<long>(size);
+	}
+
+	_scanned = size;
+	return 0;
+}
+
+FrameAssembler::FrameAssembler(std::unique_ptr<FrameDecoder> decoder,
+							   size_t capacity,
+							   BufferPool* pool)
+	: _buffer(capacity, pool), _decoder(std::move(decoder)), _dropped(0)
+{
+	if (!_decoder)
+		_decoder = std::make_unique<RawDecoder>();
+}
+
+size_t FrameAssembler::commit(size_t n, const FrameCallback& callback)
+{
+	_buffer.commit(n);
+
+	size_t frames = 0;
+
+	while (!_buffer.empty())
+	{
+		long result = _decoder->decode(_buffer.data(), _buffer.size());
+
+		if (result == 0)
+			break;
+
+		if (result < 0)
+		{
+			size_t drop = std::min(static_cast<size_t>(-result), _buffer.size());
+			_dropped += drop;
+			_buffer.consume(drop);
+			continue;
+		}
+
+		size_t length = std::min(static_cast<size_t>(result), _buffer.size());
+		callback(_buffer.slice(length));
+		_buffer.consume(length);
+		++frames;
+	}
+
+	return frames;
+}
+
+void FramingConfig::load(const Json::Value& framing)
+{
+	if (!framing.isObject())
+		return;
+
+	_default = framing["default"];
+
+	const Json::Value& devices = framing["devices"];
+	if (devices.isObject())
+	{
+		for (const auto& address : devices.getMemberNames())
+			_devices[toLower(address)] = devices[address];
+	}
+
+	const Json::Value& uuids = framing["uuids"];
+	if (uuids.isObject())
+	{
+		for (const auto& uuid : uuids.getMemberNames())
+			_uuids[toLower(uuid)] = uuids[uuid];
+	}
+}
+
+void FramingConfig::registerCustom(const std::string& name, CustomFactory factory)
+{
+	_customs[name] = std::move(factory);
+}
+
+std::unique_ptr<FrameDecoder> FramingConfig::create(const std::string& address,
+													const std::vector<std::string>& uuids) const
+{
+	// 设备配置优先于服务UUID配置
+	auto it = _devices.find(toLower(address));
+	if (it != _devices.end())
+		return createDecoder(it->second);
+
+	for (const auto& uuid : uuids)
+	{
+		auto found = _uuids.find(toLower(uuid));
+		if (found != _uuids.end())
+			return createDecoder(found->second);
+	}
+
+	return createDecoder(_default);
+}
+
+std::unique_ptr<FrameDecoder> FramingConfig::createDecoder(const Json::Value& spec) const
+{
+	if (!spec.isObject())
+		return std::make_unique<RawDecoder>();
+
+	std::string type = spec.get("type", "raw").asString();
+	size_t maxFrameSize = spec.get("max_frame_size", 65536).asUInt();
+
+	if (type == "length")
+	{
+		LengthPrefixDecoder::Options options;
+		options.magic = spec.get("magic", "").asString();
+		options.lengthOffset = spec.get("length_offset", 0).asUInt();
+		options.lengthSize = spec.get("length_size", 4).asUInt();
+		options.littleEndian = spec.get("little_endian", true).asBool();
+		options.lengthAdjust = spec.get("length_adjust", 0).asInt();
+		options.maxFrameSize = maxFrameSize;
+
+		if (options.lengthSize != 1 && options.lengthSize != 2 && options.lengthSize != 4)
+		{
+			LOG_WARN("长度字段字节数无效({})，使用透传", options.lengthSize);
+			return std::make_unique<RawDecoder>();
+		}
+
+		return std::make_unique<LengthPrefixDecoder>(options);
+	}
+
+	if (type == "delimiter")
+		return std::make_unique<DelimiterDecoder>(spec.get("delimiter", "\n").asString(), maxFrameSize);
+
+	if (type == "fixed")
+		return std::make_unique<FixedDecoder>(spec.get("frame_size", 1).asUInt());
+
+	auto it = _customs.find(type);
+	if (it != _customs.end())
+		return it->second(spec);
+
+	if (type != "raw")
+		LOG_WARN("未知的分帧类型 - {}，使用透传", type);
+
+	return std::make_unique<RawDecoder>();
+}
@@ -0,0 +1,159 @@
+#ifndef BLUETOOTH_RFCOMM_FRAME_DECODER_H_
+#define BLUETOOTH_RFCOMM_FRAME_DECODER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <json/json.h>
+
+#include <utils/stream_buffer.h>
+
+// 串口字节流分帧
+//
+// decode 检查缓冲区头部：
+//   > 0  完整帧的长度
+//   = 0  数据不足，等待更多数据
+//   < 0  头部数据无效，丢弃 -n 字节后重新同步
+class FrameDecoder
+{
+public:
+	virtual ~FrameDecoder() = default;
+
+	virtual long decode(const uint8_t* data, size_t size) = 0;
+};
+
+// 透传，每次接收的数据作为一帧(与未分帧时一致)
+class RawDecoder : public FrameDecoder
+{
+public:
+	long decode(const uint8_t* data, size_t size) override { return static_cast<long>(size); }
+};
+
+// 长度前缀帧，如 "BEG" + 4字节小端帧长
+class LengthPrefixDecoder : public FrameDecoder
+{
+public:
+	struct Options
+	{
+		std::string magic;			  // 帧头标识，可为空
+		size_t lengthOffset = 0;	  // 长度字段偏移
+		size_t lengthSize = 4;		  // 长度字段字节数: 1/2/4
+		bool littleEndian = true;	  // 长度字段字节序
+		long lengthAdjust = 0;		  // 帧总长 = 长度字段 + lengthAdjust
+		size_t maxFrameSize = 65536;  // 超过时视为失步
+	};
+
+	explicit LengthPrefixDecoder(const Options& options) : _options(options) {}
+
+	long decode(const uint8_t* data, size_t size) override;
+
+private:
+	long resync(const uint8_t* data, size_t size) const;
+
+	Options _options;
+};
+
+// 分隔符帧，帧包含分隔符
+class DelimiterDecoder : public FrameDecoder
+{
+public:
+	DelimiterDecoder(std::string delimiter, size_t maxFrameSize)
+		: _delimiter(std::move(delimiter)), _maxFrameSize(maxFrameSize), _scanned(0)
+	{
+	}
+
+	long decode(const uint8_t* data, size_t size) override;
+
+private:
+	std::string _delimiter;
+	size_t _maxFrameSize;
+	size_t _scanned; // 已检查过的字节数，避免重复扫描
+};
+
+// 定长帧
+class FixedDecoder : public FrameDecoder
+{
+public:
+	explicit FixedDecoder(size_t frameSize) : _frameSize(frameSize ? frameSize : 1) {}
+
+	long decode(const uint8_t* data, size_t size) override
+	{
+		return size >= _frameSize ? static_cast<long>(_frameSize) : 0;
+	}
+
+private:
+	size_t _frameSize;
+};
+
+// 自定义分帧函数
+class CustomDecoder : public FrameDecoder
+{
+public:
+	using DecodeFunction = std::function<long(const uint8_t*, size_t)>;
+
+	explicit CustomDecoder(DecodeFunction decode) : _decode(std::move(decode)) {}
+
+	long decode(const uint8_t* data, size_t size) override { return _decode(data, size); }
+
+private:
+	DecodeFunction _decode;
+};
+
+// 单个连接的分帧状态：recv 直接写入缓冲区，完整帧以引用计数的切片回调
+class FrameAssembler
+{
+public:
+	using FrameCallback = std::function<void(const BufferSlice&)>;
+
+	FrameAssembler(std::unique_ptr<FrameDecoder> decoder, size_t capacity, BufferPool* pool = nullptr);
+
+	uint8_t* prepare(size_t n) { return _buffer.prepare(n); }
+
+	// 提交新接收的 n 字节，回调所有完整帧，返回帧数
+	size_t commit(size_t n, const FrameCallback& callback);
+
+	size_t pending() const { return _buffer.size(); }
+
+	size_t dropped() const { return _dropped; }
+
+private:
+	StreamBuffer _buffer;
+	std::unique_ptr<FrameDecoder> _decoder;
+	size_t _dropped;
+};
+
+// 按设备地址/服务UUID选择分帧方式
+//
+// "framing": {
+//     "default": { "type": "raw" },
+//     "devices": { "04:25:09:10:01:A3": { "type": "length", "magic": "BEG", "length_offset": 3 } },
+//     "uuids":   { "00001101-0000-1000-8000-00805f9b34fb": { "type": "delimiter", "delimiter": "\r\n" } }
+// }
+class FramingConfig
+{
+public:
+	using CustomFactory = std::function<std::unique_ptr<FrameDecoder>(const Json::Value&)>;
+
+	void load(const Json::Value& framing);
+
+	// 注册自定义分帧，配置中以 "type": name 引用
+	void registerCustom(const std::string& name, CustomFactory factory);
+
+	std::unique_ptr<FrameDecoder> create(const std::string& address,
+										 const std::vector<std::string>& uuids) const;
+
+private:
+	std::unique_ptr<FrameDecoder> createDecoder(const Json::Value& spec) const;
+
+	Json::Value _default;
+	std::unordered_map<std::string, Json::Value> _devices;
+	std::unordered_map<std::string, Json::Value> _uuids;
+	std::unordered_map<std::string, CustomFactory> _customs;
+};
+
+#endif // BLUETOOTH_RFCOMM_FRAME_DECODER_H_
@@ -0,0 +1,285 @@
+#include <bluetooth/rfcomm/loopback_transport.h>
+#include <utils/logger.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+LoopbackTransport::LoopbackTransport(Kind kind, const Transport::Options& options)
+	: _kind(kind), _options(options), _anonymous(0)
+{
+}
+
+bool LoopbackTransport::registerService(const std::string& serviceName,
+										const std::string& serviceUUID,
+										uint8_t& channel,
+										uint32_t& handle)
+{
+	if (channel == 0)
+		channel = 1;
+
+	handle = 0;
+	return true;
+}
+
+bool LoopbackTransport::resolveChannel(const std::string& address, uint8_t& channel)
+{
+	channel = 1;
+	return true;
+}
+
+int LoopbackTransport::listen(uint8_t channel, int backlog)
+{
+	int sock = -1;
+
+	if (_kind == Kind::Unix)
+	{
+		std::string path = socketPath(_options.localAddress, channel);
+
+		sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+
+		if (path.size() >= sizeof(addr.sun_path))
+		{
+			LOG_ERROR("套接字路径过长 - {}", path);
+			return -1;
+		}
+
+		strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+		mkdir(_options.path.c_str(), 0755);
+		unlink(path.c_str());
+
+		sock = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (sock < 0 || bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+		{
+			LOG_ERROR("回环服务器内部错误(bind) - {}", strerror(errno));
+			if (sock >= 0)
+				close(sock);
+
+			return -1;
+		}
+	}
+	else
+	{
+		sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(static_cast<uint16_t>(_options.basePort + channel));
+
+		if (inet_pton(AF_INET, _options.host.c_str(), &addr.sin_addr) != 1)
+		{
+			LOG_ERROR("无效的回环主机地址 - {}", _options.host);
+			return -1;
+		}
+
+		sock = socket(AF_INET, SOCK_STREAM, 0);
+		if (sock < 0)
+		{
+			LOG_ERROR("回环服务器内部错误 - {}", strerror(errno));
+			return -1;
+		}
+
+		int reuse = 1;
+		setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+		if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+		{
+			LOG_ERROR("回环服务器内部错误(bind) - {}", strerror(errno));
+			close(sock);
+			return -1;
+		}
+	}
+
+	if (::listen(sock, backlog) < 0)
+	{
+		LOG_ERROR("回环服务器内部错误(listen) - {}", strerror(errno));
+		close(sock);
+		return -1;
+	}
+
+	return sock;
+}
+
+int LoopbackTransport::accept(int listenSocket, std::string& peerAddress)
+{
+	sockaddr_storage peer;
+	socklen_t len = sizeof(peer);
+	memset(&peer, 0, sizeof(peer));
+
+	int sock = ::accept(listenSocket, (struct sockaddr*)&peer, &len);
+	if (sock < 0)
+		return -1;
+
+	uint8_t bytes[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x00 };
+
+	if (_kind == Kind::Unix)
+	{
+		const auto* un = reinterpret_cast<const sockaddr_un*>(&peer);
+
+		if (len > offsetof(sockaddr_un, sun_path) && un->sun_path[0] != '\0' &&
+			addressFromPath(un->sun_path, peerAddress))
+			return sock;
+
+		uint32_t n = ++_anonymous;
+		bytes[3] = static_cast<uint8_t>(n >> 16);
+		bytes[4] = static_cast<uint8_t>(n >> 8);
+		bytes[5] = static_cast<uint8_t>(n);
+	}
+	else
+	{
+		const auto* in = reinterpret_cast<const sockaddr_in*>(&peer);
+		uint16_t port = ntohs(in->sin_port);
+
+		bytes[2] = 0x7F;
+		bytes[4] = static_cast<uint8_t>(port >> 8);
+		bytes[5] = static_cast<uint8_t>(port);
+	}
+
+	peerAddress = formatAddress(bytes);
+	return sock;
+}
+
+int LoopbackTransport::connect(const std::string& address, uint8_t channel, bool& pending)
+{
+	pending = false;
+
+	uint8_t bytes[6];
+	if (!parseAddress(address, bytes))
+	{
+		LOG_WARN("无效的回环服务器地址: {}", address);
+		return -1;
+	}
+
+	sockaddr_storage storage;
+	socklen_t len = 0;
+	memset(&storage, 0, sizeof(storage));
+
+	if (_kind == Kind::Unix)
+	{
+		auto* addr = reinterpret_cast<sockaddr_un*>(&storage);
+		std::string path = socketPath(address, channel);
+
+		if (path.size() >= sizeof(addr->sun_path))
+		{
+			LOG_ERROR("套接字路径过长 - {}", path);
+			return -1;
+		}
+
+		addr->sun_family = AF_UNIX;
+		strncpy(addr->sun_path, path.c_str(), sizeof(addr->sun_path) - 1);
+		len = sizeof(sockaddr_un);
+	}
+	else
+	{
+		auto* addr = reinterpret_cast<sockaddr_in*>(&storage);
+		addr->sin_family = AF_INET;
+		addr->sin_port = htons(static_cast<uint16_t>((bytes[4] << 8) | bytes[5]));
+
+		if (inet_pton(AF_INET, _options.host.c_str(), &addr->sin_addr) != 1)
+		{
+			LOG_ERROR("无效的回环主机地址 - {}", _options.host);
+			return -1;
+		}
+
+		len = sizeof(sockaddr_in);
+	}
+
+	int sock = socket(_kind == Kind::Unix ? AF_UNIX : AF_INET, SOCK_STREAM, 0);
+	if (sock < 0)
+	{
+		LOG_ERROR("回环客户端内部错误 - {}", strerror(errno));
+		return -1;
+	}
+
+	int flags = fcntl(sock, F_GETFL, 0);
+	if (flags < 0 || fcntl(sock, F_SETFL, flags | O_NONBLOCK) < 0)
+	{
+		LOG_ERROR("回环客户端内部错误 - {}", strerror(errno));
+		close(sock);
+		return -1;
+	}
+
+	if (::connect(sock, (struct sockaddr*)&storage, len) < 0)
+	{
+		if (errno != EINPROGRESS)
+		{
+			LOG_ERROR("回环客户端内部错误(connect) - {}", strerror(errno));
+			close(sock);
+			return -1;
+		}
+
+		pending = true;
+	}
+
+	return sock;
+}
+
+std::string LoopbackTransport::socketPath(const std::string& address, uint8_t channel) const
+{
+	std::string name = address;
+	std::replace(name.begin(), name.end(), ':', '_');
+
+	return _options.path + "/" + name + "_" + std::to_string(channel) + ".sock";
+}
+
+bool LoopbackTransport::addressFromPath(const std::string& path, std::string& address)
+{
+	auto pos = path.find_last_of('/');
+	std::string name = path.substr(pos == std::string::npos ? 0 : pos + 1);
+
+	// AA_BB_CC_DD_EE_FF
+	if (name.size() < 17)
+		return false;
+
+	name.resize(17);
+	std::replace(name.begin(), name.end(), '_', ':');
+
+	uint8_t bytes[6];
+	if (!parseAddress(name, bytes))
+		return false;
+
+	address = formatAddress(bytes);
+	return true;
+}
+
+bool LoopbackTransport::parseAddress(const std::string& address, uint8_t bytes[6])
+{
+	unsigned int b[6];
+
+	if (address.size() != 17 ||
+		sscanf(address.c_str(), "%2x:%2x:%2x:%2x:%2x:%2x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6)
+		return false;
+
+	for (int i = 0; i < 6; ++i)
+		bytes[i] = static_cast<uint8_t>(b[i]);
+
+	return true;
+}
+
+std::string LoopbackTransport::formatAddress(const uint8_t bytes[6])
+{
+	char str[18] = { 0 };
+	snprintf(str,
+			 sizeof(str),
+			 "%02X:%02X:%02X:%02X:%02X:%02X",
+			 bytes[0],
+			 bytes[1],
+			 bytes[2],
+			 bytes[3],
+			 bytes[4],
+			 bytes[5]);
+
+	return std::string(str);
+}
@@ -0,0 +1,66 @@
+#ifndef BLUETOOTH_RFCOMM_LOOPBACK_TRANSPORT_H_
+#define BLUETOOTH_RFCOMM_LOOPBACK_TRANSPORT_H_
+
+#include <bluetooth/rfcomm/transport.h>
+
+#include <atomic>
+
+// 本地回环传输，用于无蓝牙硬件时压测、调试整条数据链路
+//
+// 所有端点以伪 MAC 地址命名：
+//   unix: 监听 <path>/<AA_BB_CC_DD_EE_FF>_<channel>.sock；
+//         对端在 connect 前绑定 <path>/<AA_BB_CC_DD_EE_FF>.sock 即以该地址出现，
+//         未绑定时分配 02:00:00:xx:xx:xx
+//   tcp:  服务端监听 host:(basePort + channel)，对端命名为 02:00:7F:00:<端口高位>:<端口低位>；
+//         连接设备时端口取地址末两个字节
+class LoopbackTransport : public Transport
+{
+public:
+	enum class Kind
+	{
+		Unix,
+		Tcp
+	};
+
+	LoopbackTransport(Kind kind, const Transport::Options& options);
+
+	const char* name() const override { return _kind == Kind::Unix ? "unix" : "tcp"; }
+
+	bool requiresPairing() const override { return false; }
+
+	bool registerService(const std::string& serviceName,
+						 const std::string& serviceUUID,
+						 uint8_t& channel,
+						 uint32_t& handle) override;
+
+	void unregisterService(uint32_t handle) override {}
+
+	bool resolveChannel(const std::string& address, uint8_t& channel) override;
+
+	int listen(uint8_t channel, int backlog) override;
+
+	int accept(int listenSocket, std::string& peerAddress) override;
+
+	int connect(const std::string& address, uint8_t channel, bool& pending) override;
+
+	std::string localAddress() const override { return _options.localAddress; }
+
+	std::string socketAddress(int socket) const override { return _options.localAddress; }
+
+private:
+	std::string socketPath(const std::string& address, uint8_t channel) const;
+
+	// 解析 unix 对端绑定路径中的地址
+	static bool addressFromPath(const std::string& path, std::string& address);
+
+	static bool parseAddress(const std::string& address, uint8_t bytes[6]);
+
+	static std::string formatAddress(const uint8_t bytes[6]);
+
+private:
+	Kind _kind;
+	Transport::Options _options;
+	std::atomic<uint32_t> _anonymous;
+};
+
+#endif // BLUETOOTH_RFCOMM_LOOPBACK_TRANSPORT_H_
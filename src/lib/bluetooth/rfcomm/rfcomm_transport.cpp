@@ -0,0 +1,183 @@
+#include <bluetooth/rfcomm/rfcomm_transport.h>
+#include <bluetooth/rfcomm/sdp.h>
+#include <utils/logger.h>
+
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/socket.h>
+
+#include <bluetooth/bluetooth.h>
+#include <bluetooth/rfcomm.h>
+#include <bluetooth/hci.h>
+#include <bluetooth/hci_lib.h>
+
+namespace {
+
+	std::string bdaddrToString(const bdaddr_t& bdaddr)
+	{
+		char str[19] = { 0 };
+		ba2str(&bdaddr, str);
+		return std::string(str);
+	}
+}
+
+bool RfcommTransport::registerService(const std::string& serviceName,
+									  const std::string& serviceUUID,
+									  uint8_t& channel,
+									  uint32_t& handle)
+{
+	if (channel == 0)
+	{
+		// 本地已有 SPP 记录时沿用其通道
+		uint8_t rfcommChannel = 0;
+		if (sdp::findAvailableSPPChannel("local", rfcommChannel) && rfcommChannel != 0)
+		{
+			channel = rfcommChannel;
+			return true;
+		}
+
+		channel = 1; // 默认通道
+	}
+	else if (handle)
+		return true;
+
+	return sdp::registerSPPService(serviceName, serviceUUID, channel, handle);
+}
+
+void RfcommTransport::unregisterService(uint32_t handle)
+{
+	if (handle)
+		sdp::unregisterSPPService(handle);
+}
+
+bool RfcommTransport::resolveChannel(const std::string& address, uint8_t& channel)
+{
+	return sdp::findAvailableSPPChannel(address, channel);
+}
+
+int RfcommTransport::listen(uint8_t channel, int backlog)
+{
+	int sock = socket(AF_BLUETOOTH, SOCK_STREAM, BTPROTO_RFCOMM);
+	if (sock < 0)
+	{
+		LOG_ERROR("RFCOMM 服务器内部错误 - {}", strerror(errno));
+		return -1;
+	}
+
+	// 设置套接字选项(重用地址)
+	int reuse = 1;
+	if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0)
+	{
+		LOG_ERROR("RFCOMM 服务器内部错误 - {}", strerror(errno));
+		close(sock);
+		return -1;
+	}
+
+	// 绑定地址
+	sockaddr_rc addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.rc_family = AF_BLUETOOTH;
+	addr.rc_bdaddr = { { 0, 0, 0, 0, 0, 0 } };
+	addr.rc_channel = channel;
+
+	if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+	{
+		LOG_ERROR("RFCOMM 服务器内部错误(bind) - {}", strerror(errno));
+		close(sock);
+		return -1;
+	}
+
+	if (::listen(sock, backlog) < 0)
+	{
+		LOG_ERROR("RFCOMM 服务器内部错误(listen) - {}", strerror(errno));
+		close(sock);
+		return -1;
+	}
+
+	return sock;
+}
+
+int RfcommTransport::accept(int listenSocket, std::string& peerAddress)
+{
+	sockaddr_rc clientAddr;
+	socklen_t len = sizeof(clientAddr);
+
+	int sock = ::accept(listenSocket, (struct sockaddr*)&clientAddr, &len);
+	if (sock >= 0)
+		peerAddress = bdaddrToString(clientAddr.rc_bdaddr);
+
+	return sock;
+}
+
+int RfcommTransport::connect(const std::string& address, uint8_t channel, bool& pending)
+{
+	pending = false;
+
+	sockaddr_rc addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.rc_family = AF_BLUETOOTH;
+	addr.rc_channel = channel;
+
+	if (str2ba(address.c_str(), &addr.rc_bdaddr) != 0)
+	{
+		LOG_WARN("无效的 RFCOMM 服务器地址: {}", address);
+		return -1;
+	}
+
+	int sock = socket(AF_BLUETOOTH, SOCK_STREAM, BTPROTO_RFCOMM);
+	if (sock < 0)
+	{
+		LOG_ERROR("RFCOMM 客户端内部错误 - {}", strerror(errno));
+		return -1;
+	}
+
+	// 设置非阻塞模式
+	int flags = fcntl(sock, F_GETFL, 0);
+	if (flags < 0 || fcntl(sock, F_SETFL, flags | O_NONBLOCK) < 0)
+	{
+		LOG_ERROR("RFCOMM 客户端内部错误 - {}", strerror(errno));
+		close(sock);
+		return -1;
+	}
+
+	if (::connect(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+	{
+		if (errno != EINPROGRESS)
+		{
+			LOG_ERROR("RFCOMM 客户端内部错误(connect) - {}", strerror(errno));
+			close(sock);
+			return -1;
+		}
+
+		pending = true;
+	}
+
+	return sock;
+}
+
+std::string RfcommTransport::localAddress() const
+{
+	bdaddr_t bdaddr;
+
+	if (hci_devba(0, &bdaddr) < 0)
+		return "Unknown";
+
+	return bdaddrToString(bdaddr);
+}
+
+std::string RfcommTransport::socketAddress(int socket) const
+{
+	sockaddr_rc localAddr;
+	socklen_t len = sizeof(localAddr);
+
+	if (getsockname(socket, (struct sockaddr*)&localAddr, &len) < 0)
+	{
+		LOG_ERROR("RFCOMM 客户端内部错误 - {}", strerror(errno));
+		return "未知";
+	}
+
+	return bdaddrToString(localAddr.rc_bdaddr);
+}
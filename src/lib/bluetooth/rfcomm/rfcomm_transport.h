@@ -0,0 +1,34 @@
+#ifndef BLUETOOTH_RFCOMM_RFCOMM_TRANSPORT_H_
+#define BLUETOOTH_RFCOMM_RFCOMM_TRANSPORT_H_
+
+#include <bluetooth/rfcomm/transport.h>
+
+// 基于 AF_BLUETOOTH/BTPROTO_RFCOMM 的传输，服务记录通过 SDP 注册、查询
+class RfcommTransport : public Transport
+{
+public:
+	const char* name() const override { return "rfcomm"; }
+
+	bool requiresPairing() const override { return true; }
+
+	bool registerService(const std::string& serviceName,
+						 const std::string& serviceUUID,
+						 uint8_t& channel,
+						 uint32_t& handle) override;
+
+	void unregisterService(uint32_t handle) override;
+
+	bool resolveChannel(const std::string& address, uint8_t& channel) override;
+
+	int listen(uint8_t channel, int backlog) override;
+
+	int accept(int listenSocket, std::string& peerAddress) override;
+
+	int connect(const std::string& address, uint8_t channel, bool& pending) override;
+
+	std::string localAddress() const override;
+
+	std::string socketAddress(int socket) const override;
+};
+
+#endif // BLUETOOTH_RFCOMM_RFCOMM_TRANSPORT_H_
@@ -1,12 +1,15 @@
 #include <bluetooth/rfcomm/server.h>
-#include <bluetooth/rfcomm/sdp.h>
+#include <bluetooth/rfcomm/rfcomm_transport.h>
 #include <utils/logger.h>
 
 #include <sstream>
 
 #include <cctype>
+#include <cstring>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/select.h>
+#include <sys/socket.h>
 
 // SPP UUID定义 (00001101-0000-1000-8000-00805F9B34FB)
 const char* BluetoothServer::SPP_UUID = "00001101-0000-1000-8000-00805F9B34FB";
@@ -20,11 +23,15 @@ BluetoothServer::BluetoothServer(const std::string& name, uint8_t channel)
 	  _bufferSize(1024),
 	  _acceptTimeout(1000),
 	  _recvTimeout(1000),
+	  _listenMode(false),
 	  _running(false),
+	  _transport(std::make_shared<RfcommTransport>()),
 	  _nextClientId(1),
 	  _clientConnectCallback(nullptr),
 	  _clientDisconnectCallback(nullptr),
 	  _dataReceivedCallback(nullptr),
+	  _bufferPool(nullptr),
+	  _downlinkStats(nullptr),
 	  _sdp_handle(0)
 {
 	// 设置默认回调
@@ -36,36 +43,17 @@ BluetoothServer::BluetoothServer(const std::string& name, uint8_t channel)
 		LOG_INFO("已断开: {}/{} -> {}", id, addr, getLocalAddress());
 	};
 
-	_dataReceivedCallback = [](const std::string& address, const uint8_t* data, size_t size) {
-		LOG_INFO("已接收: {}/{} BYTES -> SERVER", address, size);
+	_dataReceivedCallback = [](const std::string& address, const BufferSlice& frame) {
+		LOG_INFO("已接收: {}/{} BYTES -> SERVER", address, frame.size());
 	};
-
-	if (_channel == 0)
-	{
-		// 查找RFCOMM通道
-		uint8_t rfcommChannel = 0;
-		if (sdp::findAvailableSPPChannel("local", rfcommChannel) && rfcommChannel != 0)
-		{
-			_channel = rfcommChannel;
-		}
-		else
-		{
-			_channel = 1; // 默认通道
-			sdp::registerSPPService(_serverName, SPP_UUID, _channel, _sdp_handle);
-		}
-	}
-	else
-	{
-		sdp::registerSPPService(_serverName, SPP_UUID, _channel, _sdp_handle);
-	}
 }
 
 BluetoothServer::~BluetoothServer()
 {
-	if (_sdp_handle)
-		sdp::unregisterSPPService(_sdp_handle);
-
 	stop();
+
+	if (_sdp_handle)
+		_transport->unregisterService(_sdp_handle);
 }
 
 bool BluetoothServer::start()
@@ -76,52 +64,23 @@ bool BluetoothServer::start()
 		return false;
 	}
 
-	// 创建套接字
-	_srvSocket = socket(AF_BLUETOOTH, SOCK_STREAM, BTPROTO_RFCOMM);
-	if (_srvSocket < 0)
+	if (!_listenMode)
 	{
-		close(_srvSocket);
-		_srvSocket = -1;
+		// 连接由 BlueZ Profile1 交入，无需监听
+		_running = true;
 
-		LOG_ERROR("RFCOMM 服务器内部错误 - {}", strerror(errno));
-		return false;
+		LOG_INFO("RFCOMM服务({}) 已启动(Profile)", _serverName);
+		return true;
 	}
 
-	// 设置套接字选项(重用地址)
-	int reuse = 1;
-	if (setsockopt(_srvSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0)
-	{
-		close(_srvSocket);
-		_srvSocket = -1;
-
-		LOG_ERROR("RFCOMM 服务器内部错误 - {}", strerror(errno));
-		return false;
-	}
+	// 注册服务记录(RFCOMM 下为 SDP)
+	if (!_transport->registerService(_serverName, SPP_UUID, _channel, _sdp_handle))
+		LOG_WARN("RFCOMM服务({}) 注册服务记录失败", _serverName);
 
-	// 绑定地址
-	sockaddr_rc addr;
-	addr.rc_family = AF_BLUETOOTH;
-	addr.rc_bdaddr = { { 0, 0, 0, 0, 0, 0 } };
-	addr.rc_channel = _channel;
-
-	if (bind(_srvSocket, (struct sockaddr*)&addr, sizeof(addr)) < 0)
-	{
-		close(_srvSocket);
-		_srvSocket = -1;
-
-		LOG_ERROR("RFCOMM 服务器内部错误(bind) - {}", strerror(errno));
-		return false;
-	}
-
-	// 开始监听
-	if (listen(_srvSocket, 1) < 0)
-	{
-		close(_srvSocket);
-		_srvSocket = -1;
-
-		LOG_ERROR("RFCOMM 服务器内部错误(listen) - {}", strerror(errno));
+	// 创建监听套接字
+	_srvSocket = _transport->listen(_channel, 1);
+	if (_srvSocket < 0)
 		return false;
-	}
 
 	// 设置非阻塞模式，以便在停止服务器时能及时退出
 	int flags = fcntl(_srvSocket, F_GETFL, 0);
@@ -174,9 +133,6 @@ void BluetoothServer::acceptThread()
 {
 	while (_running)
 	{
-		struct sockaddr_rc clientAddr;
-		socklen_t len = sizeof(clientAddr);
-
 		// 使用select实现带超时的accept
 		fd_set readFds;
 		FD_ZERO(&readFds);
@@ -205,7 +161,8 @@ void BluetoothServer::acceptThread()
 
 		if (FD_ISSET(_srvSocket, &readFds))
 		{
-			int clientSocket = accept(_srvSocket, (struct sockaddr*)&clientAddr, &len);
+			std::string clientAddr;
+			int clientSocket = _transport->accept(_srvSocket, clientAddr);
 
 			if (clientSocket < 0)
 			{
@@ -215,27 +172,7 @@ void BluetoothServer::acceptThread()
 				continue;
 			}
 
-			// 获取客户端信息
-			int clientId = getNextClientId();
-			auto clientInfo = std::make_unique<ClientInfo>();
-			clientInfo->socket = clientSocket;
-			clientInfo->address = bdaddrToString(clientAddr);
-			clientInfo->running = true;
-			clientInfo->connectTime = std::chrono::steady_clock::now();
-
-			// 保存客户端信息
-			{
-				std::lock_guard<std::mutex> lock(_clientsMutex);
-				_clients[clientId] = std::move(clientInfo);
-			}
-
-			// 启动客户端线程
-			auto& info = _clients[clientId];
-			info->workThread =
-				std::thread(&BluetoothServer::clientThread, this, clientId, info.get());
-
-			// 调用连接回调
-			_clientConnectCallback(clientId, info->address);
+			attachClient(clientSocket, clientAddr);
 
 			// 发送欢迎消息
 			// std::string welcome =
@@ -245,6 +182,60 @@ void BluetoothServer::acceptThread()
 	}
 }
 
+int BluetoothServer::attachClient(int socket, const std::string& address)
+{
+	if (!_running)
+	{
+		LOG_WARN("RFCOMM 服务器未运行，拒绝连接 - {}", address);
+		close(socket);
+		return -1;
+	}
+
+	// 使用阻塞模式，由接收超时控制线程退出
+	int flags = fcntl(socket, F_GETFL, 0);
+	if (flags >= 0 && (flags & O_NONBLOCK))
+		fcntl(socket, F_SETFL, flags & ~O_NONBLOCK);
+
+	// 获取客户端信息
+	auto clientInfo = std::make_unique<ClientInfo>();
+	clientInfo->socket = socket;
+	clientInfo->address = address;
+	clientInfo->running = true;
+	clientInfo->connectTime = std::chrono::steady_clock::now();
+	clientInfo->session = std::make_shared<Session>(
+		address, Session::Role::Inbound, socket, _downlinkOptions, _downlinkStats);
+
+	int clientId = 0;
+	ClientInfo* info = clientInfo.get();
+
+	// 保存客户端信息并启动客户端线程
+	{
+		std::lock_guard<std::mutex> lock(_clientsMutex);
+		clientId = getNextClientId();
+		info->session->setCloseHandler([this, clientId]() { disconnectClient(clientId); });
+		_clients[clientId] = std::move(clientInfo);
+		info->workThread = std::thread(&BluetoothServer::clientThread, this, clientId, info);
+	}
+
+	// 调用连接回调
+	_clientConnectCallback(clientId, address);
+
+	return clientId;
+}
+
+int BluetoothServer::findClient(const std::string& address) const
+{
+	std::lock_guard<std::mutex> lock(_clientsMutex);
+
+	for (const auto& [id, client] : _clients)
+	{
+		if (client->address == address && client->running)
+			return id;
+	}
+
+	return -1;
+}
+
 
 void BluetoothServer::clientThread(int clientId, ClientInfo* clientInfo)
 {
@@ -262,16 +253,25 @@ void BluetoothServer::clientThread(int clientId, ClientInfo* clientInfo)
 	setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof tv);
 
 	int bufferSize = std::max(_bufferSize, 1024);
-	std::vector<uint8_t> buffer(bufferSize, 0);
+
+	// 接收数据直接写入分帧缓冲区，按完整帧回调
+	FrameAssembler assembler(_decoderFactory ? _decoderFactory(clientAddr) : nullptr,
+							 bufferSize * 2,
+							 _bufferPool);
+	auto onFrame = [&](const BufferSlice& frame) { _dataReceivedCallback(clientInfo->address, frame); };
 
 	while (clientInfo->running && _running)
 	{
-		ssize_t received = recv(clientSocket, buffer.data(), bufferSize, 0);
+		// 上行积压时暂停读取，数据留在内核与 RFCOMM 窗口中反压设备
+		if (_readGate && !_readGate(clientAddr))
+			continue;
+
+		ssize_t received = recv(clientSocket, assembler.prepare(bufferSize), bufferSize, 0);
 
 		if (received > 0)
 		{
 			// 调用数据接受回调
-			_dataReceivedCallback(clientInfo->address, buffer.data(), received);
+			assembler.commit(static_cast<size_t>(received), onFrame);
 		}
 		else if (received == 0)
 		{
@@ -290,27 +290,38 @@ void BluetoothServer::clientThread(int clientId, ClientInfo* clientInfo)
 		}
 	}
 
+	if (assembler.pending() > 0 || assembler.dropped() > 0)
+		LOG_WARN("{} 断开时丢弃不完整帧 {} 字节，失步丢弃 {} 字节",
+				 clientAddr,
+				 assembler.pending(),
+				 assembler.dropped());
+
 	// 开启短线程断开连接
 	std::thread([this, clientId]() { disconnectClient(clientId); }).detach();
 }
 
 ssize_t BluetoothServer::sendToClient(int clientId, const std::vector<uint8_t>& data)
 {
-	std::lock_guard<std::mutex> lock(_clientsMutex);
+	std::shared_ptr<Session> session = getSession(clientId);
 
-	auto it = _clients.find(clientId);
-	if (it == _clients.end() || !it->second->running)
+	if (!session)
 	{
 		LOG_WARN("客户端未连接到 RFCOMM 服务器");
 		return -1;
 	}
 
-	ssize_t bytesSent = send(it->second->socket, data.data(), data.size(), 0);
+	return session->send(data);
+}
+
+std::shared_ptr<Session> BluetoothServer::getSession(int clientId) const
+{
+	std::lock_guard<std::mutex> lock(_clientsMutex);
 
-	if (bytesSent < 0)
-		LOG_ERROR("RFCOMM 服务器内部错误(send) - {}", strerror(errno));
+	auto it = _clients.find(clientId);
+	if (it == _clients.end() || !it->second->running)
+		return nullptr;
 
-	return bytesSent;
+	return it->second->session;
 }
 
 size_t BluetoothServer::broadcast(const std::string& data)
@@ -351,6 +362,9 @@ void BluetoothServer::disconnectClient(int clientId)
 	{
 		clientInfo->running = false;
 
+		// 写出剩余下行数据，须在关闭套接字之前
+		clientInfo->session->shutdown();
+
 		// 关闭套接字以中断recv调用
 		if (clientInfo->socket >= 0)
 			close(clientInfo->socket);
@@ -398,31 +412,7 @@ std::string BluetoothServer::getClientInfo(int clientId) const
 	return ss.str();
 }
 
-std::string BluetoothServer::getLocalAddress() const
-{
-	char addrBuf[19] = { 0 };
-	bdaddr_t bdaddr;
-
-	if (hci_devba(0, &bdaddr) < 0)
-	{
-		return "Unknown";
-	}
-
-	ba2str(&bdaddr, addrBuf);
-	return std::string(addrBuf);
-}
+std::string BluetoothServer::getLocalAddress() const { return _transport->localAddress(); }
 
 
 int BluetoothServer::getNextClientId() { return _nextClientId++; }
-
-std::string BluetoothServer::bdaddrToString(const sockaddr_rc& addr)
-{
-	char addr_str[19] = { 0 };
-	ba2str(&addr.rc_bdaddr, addr_str);
-	return std::string(addr_str);
-}
-
-bool BluetoothServer::stringTobaddr(const std::string& str, bdaddr_t& bdaddr)
-{
-	return str2ba(str.c_str(), &bdaddr) == 0;
-}
\ No newline at end of file
@@ -11,20 +11,22 @@
 #include <vector>
 #include <unordered_map>
 
-#include <bluetooth/bluetooth.h>
-#include <bluetooth/rfcomm.h>
-#include <bluetooth/hci.h>
-#include <bluetooth/hci_lib.h>
+#include <sys/types.h>
 
-struct sockaddr_rc;
+#include <bluetooth/rfcomm/downlink_writer.h>
+#include <bluetooth/rfcomm/frame_decoder.h>
+#include <bluetooth/rfcomm/session.h>
+#include <bluetooth/rfcomm/transport.h>
 
 class BluetoothServer
 {
 public:
 	// 回调函数类型定义
 	using ClientCallback = std::function<void(int, const std::string&)>;
-	using DataCallback = std::function<void(const std::string&, const uint8_t*, size_t)>;
+	using DataCallback = std::function<void(const std::string&, const BufferSlice&)>;
 	using ErrorCallback = std::function<void(int, const std::string&)>;
+	using DecoderFactory = std::function<std::unique_ptr<FrameDecoder>(const std::string&)>;
+	using ReadGate = std::function<bool(const std::string&)>;
 
 	// SPP服务UUID (00001101-0000-1000-8000-00805F9B34FB)
 	static const char* SPP_UUID;
@@ -37,6 +39,7 @@ public:
 		std::thread workThread;
 		std::atomic<bool> running;
 		std::chrono::time_point<std::chrono::steady_clock> connectTime;
+		std::shared_ptr<Session> session; // 发送经由会话，不经过服务器的锁
 	};
 
 	explicit BluetoothServer(const std::string& name = "Bluetooth SPP Server", uint8_t channel = 1);
@@ -48,14 +51,24 @@ public:
 	BluetoothServer& operator=(const BluetoothServer&) = delete;
 	BluetoothServer& operator=(BluetoothServer&&) = delete;
 
+	// 启动服务；监听模式下自行注册SDP记录并接受连接，否则只接收 attachClient 交入的连接
 	bool start();
 
 	void stop();
 
 	bool isRunning() const { return _running; }
 
+	// 接管已建立的连接(如 BlueZ Profile1 NewConnection 传入的文件描述符)，返回客户端ID
+	int attachClient(int socket, const std::string& address);
+
+	// 根据设备地址查找客户端ID，未找到时返回 -1
+	int findClient(const std::string& address) const;
+
 	ssize_t sendToClient(int clientId, const std::vector<uint8_t>& data);
 
+	// 客户端的会话，可脱离服务器直接发送；未找到时返回空
+	std::shared_ptr<Session> getSession(int clientId) const;
+
 	size_t broadcast(const std::string& data);
 
 	void disconnectClient(int clientId);
@@ -79,12 +92,44 @@ public:
 		_dataReceivedCallback = std::move(callback);
 	}
 
+	// 按设备地址创建分帧器，未设置时每次接收的数据作为一帧
+	void setDecoderFactory(DecoderFactory factory) { _decoderFactory = std::move(factory); }
+
+	// 接收缓冲区来源，未设置时从堆上分配
+	void setBufferPool(BufferPool* pool) { _bufferPool = pool; }
+
+	BufferPool* getBufferPool() const { return _bufferPool; }
+
+	// 下行写入方式与统计，需在 start 之前调用；stats 可为空
+	void setDownlink(const DownlinkWriter::Options& options, DownlinkStats* stats)
+	{
+		_downlinkOptions = options;
+		_downlinkStats = stats;
+	}
+
+	const DownlinkWriter::Options& getDownlinkOptions() const { return _downlinkOptions; }
+
+	DownlinkStats* getDownlinkStats() const { return _downlinkStats; }
+
+	// 读线程每次 recv 前调用，返回 false 时本轮不读取(上行反压)，由回调自行限时等待
+	void setReadGate(ReadGate gate) { _readGate = std::move(gate); }
+
 	void setBufferSize(int size) { _bufferSize = size; }
 
 	void setAcceptTimeout(int milliseconds) { _acceptTimeout = milliseconds; }
 
 	void setRecvTimeout(int milliseconds) { _recvTimeout = milliseconds; }
 
+	// 是否使用旧的 SDP 注册 + accept 监听方式(需要 bluetoothd --compat)
+	void setListenMode(bool listen) { _listenMode = listen; }
+
+	bool isListenMode() const { return _listenMode; }
+
+	// 设置传输层，默认为 RFCOMM；需在 start 之前调用
+	void setTransport(std::shared_ptr<Transport> transport) { _transport = std::move(transport); }
+
+	const std::shared_ptr<Transport>& getTransport() const { return _transport; }
+
 	std::string getLocalAddress() const;
 
 	uint8_t getChannel() const { return _channel; }
@@ -94,10 +139,6 @@ private:
 	void clientThread(int clientId, ClientInfo* client);
 	int getNextClientId();
 
-	// 蓝牙地址转换
-	static std::string bdaddrToString(const sockaddr_rc& addr);
-	static bool stringTobaddr(const std::string& str, bdaddr_t& addr);
-
 private:
 	// 服务器配置
 	std::string _serverName;
@@ -106,7 +147,9 @@ private:
 	int _bufferSize;
 	int _acceptTimeout;
 	int _recvTimeout;
+	bool _listenMode;
 	std::atomic<bool> _running;
+	std::shared_ptr<Transport> _transport;
 
 	// 客户端管理
 	mutable std::mutex _clientsMutex;
@@ -120,6 +163,11 @@ private:
 	ClientCallback _clientConnectCallback;
 	ClientCallback _clientDisconnectCallback;
 	DataCallback _dataReceivedCallback;
+	DecoderFactory _decoderFactory;
+	ReadGate _readGate;
+	BufferPool* _bufferPool;
+	DownlinkWriter::Options _downlinkOptions;
+	DownlinkStats* _downlinkStats;
 
 	uint32_t _sdp_handle;
 };
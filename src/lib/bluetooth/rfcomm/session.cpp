@@ -0,0 +1,243 @@
+#include <bluetooth/rfcomm/session.h>
+#include <utils/logger.h>
+
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+
+//////////////////////////////////////////////////////////////////////////////////
+Session::Session(const std::string& address,
+				 Role role,
+				 int socket,
+				 const DownlinkWriter::Options& options,
+				 DownlinkStats* stats)
+	: _address(address),
+	  _role(role),
+	  _socket(socket),
+	  _stats(stats),
+	  _connectTime(std::chrono::steady_clock::now()),
+	  _open(true)
+{
+	if (options.coalesce)
+		_writer = std::make_unique<DownlinkWriter>(socket, address, options, stats);
+}
+
+Session::~Session() { shutdown(); }
+
+ssize_t Session::send(std::vector<uint8_t> data)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (!_open)
+	{
+		LOG_WARN("{} 会话已关闭，无法发送", _address);
+		return -1;
+	}
+
+	// 合并写入时只入队，由写线程写出
+	if (_writer)
+	{
+		size_t size = data.size();
+		return _writer->write(std::move(data)) ? static_cast<ssize_t>(size) : -1;
+	}
+
+	return sendDirect(data.data(), data.size());
+}
+
+ssize_t Session::send(Buffer data)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (!_open)
+	{
+		LOG_WARN("{} 会话已关闭，无法发送", _address);
+		return -1;
+	}
+
+	if (_writer)
+	{
+		size_t size = data.size();
+		return _writer->write(std::move(data)) ? static_cast<ssize_t>(size) : -1;
+	}
+
+	return sendDirect(data.data(), data.size());
+}
+
+ssize_t Session::sendDirect(const uint8_t* data, size_t size)
+{
+	ssize_t sent = ::send(_socket, data, size, 0);
+
+	if (sent < 0)
+	{
+		LOG_ERROR("RFCOMM 发送失败(send) - {} - {}", _address, strerror(errno));
+
+		if (_stats)
+			_stats->recordError();
+
+		return -1;
+	}
+
+	if (_stats)
+		_stats->record(1, 1, static_cast<uint64_t>(sent));
+
+	return sent;
+}
+
+ssize_t Session::write(const uint8_t* data, size_t size, std::chrono::milliseconds timeout)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (!_open)
+		return -1;
+
+	if (_writer)
+		return _writer->tryWrite(data, size);
+
+	struct pollfd pfd = { _socket, POLLOUT, 0 };
+	int rc = poll(&pfd, 1, static_cast<int>(timeout.count()));
+
+	if (rc == 0 || (rc < 0 && errno == EINTR))
+		return 0;
+
+	if (rc < 0 || (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)))
+	{
+		LOG_ERROR("RFCOMM 连接不可写 - {}", _address);
+		return -1;
+	}
+
+	ssize_t sent = ::send(_socket, data, size, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+	if (sent < 0)
+	{
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			return 0;
+
+		LOG_ERROR("RFCOMM 发送失败(send) - {} - {}", _address, strerror(errno));
+
+		if (_stats)
+			_stats->recordError();
+
+		return -1;
+	}
+
+	if (_stats)
+		_stats->record(1, 1, static_cast<uint64_t>(sent));
+
+	return sent;
+}
+
+void Session::close()
+{
+	CloseHandler handler;
+
+	{
+		std::lock_guard<std::mutex> lock(_closeMutex);
+		handler = _closeHandler;
+	}
+
+	if (_open && handler)
+		handler();
+}
+
+void Session::setCloseHandler(CloseHandler handler)
+{
+	std::lock_guard<std::mutex> lock(_closeMutex);
+	_closeHandler = std::move(handler);
+}
+
+void Session::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		_open = false;
+		_writer.reset();
+	}
+
+	std::lock_guard<std::mutex> lock(_closeMutex);
+	_closeHandler = nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+void SessionRegistry::add(std::shared_ptr<Session> session, std::shared_ptr<void> owner)
+{
+	if (!session)
+		return;
+
+	std::vector<std::shared_ptr<void>> retired;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		Entry& entry = _sessions[session->address()];
+		if (entry.owner)
+			_retired.push_back(std::move(entry.owner));
+
+		entry.session = std::move(session);
+		entry.owner = std::move(owner);
+
+		retired.swap(_retired);
+	}
+
+	// 在锁外释放，所有者析构时可能回调到 removeClosed
+}
+
+std::shared_ptr<Session> SessionRegistry::find(const std::string& address) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto it = _sessions.find(address);
+	return it != _sessions.end() ? it->second.session : nullptr;
+}
+
+void SessionRegistry::removeClosed(const std::string& address)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto it = _sessions.find(address);
+	if (it == _sessions.end() || it->second.session->isOpen())
+		return;
+
+	// 通常在所有者自身的断开回调中调用，不能在此析构
+	if (it->second.owner)
+		_retired.push_back(std::move(it->second.owner));
+
+	_sessions.erase(it);
+}
+
+void SessionRegistry::clear()
+{
+	std::unordered_map<std::string, Entry> sessions;
+	std::vector<std::shared_ptr<void>> retired;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		sessions.swap(_sessions);
+		retired.swap(_retired);
+	}
+
+	sessions.clear();
+	retired.clear();
+}
+
+Json::Value SessionRegistry::getStats() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	uint64_t inbound = 0;
+	uint64_t outbound = 0;
+
+	for (const auto& [address, entry] : _sessions)
+	{
+		if (entry.session->role() == Session::Role::Inbound)
+			++inbound;
+		else
+			++outbound;
+	}
+
+	Json::Value root;
+	root["inbound"] = static_cast<Json::UInt64>(inbound);
+	root["outbound"] = static_cast<Json::UInt64>(outbound);
+	return root;
+}
@@ -0,0 +1,130 @@
+#ifndef BLUETOOTH_RFCOMM_SESSION_H_
+#define BLUETOOTH_RFCOMM_SESSION_H_
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/types.h>
+
+#include <json/json.h>
+
+#include <bluetooth/rfcomm/downlink_writer.h>
+
+// 设备串口会话：一条已建立的连接，无论由设备连入(服务端)还是桥接主动连接(客户端)
+//
+// 发送直接写入该连接(合并写入时入队)，只使用会话自身的锁；连接的建立和清理仍由
+// BluetoothServer/BluetoothClient 负责。
+class Session
+{
+public:
+	enum class Role
+	{
+		Inbound,  // 设备连入桥接的 RFCOMM 服务
+		Outbound  // 桥接主动连接设备
+	};
+
+	using CloseHandler = std::function<void()>;
+
+	Session(const std::string& address,
+			Role role,
+			int socket,
+			const DownlinkWriter::Options& options,
+			DownlinkStats* stats);
+
+	~Session();
+
+	Session(const Session&) = delete;
+	Session& operator=(const Session&) = delete;
+
+	const std::string& address() const { return _address; }
+
+	Role role() const { return _role; }
+
+	bool isOpen() const { return _open; }
+
+	std::chrono::steady_clock::time_point connectTime() const { return _connectTime; }
+
+	// 发送数据，返回写入(或入队)的字节数，会话已关闭时返回 -1
+	ssize_t send(std::vector<uint8_t> data);
+
+	// 同上，合并写入时缓冲区随队列保留到写出，不复制数据
+	ssize_t send(Buffer data);
+
+	// 流式写入：等待连接可写最多 timeout，返回写入(或入队)的字节数，可能少于 size；
+	// 发送缓冲区或合并队列已满时返回 0，会话已关闭或写入失败时返回 -1
+	ssize_t write(const uint8_t* data, size_t size, std::chrono::milliseconds timeout);
+
+	// 请求断开连接，由连接所有者完成清理
+	void close();
+
+	// 以下由连接所有者调用
+	void setCloseHandler(CloseHandler handler);
+
+	// 写出剩余数据并停止发送，须在关闭套接字之前调用
+	void shutdown();
+
+private:
+	// 未启用合并写入时直接写套接字，调用方持有 _mutex
+	ssize_t sendDirect(const uint8_t* data, size_t size);
+
+private:
+	std::string _address;
+	Role _role;
+	int _socket;
+	DownlinkStats* _stats;
+	std::chrono::steady_clock::time_point _connectTime;
+	std::atomic<bool> _open;
+
+	std::mutex _mutex; // 保护发送与写线程
+	std::unique_ptr<DownlinkWriter> _writer;
+
+	std::mutex _closeMutex;
+	CloseHandler _closeHandler;
+};
+
+// 按设备地址登记的会话表，两个方向的连接共用
+//
+// owner 为随会话保留的连接对象(如主动连接时创建的 BluetoothClient)。会话断开后其
+// 所有者可能仍在自己的断开流程中，先移入待释放列表，在下次登记或清空时释放。
+class SessionRegistry
+{
+public:
+	SessionRegistry() = default;
+
+	~SessionRegistry() { clear(); }
+
+	SessionRegistry(const SessionRegistry&) = delete;
+	SessionRegistry& operator=(const SessionRegistry&) = delete;
+
+	// 登记会话，替换该地址已有的会话
+	void add(std::shared_ptr<Session> session, std::shared_ptr<void> owner = nullptr);
+
+	std::shared_ptr<Session> find(const std::string& address) const;
+
+	// 移除该地址已关闭的会话，仍在使用的(如同一设备的新连接)保持不变
+	void removeClosed(const std::string& address);
+
+	// 移除全部会话并释放所有者，调用方不得持有会被所有者析构回调使用的锁
+	void clear();
+
+	Json::Value getStats() const;
+
+private:
+	struct Entry
+	{
+		std::shared_ptr<Session> session;
+		std::shared_ptr<void> owner;
+	};
+
+	mutable std::mutex _mutex;
+	std::unordered_map<std::string, Entry> _sessions;
+	std::vector<std::shared_ptr<void>> _retired;
+};
+
+#endif // BLUETOOTH_RFCOMM_SESSION_H_
@@ -0,0 +1,18 @@
+#include <bluetooth/rfcomm/transport.h>
+#include <bluetooth/rfcomm/rfcomm_transport.h>
+#include <bluetooth/rfcomm/loopback_transport.h>
+#include <utils/logger.h>
+
+std::shared_ptr<Transport> Transport::create(const Options& options)
+{
+	if (options.type == "unix")
+		return std::make_shared<LoopbackTransport>(LoopbackTransport::Kind::Unix, options);
+
+	if (options.type == "tcp")
+		return std::make_shared<LoopbackTransport>(LoopbackTransport::Kind::Tcp, options);
+
+	if (options.type != "rfcomm")
+		LOG_WARN("未知的传输类型 - {}，使用 rfcomm", options.type);
+
+	return std::make_shared<RfcommTransport>();
+}
@@ -0,0 +1,58 @@
+#ifndef BLUETOOTH_RFCOMM_TRANSPORT_H_
+#define BLUETOOTH_RFCOMM_TRANSPORT_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// 串口传输层：封装套接字创建、寻址和对端命名，
+// 使 BluetoothServer/BluetoothClient 可以运行在 RFCOMM 或本地回环套接字之上
+class Transport
+{
+public:
+	struct Options
+	{
+		std::string type = "rfcomm";				 // rfcomm | unix | tcp
+		std::string path = "/tmp/bluetooth-bridge"; // unix: 套接字目录
+		std::string host = "127.0.0.1";			 // tcp: 主机地址
+		int basePort = 20000;						 // tcp: 服务端端口 = basePort + channel
+		std::string localAddress = "02:00:00:00:00:01"; // 回环传输下本端的伪 MAC 地址
+	};
+
+	virtual ~Transport() = default;
+
+	virtual const char* name() const = 0;
+
+	// 连接前是否需要经过 BlueZ 配对、连接
+	virtual bool requiresPairing() const = 0;
+
+	// 注册服务记录，channel 为 0 时由传输层选择通道
+	virtual bool registerService(const std::string& serviceName,
+								 const std::string& serviceUUID,
+								 uint8_t& channel,
+								 uint32_t& handle) = 0;
+
+	virtual void unregisterService(uint32_t handle) = 0;
+
+	// 查询对端的服务通道
+	virtual bool resolveChannel(const std::string& address, uint8_t& channel) = 0;
+
+	// 创建监听套接字，失败返回 -1
+	virtual int listen(uint8_t channel, int backlog) = 0;
+
+	// 接受连接并给出对端地址，失败返回 -1
+	virtual int accept(int listenSocket, std::string& peerAddress) = 0;
+
+	// 创建非阻塞套接字并发起连接，pending 表示连接仍在进行(EINPROGRESS)，失败返回 -1
+	virtual int connect(const std::string& address, uint8_t channel, bool& pending) = 0;
+
+	// 本端地址
+	virtual std::string localAddress() const = 0;
+
+	// 已连接套接字的本端地址
+	virtual std::string socketAddress(int socket) const = 0;
+
+	static std::shared_ptr<Transport> create(const Options& options);
+};
+
+#endif // BLUETOOTH_RFCOMM_TRANSPORT_H_
@@ -1,5 +1,6 @@
 #include <bluetooth/utils.h>
 
+#include <algorithm>
 #include <cmath>
 #include <iomanip>
 
@@ -35,6 +36,16 @@ void Utils::appendProperties(const std::map<std::string, sdbus::Variant>& props,
 	}
 }
 
+std::string Utils::devicePathToAddress(const std::string& devicePath)
+{
+	auto pos = devicePath.rfind("/dev_");
+	if (pos == std::string::npos)
+		return devicePath;
+
+	std::string address = devicePath.substr(pos + 5);
+	std::replace(address.begin(), address.end(), '_', ':');
+	return address;
+}
 
 const std::unordered_map<
     std::string_view,
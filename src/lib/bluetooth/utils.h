@@ -31,6 +31,9 @@ public:
 
 	static std::string parseDescriptionJson(const std::string& json);
 
+	// "/org/bluez/hci0/dev_00_14_BE_80_3A_8C" -> "00:14:BE:80:3A:8C"
+	static std::string devicePathToAddress(const std::string& devicePath);
+
 private:
 	static const std::unordered_map<std::string_view,
 									std::function<void(const sdbus::Variant&, std::ostringstream&)>>
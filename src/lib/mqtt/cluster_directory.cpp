@@ -0,0 +1,107 @@
+#include <mqtt/cluster_directory.h>
+
+#include <utils/string_utils.h>
+
+ClusterDirectory::ClusterDirectory(const std::string& self) : _self(self), _local(0), _forwarded(0)
+{
+	_nodes[_self] = true;
+}
+
+void ClusterDirectory::setOwner(const std::string& address, const std::string& owner)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (owner.empty())
+		_owners.erase(toLower(address));
+	else
+		_owners[toLower(address)] = owner;
+}
+
+void ClusterDirectory::setPresence(const std::string& instance, bool online)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	// 本实例的离线状态只可能是上一次运行留下的遗嘱
+	if (instance == _self)
+		return;
+
+	_nodes[instance] = online;
+}
+
+std::string ClusterDirectory::remoteOwner(const std::string& address) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto it = _owners.find(toLower(address));
+	if (it == _owners.end() || it->second == _self)
+		return std::string();
+
+	// 持有者已离线或状态未知时由本实例接管
+	auto node = _nodes.find(it->second);
+	if (node == _nodes.end() || !node->second)
+		return std::string();
+
+	return it->second;
+}
+
+bool ClusterDirectory::hasPeers() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	for (const auto& [instance, online] : _nodes)
+	{
+		if (online && instance != _self)
+			return true;
+	}
+
+	return false;
+}
+
+bool ClusterDirectory::ownedBySelf(const std::string& address) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto it = _owners.find(toLower(address));
+	return it != _owners.end() && it->second == _self;
+}
+
+void ClusterDirectory::countLocal()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	++_local;
+}
+
+void ClusterDirectory::countForwarded()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	++_forwarded;
+}
+
+Json::Value ClusterDirectory::getStats() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	Json::Value root;
+	Json::Value nodes(Json::arrayValue);
+	Json::UInt64 owned = 0;
+
+	for (const auto& [instance, online] : _nodes)
+	{
+		if (online)
+			nodes.append(instance);
+	}
+
+	for (const auto& [address, owner] : _owners)
+	{
+		if (owner == _self)
+			++owned;
+	}
+
+	root["instance"] = _self;
+	root["nodes"] = nodes;
+	root["devices"] = static_cast<Json::UInt64>(_owners.size());
+	root["owned"] = owned;
+	root["local"] = static_cast<Json::UInt64>(_local);
+	root["forwarded"] = static_cast<Json::UInt64>(_forwarded);
+	return root;
+}
@@ -0,0 +1,53 @@
+#ifndef MQTT_CLUSTER_DIRECTORY_H_
+#define MQTT_CLUSTER_DIRECTORY_H_
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <json/json.h>
+
+#include <defines.h>
+
+// 集群中的设备归属与实例在线状态
+//
+// 多个网关实例以共享订阅分担命令，每个实例把持有会话的设备以保留消息登记为归属记录，
+// 并以遗嘱维护自己的在线状态；收到命令时据此判断设备是否应转发给其他实例处理。
+class CORE_API ClusterDirectory
+{
+public:
+	explicit ClusterDirectory(const std::string& self);
+
+	const std::string& self() const { return _self; }
+
+	// 更新设备归属，owner 为空表示释放
+	void setOwner(const std::string& address, const std::string& owner);
+
+	void setPresence(const std::string& instance, bool online);
+
+	// 设备由其他在线实例持有时返回该实例；本实例持有、无人持有或持有者离线时返回空串
+	std::string remoteOwner(const std::string& address) const;
+
+	// 是否有其他在线实例
+	bool hasPeers() const;
+
+	bool ownedBySelf(const std::string& address) const;
+
+	// 命令的处理位置统计
+	void countLocal();
+	void countForwarded();
+
+	Json::Value getStats() const;
+
+private:
+	std::string _self;
+
+	mutable std::mutex _mutex;
+	std::unordered_map<std::string, std::string> _owners; // 地址(小写) -> 实例
+	std::unordered_map<std::string, bool> _nodes;		   // 实例 -> 是否在线
+	uint64_t _local;
+	uint64_t _forwarded;
+};
+
+#endif // MQTT_CLUSTER_DIRECTORY_H_
@@ -0,0 +1,758 @@
+#include <mqtt/command_decoder.h>
+
+#include <charconv>
+#include <cstring>
+#include <string_view>
+
+namespace {
+
+	// 嵌套层数上限，超过时按格式错误拒绝
+	constexpr int kMaxDepth = 32;
+
+	// base64 字符的取值，同时接受标准与 URL 安全字符集，-1 表示无效字符
+	struct Base64Table
+	{
+		int8_t values[256];
+
+		Base64Table()
+		{
+			static const char kChars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+										 "abcdefghijklmnopqrstuvwxyz"
+										 "0123456789";
+
+			std::memset(values, -1, sizeof(values));
+
+			for (int i = 0; i < 62; ++i)
+				values[static_cast<uint8_t>(kChars[i])] = static_cast<int8_t>(i);
+
+			values['+'] = values['-'] = 62;
+			values['/'] = values['_'] = 63;
+		}
+	};
+
+	const Base64Table kBase64;
+
+	// JSON 词法扫描，出错时记录第一个错误的位置
+	class Scanner
+	{
+	public:
+		Scanner(const uint8_t* data, size_t size)
+			: _begin(reinterpret_cast<const char*>(data)), _p(_begin), _end(_begin + size)
+		{
+		}
+
+		const std::string& error() const { return _error; }
+
+		size_t remaining() const { return static_cast<size_t>(_end - _p); }
+
+		bool fail(const char* reason)
+		{
+			if (_error.empty())
+				_error = "第 " + std::to_string(_p - _begin) + " 字节: " + reason;
+
+			return false;
+		}
+
+		void skipSpace()
+		{
+			while (_p < _end && (*_p == ' ' || *_p == '\t' || *_p == '\n' || *_p == '\r'))
+				++_p;
+		}
+
+		char peek()
+		{
+			skipSpace();
+			return _p < _end ? *_p : '\0';
+		}
+
+		bool consume(char c)
+		{
+			if (peek() != c)
+				return false;
+
+			++_p;
+			return true;
+		}
+
+		// 允许结尾有空白以及按 C 字符串发送时带上的 '\0'
+		bool atEnd()
+		{
+			skipSpace();
+
+			while (_p < _end && *_p == '\0')
+				++_p;
+
+			return _p == _end;
+		}
+
+		// out 为空时只跳过
+		bool string(std::string* out)
+		{
+			if (!consume('"'))
+				return fail("应为字符串");
+
+			if (out)
+				out->clear();
+
+			return stringTail(out);
+		}
+
+		// 扫描开始引号之后的部分
+		bool stringTail(std::string* out)
+		{
+			while (true)
+			{
+				const char* run = _p;
+				while (_p < _end && *_p != '"' && *_p != '\\' && static_cast<uint8_t>(*_p) >= 0x20)
+					++_p;
+
+				if (out)
+					out->append(run, _p);
+
+				if (_p == _end)
+					return fail("字符串未结束");
+
+				if (*_p == '"')
+				{
+					++_p;
+					return true;
+				}
+
+				if (*_p != '\\')
+					return fail("字符串中有控制字符");
+
+				++_p;
+				if (!escape(out))
+					return false;
+			}
+		}
+
+		// 校验数字并取原文，integral 表示没有小数和指数部分
+		bool number(std::string_view& text, bool& integral)
+		{
+			skipSpace();
+
+			const char* start = _p;
+			integral = true;
+
+			if (_p < _end && *_p == '-')
+				++_p;
+
+			if (!digits(true))
+				return fail("无效的数字");
+
+			if (_p < _end && *_p == '.')
+			{
+				++_p;
+				integral = false;
+
+				if (!digits(false))
+					return fail("无效的数字");
+			}
+
+			if (_p < _end && (*_p == 'e' || *_p == 'E'))
+			{
+				++_p;
+				integral = false;
+
+				if (_p < _end && (*_p == '+' || *_p == '-'))
+					++_p;
+
+				if (!digits(false))
+					return fail("无效的数字");
+			}
+
+			text = std::string_view(start, static_cast<size_t>(_p - start));
+			return true;
+		}
+
+		// true、false、null
+		bool literal(std::string_view& text)
+		{
+			skipSpace();
+
+			for (const char* word : { "true", "false", "null" })
+			{
+				size_t length = std::strlen(word);
+
+				if (remaining() >= length && std::memcmp(_p, word, length) == 0)
+				{
+					text = std::string_view(_p, length);
+					_p += length;
+					return true;
+				}
+			}
+
+			return fail("无效的值");
+		}
+
+		template <typename Member>
+		bool object(Member&& member)
+		{
+			if (!consume('{'))
+				return fail("应为对象");
+
+			if (consume('}'))
+				return true;
+
+			std::string key;
+
+			do
+			{
+				if (!string(&key))
+					return false;
+
+				if (!consume(':'))
+					return fail("缺少 ':'");
+
+				if (!member(key))
+					return false;
+			} while (consume(','));
+
+			return consume('}') || fail("缺少 ',' 或 '}'");
+		}
+
+		template <typename Element>
+		bool array(Element&& element)
+		{
+			if (!consume('['))
+				return fail("应为数组");
+
+			if (consume(']'))
+				return true;
+
+			do
+			{
+				if (!element())
+					return false;
+			} while (consume(','));
+
+			return consume(']') || fail("缺少 ',' 或 ']'");
+		}
+
+		bool skipValue(int depth)
+		{
+			if (depth > kMaxDepth)
+				return fail("嵌套层数过多");
+
+			std::string_view text;
+			bool integral;
+
+			switch (peek())
+			{
+			case '{':
+				return object([this, depth](const std::string&) { return skipValue(depth + 1); });
+			case '[':
+				return array([this, depth]() { return skipValue(depth + 1); });
+			case '"':
+				return string(nullptr);
+			case 't':
+			case 'f':
+			case 'n':
+				return literal(text);
+			default:
+				return number(text, integral);
+			}
+		}
+
+		// 把 base64 字符串解码到 out，out 的容量不小于 remaining() / 4 * 3 + 3；
+		// 内容无效时 valid 为 false，仍扫描到字符串结尾
+		bool base64(uint8_t* out, size_t& length, bool& valid)
+		{
+			if (!consume('"'))
+				return fail("应为字符串");
+
+			uint8_t* q = out;
+			uint32_t bits = 0;
+			int count = 0;
+			int padding = 0;
+
+			valid = false;
+
+			while (_p < _end && *_p != '"')
+			{
+				uint8_t c = static_cast<uint8_t>(*_p);
+
+				// 部分 JSON 库把 '/' 转义为 "\/"，其余转义不会出现在 base64 中
+				if (c == '\\')
+				{
+					if (remaining() < 2 || _p[1] != '/')
+						return stringTail(nullptr);
+
+					++_p;
+					c = '/';
+				}
+				else if (c < 0x20)
+				{
+					return fail("字符串中有控制字符");
+				}
+
+				// '=' 或 '.'(URL 安全字符集)为填充，只能出现在末组的后两个位置
+				if (c == '=' || c == '.')
+				{
+					++padding;
+					if (count < 2 || count + padding > 4)
+						return stringTail(nullptr);
+
+					++_p;
+					continue;
+				}
+
+				if (padding || kBase64.values[c] < 0)
+					return stringTail(nullptr);
+
+				++_p;
+				bits = (bits << 6) | static_cast<uint32_t>(kBase64.values[c]);
+
+				if (++count == 4)
+				{
+					q[0] = static_cast<uint8_t>(bits >> 16);
+					q[1] = static_cast<uint8_t>(bits >> 8);
+					q[2] = static_cast<uint8_t>(bits);
+					q += 3;
+					bits = 0;
+					count = 0;
+				}
+			}
+
+			if (_p == _end)
+				return fail("字符串未结束");
+
+			++_p;
+
+			// 末组须以填充补足 4 个字符，不接受截断或缺少填充的内容
+			if (padding > 0 ? count + padding != 4 : count != 0)
+				return true;
+
+			if (count == 2)
+			{
+				*q++ = static_cast<uint8_t>(bits >> 4);
+			}
+			else if (count == 3)
+			{
+				*q++ = static_cast<uint8_t>(bits >> 10);
+				*q++ = static_cast<uint8_t>(bits >> 2);
+			}
+
+			length = static_cast<size_t>(q - out);
+			valid = true;
+			return true;
+		}
+
+	private:
+		// leading 为 true 时按整数部分校验，不允许前导 0
+		bool digits(bool leading)
+		{
+			const char* start = _p;
+
+			if (leading && _p < _end && *_p == '0')
+			{
+				++_p;
+				return true;
+			}
+
+			while (_p < _end && *_p >= '0' && *_p <= '9')
+				++_p;
+
+			return _p != start;
+		}
+
+		bool hex4(uint32_t& value)
+		{
+			if (remaining() < 4)
+				return fail("无效的 \\u 转义");
+
+			value = 0;
+
+			for (int i = 0; i < 4; ++i, ++_p)
+			{
+				char c = *_p;
+				value <<= 4;
+
+				if (c >= '0' && c <= '9')
+					value |= static_cast<uint32_t>(c - '0');
+				else if (c >= 'a' && c <= 'f')
+					value |= static_cast<uint32_t>(c - 'a' + 10);
+				else if (c >= 'A' && c <= 'F')
+					value |= static_cast<uint32_t>(c - 'A' + 10);
+				else
+					return fail("无效的 \\u 转义");
+			}
+
+			return true;
+		}
+
+		bool escape(std::string* out)
+		{
+			if (_p == _end)
+				return fail("字符串未结束");
+
+			char c = *_p++;
+			char decoded;
+
+			switch (c)
+			{
+			case '"':
+			case '\\':
+			case '/':
+				decoded = c;
+				break;
+			case 'b':
+				decoded = '\b';
+				break;
+			case 'f':
+				decoded = '\f';
+				break;
+			case 'n':
+				decoded = '\n';
+				break;
+			case 'r':
+				decoded = '\r';
+				break;
+			case 't':
+				decoded = '\t';
+				break;
+			case 'u':
+				return unicode(out);
+			default:
+				--_p;
+				return fail("无效的转义字符");
+			}
+
+			if (out)
+				out->push_back(decoded);
+
+			return true;
+		}
+
+		bool unicode(std::string* out)
+		{
+			uint32_t cp;
+			if (!hex4(cp))
+				return false;
+
+			// UTF-16 代理对
+			if (cp >= 0xD800 && cp <= 0xDBFF)
+			{
+				uint32_t low;
+
+				if (remaining() < 2 || _p[0] != '\\' || _p[1] != 'u')
+					return fail("不完整的代理对");
+
+				_p += 2;
+				if (!hex4(low))
+					return false;
+
+				if (low < 0xDC00 || low > 0xDFFF)
+					return fail("不完整的代理对");
+
+				cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+			}
+			else if (cp >= 0xDC00 && cp <= 0xDFFF)
+			{
+				return fail("不完整的代理对");
+			}
+
+			if (!out)
+				return true;
+
+			if (cp < 0x80)
+			{
+				out->push_back(static_cast<char>(cp));
+			}
+			else if (cp < 0x800)
+			{
+				out->push_back(static_cast<char>(0xC0 | (cp >> 6)));
+				out->push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+			}
+			else if (cp < 0x10000)
+			{
+				out->push_back(static_cast<char>(0xE0 | (cp >> 12)));
+				out->push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+				out->push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+			}
+			else
+			{
+				out->push_back(static_cast<char>(0xF0 | (cp >> 18)));
+				out->push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+				out->push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+				out->push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+			}
+
+			return true;
+		}
+
+	private:
+		const char* _begin;
+		const char* _p;
+		const char* _end;
+		std::string _error;
+	};
+
+	// 按字段名把值写入 Command
+	class CommandParser
+	{
+	public:
+		using Command = CommandDecoder::Command;
+
+		CommandParser(const uint8_t* data,
+					  size_t size,
+					  BufferPool* pool,
+					  Command& command,
+					  uint32_t wanted)
+			: _in(data, size), _pool(pool), _command(command), _wanted(wanted)
+		{
+		}
+
+		Scanner& scanner() { return _in; }
+
+		// 顶层对象中名为 scope 的对象
+		bool scoped(const char* scope)
+		{
+			return _in.object([this, scope](const std::string& key) {
+				if (key != scope)
+					return _in.skipValue(1);
+
+				_command.scoped = true;
+
+				if (_in.peek() != '{')
+					return mismatch(scope, 1);
+
+				return fields(1);
+			});
+		}
+
+		bool fields(int depth)
+		{
+			return _in.object([this, depth](const std::string& key) {
+				if (!wants(key))
+					return _in.skipValue(depth + 1);
+
+				if (key == "address")
+					return address(depth);
+				if (key == "pincode")
+					return text(CommandDecoder::kPincode, "pincode", _command.pincode, depth);
+				if (key == "publishId")
+					return text(CommandDecoder::kPublishId, "publishId", _command.publishId, depth);
+				if (key == "publishTime")
+					return text(CommandDecoder::kPublishTime,
+								"publishTime",
+								_command.publishTime,
+								depth);
+				if (key == "data")
+					return data(depth);
+				if (key == "size")
+					return integer(CommandDecoder::kSize, "size", _command.size, depth);
+				if (key == "times")
+					return integer(CommandDecoder::kTimes, "times", _command.times, depth);
+
+				return _in.skipValue(depth + 1);
+			});
+		}
+
+	private:
+		// 未知字段和未请求的字段跳过
+		bool wants(const std::string& key) const
+		{
+			static const std::pair<const char*, uint32_t> kFields[] = {
+				{ "address", CommandDecoder::kAddress | CommandDecoder::kAddressList },
+				{ "pincode", CommandDecoder::kPincode },
+				{ "publishId", CommandDecoder::kPublishId },
+				{ "publishTime", CommandDecoder::kPublishTime },
+				{ "data", CommandDecoder::kData },
+				{ "size", CommandDecoder::kSize },
+				{ "times", CommandDecoder::kTimes },
+			};
+
+			for (const auto& [name, field] : kFields)
+			{
+				if (key == name)
+					return (_wanted & field) != 0;
+			}
+
+			return false;
+		}
+
+		// 只保留第一个字段错误
+		void note(const std::string& error)
+		{
+			if (_command.error.empty())
+				_command.error = error;
+		}
+
+		// 类型不符时跳过该值继续扫描
+		bool mismatch(const char* name, int depth)
+		{
+			note(std::string("JSON解析错误: '") + name + "' 字段类型错误");
+			return _in.skipValue(depth + 1);
+		}
+
+		// 与 Json::Value::asString 一致：字符串取内容，数字和布尔值取原文，null 为空串；
+		// 对象和数组不取走，matched 为 false
+		bool scalar(std::string& out, bool& matched)
+		{
+			std::string_view text;
+			bool integral;
+
+			matched = true;
+
+			switch (_in.peek())
+			{
+			case '{':
+			case '[':
+				matched = false;
+				return true;
+			case '"':
+				return _in.string(&out);
+			case 't':
+			case 'f':
+			case 'n':
+				if (!_in.literal(text))
+					return false;
+
+				out.assign(text[0] == 'n' ? std::string_view() : text);
+				return true;
+			default:
+				if (!_in.number(text, integral))
+					return false;
+
+				out.assign(text);
+				return true;
+			}
+		}
+
+		bool text(uint32_t field, const char* name, std::string& out, int depth)
+		{
+			bool matched;
+
+			if (!scalar(out, matched))
+				return false;
+
+			if (!matched)
+				return mismatch(name, depth);
+
+			_command.fields |= field;
+			return true;
+		}
+
+		template <typename T>
+		bool integer(uint32_t field, const char* name, T& out, int depth)
+		{
+			char c = _in.peek();
+			if (c != '-' && (c < '0' || c > '9'))
+				return mismatch(name, depth);
+
+			std::string_view text;
+			bool integral;
+
+			if (!_in.number(text, integral))
+				return false;
+
+			T value = 0;
+			auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+
+			// 小数、负的长度或溢出
+			if (!integral || result.ec != std::errc() || result.ptr != text.data() + text.size())
+			{
+				note(std::string("JSON解析错误: '") + name + "' 字段类型错误");
+				return true;
+			}
+
+			out = value;
+			_command.fields |= field;
+			return true;
+		}
+
+		// 单个地址，或 removeDevices 使用的地址数组
+		bool address(int depth)
+		{
+			if (_in.peek() != '[')
+				return text(CommandDecoder::kAddress, "address", _command.address, depth);
+
+			_command.addressList.clear();
+
+			bool ok = _in.array([this, depth]() {
+				std::string item;
+				bool matched;
+
+				if (!scalar(item, matched))
+					return false;
+
+				if (!matched)
+					return mismatch("address", depth + 1);
+
+				_command.addressList.push_back(std::move(item));
+				return true;
+			});
+
+			if (ok)
+				_command.fields |= CommandDecoder::kAddressList;
+
+			return ok;
+		}
+
+		// 解码结果不会超过剩余字节数的 3/4，据此一次分配，边扫描边解码
+		bool data(int depth)
+		{
+			if (_in.peek() != '"')
+				return mismatch("data", depth);
+
+			size_t capacity = _in.remaining() / 4 * 3 + 3;
+			Buffer buffer = _pool ? _pool->acquire(capacity) : Buffer::allocate(capacity);
+
+			size_t length = 0;
+			bool valid = false;
+
+			if (!_in.base64(buffer.data(), length, valid))
+				return false;
+
+			if (!valid)
+			{
+				note("JSON解析错误: 数据Base64解码失败");
+				return true;
+			}
+
+			buffer.resize(length);
+			_command.data = std::move(buffer);
+			_command.fields |= CommandDecoder::kData;
+			return true;
+		}
+
+	private:
+		Scanner _in;
+		BufferPool* _pool;
+		Command& _command;
+		uint32_t _wanted;
+	};
+}
+
+CommandDecoder::CommandDecoder(BufferPool* pool) : _pool(pool) {}
+
+bool CommandDecoder::decode(const uint8_t* payload,
+							size_t size,
+							const char* scope,
+							Command& command,
+							std::string& error,
+							uint32_t wanted) const
+{
+	command = Command();
+
+	CommandParser parser(payload, size, _pool, command, wanted);
+	Scanner& in = parser.scanner();
+
+	bool ok = scope ? parser.scoped(scope) : parser.fields(0);
+
+	if (ok && !in.atEnd())
+		ok = in.fail("JSON 之后有多余的内容");
+
+	if (!ok)
+	{
+		error = in.error();
+		return false;
+	}
+
+	if (!scope)
+		command.scoped = true;
+
+	return true;
+}
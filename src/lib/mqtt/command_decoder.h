@@ -0,0 +1,68 @@
+#ifndef MQTT_COMMAND_DECODER_H_
+#define MQTT_COMMAND_DECODER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <defines.h>
+#include <utils/buffer_pool.h>
+
+// 下行命令的单遍解码
+//
+// 直接扫描消息字节，只提取命令用到的字段，不建立 JSON DOM；data 字段边扫描边做
+// base64 解码，写入缓冲池中的缓冲区。语法错误在扫描到的位置立即返回，字段类型错误
+// 或 base64 无效时记录原因并继续扫描，以便取得 publishId 回报错误。
+class CORE_API CommandDecoder
+{
+public:
+	// 已出现的字段
+	enum Field : uint32_t
+	{
+		kAddress = 1 << 0,
+		kPincode = 1 << 1,
+		kData = 1 << 2,
+		kSize = 1 << 3,
+		kTimes = 1 << 4,
+		kPublishId = 1 << 5,
+		kPublishTime = 1 << 6,
+		kAddressList = 1 << 7, // address 为数组
+		kAllFields = ~0u
+	};
+
+	struct Command
+	{
+		bool scoped = false; // 字段所在的对象存在
+		uint32_t fields = 0;
+		std::string error; // 第一个类型错误或解码失败的字段
+
+		std::string address;
+		std::vector<std::string> addressList; // address 为数组时的各项
+		std::string pincode;
+		Buffer data;
+		uint64_t size = 0;
+		int64_t times = 0;
+		std::string publishId;
+		std::string publishTime;
+
+		bool has(uint32_t field) const { return (fields & field) == field; }
+	};
+
+	// pool 为空时 data 在堆上分配
+	explicit CommandDecoder(BufferPool* pool = nullptr);
+
+	// 解码 scope 对象(如 "device")中的字段，scope 为空时取顶层字段；语法错误时返回 false。
+	// wanted 之外的字段只校验语法，不提取也不解码(如只需地址时跳过 data)
+	bool decode(const uint8_t* payload,
+				size_t size,
+				const char* scope,
+				Command& command,
+				std::string& error,
+				uint32_t wanted = kAllFields) const;
+
+private:
+	BufferPool* _pool;
+};
+
+#endif // MQTT_COMMAND_DECODER_H_
@@ -0,0 +1,149 @@
+#include <mqtt/flow_control.h>
+#include <utils/logger.h>
+
+#include <algorithm>
+
+FlowControl::FlowControl() : _connected(false) {}
+
+void FlowControl::setOptions(const Options& options)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_options = options;
+
+	if (_options.highWatermark < 1)
+		_options.highWatermark = 1;
+
+	if (_options.lowWatermark >= _options.highWatermark)
+		_options.lowWatermark = _options.highWatermark - 1;
+
+	if (_options.lowWatermark < 0)
+		_options.lowWatermark = 0;
+}
+
+void FlowControl::acquire(const std::string& address)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	++_credits[address].outstanding;
+}
+
+void FlowControl::release(const std::string& address, size_t count)
+{
+	bool notify = false;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto it = _credits.find(address);
+		if (it == _credits.end())
+			return;
+
+		Credit& credit = it->second;
+		credit.outstanding -= static_cast<int>(std::min<size_t>(count, credit.outstanding));
+
+		notify = credit.paused && credit.outstanding <= _options.lowWatermark;
+	}
+
+	if (notify)
+		_cv.notify_all();
+}
+
+bool FlowControl::waitReadable(const std::string& address, std::chrono::milliseconds timeout)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	Credit& credit = _credits[address];
+
+	if (readable(credit))
+		return true;
+
+	if (!credit.paused)
+	{
+		credit.paused = true;
+		credit.stallStart = Clock::now();
+		++credit.stalls;
+
+		LOG_DEBUG("{} 上行积压({})或MQTT未连接，暂停读取", address, credit.outstanding);
+	}
+
+	// 等待期间记录可能被 remove 移除，每次唤醒重新查找
+	return _cv.wait_for(lock, timeout, [this, &address]() {
+		auto it = _credits.find(address);
+		return it == _credits.end() || readable(it->second);
+	});
+}
+
+void FlowControl::remove(const std::string& address)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_credits.erase(address) == 0)
+			return;
+	}
+
+	_cv.notify_all();
+}
+
+bool FlowControl::readable(Credit& credit)
+{
+	bool connected = _connected || !_options.pauseWhenDisconnected;
+	int limit = credit.paused ? _options.lowWatermark : _options.highWatermark - 1;
+
+	if (!connected || credit.outstanding > limit)
+		return false;
+
+	if (credit.paused)
+	{
+		// 恢复读取，累计暂停时间
+		credit.paused = false;
+		credit.stallMs += static_cast<uint64_t>(
+			std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - credit.stallStart)
+				.count());
+	}
+
+	return true;
+}
+
+void FlowControl::setConnected(bool connected)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_connected = connected;
+	}
+
+	_cv.notify_all();
+}
+
+Json::Value FlowControl::getStats() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	Json::Value root;
+	Json::Value devices(Json::objectValue);
+	uint64_t paused = 0;
+	auto now = Clock::now();
+
+	for (const auto& [address, credit] : _credits)
+	{
+		uint64_t stallMs = credit.stallMs;
+		if (credit.paused)
+		{
+			++paused;
+			stallMs += static_cast<uint64_t>(
+				std::chrono::duration_cast<std::chrono::milliseconds>(now - credit.stallStart).count());
+		}
+
+		Json::Value device;
+		device["outstanding"] = credit.outstanding;
+		device["paused"] = credit.paused;
+		device["stalls"] = static_cast<Json::UInt64>(credit.stalls);
+		device["stallMs"] = static_cast<Json::UInt64>(stallMs);
+		devices[address] = device;
+	}
+
+	root["connected"] = _connected;
+	root["highWatermark"] = _options.highWatermark;
+	root["lowWatermark"] = _options.lowWatermark;
+	root["pausedDevices"] = static_cast<Json::UInt64>(paused);
+	root["devices"] = devices;
+	return root;
+}
@@ -0,0 +1,73 @@
+#ifndef MQTT_FLOW_CONTROL_H_
+#define MQTT_FLOW_CONTROL_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <json/json.h>
+
+#include <defines.h>
+
+// 上行信用流控
+//
+// 每个设备从读线程交出一帧起占用一个信用，直到 mosquitto 确认发出(on_publish)
+// 或发布失败时归还。未归还信用超过高水位，或与 MQTT 代理断开时，读线程停止
+// recv，由 RFCOMM 自身的流控反压设备；低于低水位且已连接后恢复读取。
+class CORE_API FlowControl
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	struct Options
+	{
+		int highWatermark = 256;			// 暂停读取的未确认帧数
+		int lowWatermark = 64;				// 恢复读取的未确认帧数
+		bool pauseWhenDisconnected = true;	// 与代理断开时暂停所有设备
+	};
+
+	FlowControl();
+
+	void setOptions(const Options& options);
+
+	// 读线程交出一帧
+	void acquire(const std::string& address);
+
+	// count 帧已发出或已丢弃
+	void release(const std::string& address, size_t count = 1);
+
+	// 读线程在 recv 前调用：可读时立即返回 true，否则最多等待 timeout
+	bool waitReadable(const std::string& address, std::chrono::milliseconds timeout);
+
+	// 设备会话关闭，移除其信用记录；之后到达的 release 被忽略，等待中的读线程立即返回
+	void remove(const std::string& address);
+
+	void setConnected(bool connected);
+
+	Json::Value getStats() const;
+
+private:
+	struct Credit
+	{
+		int outstanding = 0;
+		bool paused = false;
+		Clock::time_point stallStart;
+		uint64_t stalls = 0;
+		uint64_t stallMs = 0;
+	};
+
+	// 调用方持有锁，由暂停转为可读时结算暂停时间
+	bool readable(Credit& credit);
+
+	Options _options;
+	bool _connected;
+
+	mutable std::mutex _mutex;
+	std::condition_variable _cv;
+	std::unordered_map<std::string, Credit> _credits;
+};
+
+#endif // MQTT_FLOW_CONTROL_H_
@@ -59,6 +59,8 @@ size_t JobQueue::getQueueSize() const
 	return _tasks.size();
 }
 
+size_t JobQueue::getPendingCount() const { return _active_jobs.load(); }
+
 size_t JobQueue::getThreadCount() const { return _workers.size(); }
 
 size_t JobQueue::getMaxQueueSize() const { return _max_queue_size; }
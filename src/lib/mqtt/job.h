@@ -32,6 +32,9 @@ public:
 	// 获取队列中的任务数量
 	size_t getQueueSize() const;
 
+	// 获取未完成的任务数量，包括已取出正在执行的任务
+	size_t getPendingCount() const;
+
 	// 获取工作线程数量
 	size_t getThreadCount() const;
 
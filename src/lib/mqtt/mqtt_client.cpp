@@ -1,89 +1,506 @@
 #include <mqtt/mqtt_client.h>
 #include <utils/logger.h>
 
+#include <algorithm>
+#include <random>
 #include <string.h>
+#include <utility>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 
+namespace {
+
+	// 转换为 mosquitto 属性链表，由调用方释放
+	mosquitto_property* toProperties(const PublishProperties& properties)
+	{
+		mosquitto_property* list = nullptr;
+
+		if (properties.messageExpiry > 0)
+			mosquitto_property_add_int32(&list, MQTT_PROP_MESSAGE_EXPIRY_INTERVAL, properties.messageExpiry);
+
+		if (!properties.contentType.empty())
+			mosquitto_property_add_string(&list, MQTT_PROP_CONTENT_TYPE, properties.contentType.c_str());
+
+		if (!properties.correlationData.empty())
+		{
+			mosquitto_property_add_binary(&list,
+										  MQTT_PROP_CORRELATION_DATA,
+										  properties.correlationData.data(),
+										  static_cast<uint16_t>(properties.correlationData.size()));
+		}
+
+		for (const auto& [name, value] : properties.userProperties)
+			mosquitto_property_add_string_pair(&list, MQTT_PROP_USER_PROPERTY, name.c_str(), value.c_str());
+
+		return list;
+	}
+}
+
 //////////////////////////////////////////////////////////////////////////////////
 MqttClientImpl::MqttClientImpl(const std::string& client_id, bool clean_session)
-	: mosquittopp(client_id.c_str(), clean_session),
-	  _job_queue(std::make_unique<JobQueue>(2)), // 使用2个线程处理MQTT操作
+	: _active(nullptr),
+	  _max_inflight(20),
+	  _published{ 0, 0, 0 },
+	  _acked(0),
+	  _failed(0),
+	  _ack_latency_total_us(0),
+	  _ack_latency_max_us(0),
+	  _sent_messages(0),
+	  _sent_bytes(0),
+	  _rate_time(std::chrono::steady_clock::now()),
+	  _rate_messages(0),
+	  _rate_bytes(0),
+	  _disk_outbox(nullptr),
+	  _drain_outbox(true),
+	  _keepalive(60),
+	  _stopping(false),
+	  _primary_tried(false),
+	  _connects(0),
+	  _disconnects(0),
+	  _failed_attempts(0),
+	  _last_reconnect_ms(0),
+	  _max_reconnect_ms(0),
+	  _failovers(0),
+	  _replayed(0),
+	  _io_mode(IoMode::Loop),
+	  _wake_fd(-1),
+	  _inline_publishes(0),
+	  _inline_messages(0),
+	  _alias_limit(0),
+	  _aliased_messages(0),
+	  _job_queue(std::make_unique<JobQueue>(2)), // 使用2个线程处理回调与订阅
+	  _publish_queue(std::make_unique<JobQueue>(1)),
+	  _ordered_queue(std::make_unique<JobQueue>(1)),
 	  _connected(false),
-	  _client_id(client_id)
+	  _client_id(client_id),
+	  _clean_session(clean_session),
+	  _has_will(false),
+	  _will_qos(0),
+	  _will_retain(false)
 {
 	// 初始化mosquitto库
-	mosqpp::lib_init();
+	mosquitto_lib_init();
 
-	// 严格的串型模式
-	max_inflight_messages_set(0);
+	_links.push_back(createLink(0));
+	_active = _links.front().get();
 }
 
 MqttClientImpl::MqttClientImpl(const std::string& client_id,
 							   const std::string& username,
 							   const std::string& password,
 							   bool clean_session)
-	: mosquittopp(client_id.c_str(), clean_session),
-	  _job_queue(std::make_unique<JobQueue>(2)),
-	  _connected(false),
-	  _client_id(client_id)
+	: MqttClientImpl(client_id, clean_session)
 {
-	// 初始化mosquitto库
-	mosqpp::lib_init();
-
-	// 严格的串型模式
-	max_inflight_messages_set(0);
-
 	// 设置用户名和密码
-	username_pw_set(username.c_str(), password.c_str());
+	_username = username;
+	_password = password;
+	mosquitto_username_pw_set(_links.front()->mosq, username.c_str(), password.c_str());
 }
 
 MqttClientImpl::~MqttClientImpl()
 {
 	disconnect();
-	loop_stop();
-	mosqpp::lib_cleanup();
+
+	if (_wake_fd >= 0)
+		::close(_wake_fd);
+
+	for (auto& link : _links)
+		mosquitto_destroy(link->mosq);
+
+	mosquitto_lib_cleanup();
+}
+
+std::unique_ptr<MqttClientImpl::Link> MqttClientImpl::createLink(uint32_t index)
+{
+	auto link = std::make_unique<Link>();
+	link->owner = this;
+	link->index = index;
+	if (!_client_id.empty())
+		link->clientId = index == 0 ? _client_id : _client_id + "-standby";
+
+	link->mosq = mosquitto_new(
+		link->clientId.empty() ? nullptr : link->clientId.c_str(), _clean_session, link.get());
+
+	configure(*link);
+	return link;
+}
+
+void MqttClientImpl::configure(Link& link)
+{
+	// v5 回调同样适用于 v3.1.1 连接，属性为空
+	mosquitto_connect_v5_callback_set(link.mosq, &MqttClientImpl::connectCallback);
+	mosquitto_disconnect_v5_callback_set(link.mosq, &MqttClientImpl::disconnectCallback);
+	mosquitto_publish_v5_callback_set(link.mosq, &MqttClientImpl::publishCallback);
+	mosquitto_message_v5_callback_set(link.mosq, &MqttClientImpl::messageCallback);
+
+	if (!_username.empty() || !_password.empty())
+		mosquitto_username_pw_set(link.mosq, _username.c_str(), _password.c_str());
+
+	// QoS 1/2 流水线发布，窗口内的消息无需等待前一条确认
+	mosquitto_max_inflight_messages_set(link.mosq, _max_inflight);
+
+	// 网络循环由自己的线程驱动(以控制重连退避)，publish 等仍在其他线程调用
+	mosquitto_threaded_set(link.mosq, true);
+
+	mosquitto_int_option(link.mosq, MOSQ_OPT_PROTOCOL_VERSION, _v5.enabled ? MQTT_PROTOCOL_V5 : MQTT_PROTOCOL_V311);
+
+	if (_has_will)
+	{
+		mosquitto_will_set(link.mosq,
+						   _will_topic.c_str(),
+						   static_cast<int>(_will_payload.size()),
+						   _will_payload.data(),
+						   _will_qos,
+						   _will_retain);
+	}
 }
 
 bool MqttClientImpl::connect(const std::string& host, int port, int keepalive)
 {
-	int rc = mosqpp::mosquittopp::connect(host.c_str(), port, keepalive);
-	if (rc == MOSQ_ERR_SUCCESS)
+	return connect(std::vector<Endpoint>{ Endpoint{ host, port } }, keepalive);
+}
+
+bool MqttClientImpl::connect(const std::vector<Endpoint>& endpoints, int keepalive)
+{
+	std::lock_guard<std::mutex> lock(_connection_mutex);
+
+	if (endpoints.empty() || _links.front()->thread.joinable())
+		return false;
+
+	_endpoints = endpoints;
+	_health.assign(_endpoints.size(), EndpointHealth());
+	_keepalive = keepalive;
+	_stopping = false;
+	_primary_tried = false;
+	_outage_start = std::chrono::steady_clock::now();
+
+	// 热备连接从第二个地址开始
+	if (_failover.warmStandby && _endpoints.size() > 1 && _links.size() == 1)
 	{
-		loop_start();
-		return true;
+		_links.push_back(createLink(1));
+		_links.back()->endpoint = 1;
 	}
 
-	return false;
+	for (auto& link : _links)
+	{
+		mosquitto_int_option(link->mosq,
+							 MOSQ_OPT_PROTOCOL_VERSION,
+							 _v5.enabled ? MQTT_PROTOCOL_V5 : MQTT_PROTOCOL_V311);
+	}
+
+	if (_io_mode == IoMode::Epoll && _wake_fd < 0)
+	{
+		_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+		if (_wake_fd < 0)
+		{
+			LOG_WARN("创建 eventfd 失败，MQTT 网络 I/O 改用 loop 方式 - {}", strerror(errno));
+			_io_mode = IoMode::Loop;
+		}
+	}
+
+	// 首次连接也在网络线程中进行，代理暂不可达时同样按退避间隔重试
+	for (auto& link : _links)
+		link->thread = std::thread(&MqttClientImpl::networkLoop, this, link.get());
+
+	return true;
+}
+
+void MqttClientImpl::disconnect()
+{
+	{
+		std::lock_guard<std::mutex> lock(_connection_mutex);
+		_stopping = true;
+	}
+
+	_connection_cv.notify_all();
+
+	for (auto& link : _links)
+	{
+		std::shared_lock<std::shared_mutex> lock(link->mutex);
+		mosquitto_disconnect(link->mosq);
+	}
+
+	wake();
+
+	for (auto& link : _links)
+	{
+		if (link->thread.joinable() && link->thread.get_id() != std::this_thread::get_id())
+			link->thread.join();
+	}
+}
+
+void MqttClientImpl::setReconnect(const ReconnectOptions& options)
+{
+	std::lock_guard<std::mutex> lock(_connection_mutex);
+
+	_reconnect = options;
+	_reconnect.minDelay = std::max(_reconnect.minDelay, std::chrono::milliseconds(1));
+	_reconnect.maxDelay = std::max(_reconnect.maxDelay, _reconnect.minDelay);
+	_reconnect.connectTimeout = std::max(_reconnect.connectTimeout, std::chrono::milliseconds(100));
+}
+
+void MqttClientImpl::setIoMode(IoMode mode)
+{
+	std::lock_guard<std::mutex> lock(_connection_mutex);
+	_io_mode = mode;
+}
+
+void MqttClientImpl::setV5(const V5Options& options)
+{
+	std::lock_guard<std::mutex> lock(_connection_mutex);
+	_v5 = options;
+}
+
+void MqttClientImpl::setFailover(const FailoverOptions& options)
+{
+	std::lock_guard<std::mutex> lock(_connection_mutex);
+
+	_failover = options;
+	_failover.probeInterval = std::max(_failover.probeInterval, std::chrono::milliseconds(1));
 }
 
-void MqttClientImpl::disconnect() { mosqpp::mosquittopp::disconnect(); }
+void MqttClientImpl::setWill(const std::string& topic, const std::string& payload, int qos, bool retain)
+{
+	std::lock_guard<std::mutex> lock(_connection_mutex);
+
+	_has_will = true;
+	_will_topic = topic;
+	_will_payload = payload;
+	_will_qos = qos;
+	_will_retain = retain;
+
+	for (auto& link : _links)
+	{
+		int rc = mosquitto_will_set(
+			link->mosq, topic.c_str(), static_cast<int>(payload.size()), payload.data(), qos, retain);
+
+		if (rc != MOSQ_ERR_SUCCESS)
+			LOG_WARN("MQTT 遗嘱消息设置失败 - {} - {}", topic, mosquitto_strerror(rc));
+	}
+}
+
+void MqttClientImpl::flush()
+{
+	if (_job_queue)
+		_job_queue->waitForAll();
+
+	if (_ordered_queue)
+		_ordered_queue->waitForAll();
+
+	if (_publish_queue)
+		_publish_queue->waitForAll();
+}
 
 void MqttClientImpl::publishAsync(const std::string& topic,
 								  const std::vector<uint8_t>& payload,
 								  int qos,
-								  bool retain)
+								  bool retain,
+								  PublishProperties properties)
 {
-	if (!_job_queue)
+	if (!_publish_queue)
+		return;
+
+	if (canRunInline(*_publish_queue))
+	{
+		++_inline_publishes;
+		publishTracked(
+			topic, payload.data(), static_cast<int>(payload.size()), qos, retain, nullptr, properties);
 		return;
+	}
 
 	// 复制payload数据，确保在异步操作中有效
 	// std::vector<uint8_t> payload_copy(payload);
 
-	_job_queue->submit([this, topic, payload, qos, retain]() {
-		int rc = mosqpp::mosquittopp::publish(nullptr,
-											  topic.c_str(),
-											  payload.size(),
-											  payload.data(),
-											  qos,
-											  retain);
-		
-		if (rc == MOSQ_ERR_SUCCESS)
-			LOG_DEBUG("已发布消息到主题 - {}", topic);
-		else
-			LOG_ERROR("消息发布失败 - {}", mosquitto_strerror(rc));
+	_publish_queue->submit([this, topic, payload, qos, retain, properties = std::move(properties)]() {
+		publishTracked(
+			topic, payload.data(), static_cast<int>(payload.size()), qos, retain, nullptr, properties);
+	});
+}
+
+void MqttClientImpl::publishAsync(const std::string& topic,
+								  Buffer payload,
+								  int qos,
+								  bool retain,
+								  PublishCallback done,
+								  PublishProperties properties)
+{
+	if (!_publish_queue)
+	{
+		if (done)
+			done(false);
+
+		return;
+	}
+
+	// 没有积压时直接发布，省去一次线程切换；否则排在积压之后，保持顺序
+	if (canRunInline(*_publish_queue))
+	{
+		++_inline_publishes;
+		publishTracked(topic,
+					   payload.data(),
+					   static_cast<int>(payload.size()),
+					   qos,
+					   retain,
+					   std::move(done),
+					   properties);
+		return;
+	}
+
+	_publish_queue->submit([this,
+							topic,
+							payload = std::move(payload),
+							qos,
+							retain,
+							done,
+							properties = std::move(properties)]() {
+		publishTracked(
+			topic, payload.data(), static_cast<int>(payload.size()), qos, retain, done, properties);
 	});
 }
 
+int MqttClientImpl::publishTracked(const std::string& topic,
+								   const void* payload,
+								   int size,
+								   int qos,
+								   bool retain,
+								   PublishCallback done,
+								   const PublishProperties& properties,
+								   bool spool)
+{
+	int mid = 0;
+	int rc = MOSQ_ERR_SUCCESS;
+	qos = std::min(std::max(qos, 0), 2);
+
+	// 断开期间直接存入发件箱，由其在重连后按顺序重新发布
+	spool = spool && _disk_outbox;
+	if (spool && !_connected &&
+		_disk_outbox->push(topic, payload, static_cast<size_t>(size), qos, retain, properties.serialize()))
+	{
+		if (done)
+			done(true);
+
+		return MOSQ_ERR_SUCCESS;
+	}
+
+	{
+		// 切换代理后仍可能发布到刚被切换掉的连接，发布失败或随后在新连接上重新发布
+		Link& link = *_active.load();
+		std::shared_lock<std::shared_mutex> linkLock(link.mutex);
+
+		// 持锁发布并登记 mid，on_publish 可能在 publish 返回前由网络线程触发
+		std::unique_lock<std::mutex> lock(_publish_mutex, std::defer_lock);
+		bool track = done || qos > 0;
+		if (track)
+			lock.lock();
+
+		if (_v5.enabled)
+			rc = publishV5(link, &mid, topic, payload, size, qos, retain, properties);
+		else
+			rc = mosquitto_publish(link.mosq, &mid, topic.c_str(), size, payload, qos, retain);
+
+		if (rc == MOSQ_ERR_SUCCESS && track)
+		{
+			Outbound outbound{ std::move(done), qos, std::chrono::steady_clock::now(), nullptr };
+
+			if (qos > 0 && _links.size() > 1)
+			{
+				const uint8_t* data = static_cast<const uint8_t*>(payload);
+				outbound.resend = std::make_shared<Resend>(
+					Resend{ topic, std::vector<uint8_t>(data, data + size), retain, properties });
+			}
+
+			_outbox[outboundKey(link, mid)] = std::move(outbound);
+			++_published[qos];
+		}
+	}
+
+	if (rc == MOSQ_ERR_SUCCESS)
+	{
+		++_sent_messages;
+		_sent_bytes += static_cast<uint64_t>(size);
+		wake();
+		LOG_DEBUG("已发布消息到主题 - {}", topic);
+	}
+	else if (spool && (rc == MOSQ_ERR_NO_CONN || rc == MOSQ_ERR_CONN_LOST) &&
+			 _disk_outbox->push(
+				 topic, payload, static_cast<size_t>(size), qos, retain, properties.serialize()))
+	{
+		if (done)
+			done(true);
+	}
+	else
+	{
+		LOG_ERROR("消息发布失败 - {}", mosquitto_strerror(rc));
+
+		{
+			std::lock_guard<std::mutex> lock(_publish_mutex);
+			++_failed;
+		}
+
+		if (done)
+			done(false);
+	}
+
+	return rc;
+}
+
+int MqttClientImpl::publishV5(Link& link,
+							  int* mid,
+							  const std::string& topic,
+							  const void* payload,
+							  int size,
+							  int qos,
+							  bool retain,
+							  const PublishProperties& properties)
+{
+	mosquitto_property* list = toProperties(properties);
+	const char* name = topic.c_str();
+	bool assigned = false;
+
+	// QoS 1/2 可能在重连后由 mosquitto 按原样重发，新连接上别名已失效，只有 QoS 0 使用别名；
+	// 持锁发布，保证登记别名的消息先于只带别名的消息进入发送队列
+	std::unique_lock<std::mutex> lock(_alias_mutex, std::defer_lock);
+
+	if (qos == 0)
+	{
+		lock.lock();
+
+		if (_alias_limit > 0 && _connected)
+		{
+			auto it = _aliases.find(topic);
+
+			if (it != _aliases.end())
+			{
+				mosquitto_property_add_int16(&list, MQTT_PROP_TOPIC_ALIAS, it->second);
+				name = nullptr;
+				++_aliased_messages;
+			}
+			else if (_aliases.size() < _alias_limit)
+			{
+				uint16_t alias = static_cast<uint16_t>(_aliases.size() + 1);
+				_aliases.emplace(topic, alias);
+				mosquitto_property_add_int16(&list, MQTT_PROP_TOPIC_ALIAS, alias);
+				assigned = true;
+			}
+		}
+	}
+
+	int rc = mosquitto_publish_v5(link.mosq, mid, name, size, payload, qos, retain, list);
+	mosquitto_property_free_all(&list);
+
+	// 代理没有收到登记别名的消息，撤销登记
+	if (rc != MOSQ_ERR_SUCCESS && assigned)
+		_aliases.erase(topic);
+
+	return rc;
+}
+
 void MqttClientImpl::subscribeAsync(const std::string& topic, int qos)
 {
 	if (!_job_queue)
@@ -91,8 +508,22 @@ void MqttClientImpl::subscribeAsync(const std::string& topic, int qos)
 		return;
 	}
 
+	// 先登记再检查连接状态，与 on_connect 交错时至多重复订阅一次
+	{
+		std::lock_guard<std::mutex> lock(_callback_mutex);
+		_subscriptions[topic] = qos;
+	}
+
+	// 未连接时由 on_connect 订阅
+	if (!_connected)
+		return;
+
 	_job_queue->submit([this, topic, qos]() {
-		int rc = mosqpp::mosquittopp::subscribe(nullptr, topic.c_str(), qos);
+		Link& link = *_active.load();
+		std::shared_lock<std::shared_mutex> lock(link.mutex);
+
+		int rc = mosquitto_subscribe(link.mosq, nullptr, topic.c_str(), qos);
+		wake();
 
 		if (rc == MOSQ_ERR_SUCCESS)
 			LOG_DEBUG("已订阅主题 - {}", topic);
@@ -108,8 +539,17 @@ void MqttClientImpl::unsubscribeAsync(const std::string& topic)
 		return;
 	}
 
+	{
+		std::lock_guard<std::mutex> lock(_callback_mutex);
+		_subscriptions.erase(topic);
+	}
+
 	_job_queue->submit([this, topic]() {
-		int rc = mosqpp::mosquittopp::unsubscribe(nullptr, topic.c_str());
+		Link& link = *_active.load();
+		std::shared_lock<std::shared_mutex> lock(link.mutex);
+
+		int rc = mosquitto_unsubscribe(link.mosq, nullptr, topic.c_str());
+		wake();
 
 		if (rc != MOSQ_ERR_SUCCESS)
 			LOG_ERROR("取消订阅失败 - {}", mosquitto_strerror(rc));
@@ -117,9 +557,16 @@ void MqttClientImpl::unsubscribeAsync(const std::string& topic)
 }
 
 void MqttClientImpl::setMessageCallback(const std::string& topic, MessageCallback callback)
+{
+	setMessageCallback(topic, std::move(callback), DispatchOptions());
+}
+
+void MqttClientImpl::setMessageCallback(const std::string& topic,
+										MessageCallback callback,
+										const DispatchOptions& dispatch)
 {
 	std::lock_guard<std::mutex> lock(_callback_mutex);
-	_message_callbacks[topic] = callback;
+	_message_callbacks[topic] = Subscriber{ std::move(callback), dispatch };
 }
 
 void MqttClientImpl::setConnectCallback(ConnectCallback callback)
@@ -136,88 +583,1011 @@ void MqttClientImpl::setDisconnectCallback(DisconnectCallback callback)
 
 bool MqttClientImpl::isConnected() const { return _connected.load(); }
 
-void MqttClientImpl::on_connect(int rc)
+void MqttClientImpl::setMaxInflight(unsigned int count)
 {
-	_connected.store(true);
-
-	// 异步处理连接回调
-	if (_job_queue)
 	{
-		_job_queue->submit([this, rc]() { handleConnectAsync(rc); });
+		std::lock_guard<std::mutex> lock(_publish_mutex);
+		_max_inflight = count;
 	}
+
+	for (auto& link : _links)
+		mosquitto_max_inflight_messages_set(link->mosq, count);
 }
 
-void MqttClientImpl::on_disconnect(int rc)
+void MqttClientImpl::setOutbox(MqttOutbox* outbox, bool drain)
 {
-	_connected.store(false);
+	_disk_outbox = outbox;
+	_drain_outbox = drain;
 
-	// 异步处理断开连接回调
-	if (_job_queue)
-	{
-		_job_queue->submit([this, rc]() { handleDisconnectAsync(rc); });
-	}
+	if (!_disk_outbox || !_drain_outbox)
+		return;
+
+	// 重新发布不再转入发件箱，失败时由发件箱稍后重试
+	_disk_outbox->start([this](const std::string& topic,
+							   const std::vector<uint8_t>& payload,
+							   int qos,
+							   bool retain,
+							   const std::string& serialized) {
+		PublishProperties properties;
+		if (!PublishProperties::parse(serialized, properties))
+			LOG_WARN("发件箱消息的属性无法解析，按无属性发布 - {}", topic);
+
+		int rc = publishTracked(topic,
+								payload.data(),
+								static_cast<int>(payload.size()),
+								qos,
+								retain,
+								nullptr,
+								properties,
+								false);
+		return rc == MOSQ_ERR_SUCCESS;
+	});
 }
 
-void MqttClientImpl::on_message(const struct mosquitto_message* message)
+Json::Value MqttClientImpl::getPublishStats() const
 {
-	if (!message || !message->payload)
+	std::lock_guard<std::mutex> lock(_publish_mutex);
+
+	uint64_t messages = _sent_messages.load();
+	uint64_t bytes = _sent_bytes.load();
+	double messagesPerSec = 0;
+	double bytesPerSec = 0;
+
+	auto now = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration<double>(now - _rate_time).count();
+
+	if (seconds > 0)
 	{
-		return;
+		messagesPerSec = static_cast<double>(messages - _rate_messages) / seconds;
+		bytesPerSec = static_cast<double>(bytes - _rate_bytes) / seconds;
 	}
 
-	std::string topic(message->topic ? message->topic : "");
-	const void* payload = message->payload;
-	size_t payload_len = message->payloadlen;
-
-	std::vector<uint8_t> buffer(payload_len, 0);
-	memcpy(buffer.data(), payload, payload_len);
+	_rate_time = now;
+	_rate_messages = messages;
+	_rate_bytes = bytes;
 
-	// 异步处理消息回调
-	if (_job_queue)
+	uint64_t outbox = 0;
+	for (const auto& [key, outbound] : _outbox)
 	{
-		_job_queue->submit([this, topic, buffer]() { handleMessageAsync(topic, buffer); });
+		if (outbound.qos > 0)
+			++outbox;
 	}
+
+	Json::Value root;
+	root["messages"] = static_cast<Json::UInt64>(messages);
+	root["bytes"] = static_cast<Json::UInt64>(bytes);
+	root["messagesPerSec"] = static_cast<Json::UInt64>(messagesPerSec);
+	root["bytesPerSec"] = static_cast<Json::UInt64>(bytesPerSec);
+	root["maxInflight"] = _max_inflight;
+	root["outbox"] = static_cast<Json::UInt64>(outbox);
+	root["publishedQos1"] = static_cast<Json::UInt64>(_published[1]);
+	root["publishedQos2"] = static_cast<Json::UInt64>(_published[2]);
+	root["acked"] = static_cast<Json::UInt64>(_acked);
+	root["failed"] = static_cast<Json::UInt64>(_failed);
+	root["ackLatencyAvgMs"] = _acked ? static_cast<double>(_ack_latency_total_us) / _acked / 1000.0 : 0.0;
+	root["ackLatencyMaxMs"] = static_cast<double>(_ack_latency_max_us) / 1000.0;
+	root["aliased"] = static_cast<Json::UInt64>(_aliased_messages.load());
+	return root;
 }
 
-void MqttClientImpl::on_publish(int mid) {}
+Json::Value MqttClientImpl::getConnectionStats() const
+{
+	std::lock_guard<std::mutex> lock(_connection_mutex);
 
-void MqttClientImpl::on_subscribe(int mid, int qos_count, const int* granted_qos) {}
+	uint64_t outageMs = 0;
+	if (!_connected && _links.front()->thread.joinable())
+	{
+		outageMs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+											 std::chrono::steady_clock::now() - _outage_start)
+											 .count());
+	}
 
-void MqttClientImpl::on_unsubscribe(int mid) {}
+	Json::Value root;
+	root["clientId"] = _client_id;
+	root["connected"] = _connected.load();
+	root["connects"] = static_cast<Json::UInt64>(_connects);
+	root["disconnects"] = static_cast<Json::UInt64>(_disconnects);
+	root["failedAttempts"] = static_cast<Json::UInt64>(_failed_attempts);
+	root["lastReconnectMs"] = static_cast<Json::UInt64>(_last_reconnect_ms);
+	root["maxReconnectMs"] = static_cast<Json::UInt64>(_max_reconnect_ms);
+	root["outageMs"] = static_cast<Json::UInt64>(outageMs);
+	root["protocol"] = _v5.enabled ? "5" : "3.1.1";
+	root["ioMode"] = _io_mode == IoMode::Epoll ? "epoll" : "loop";
+	root["inlinePublishes"] = static_cast<Json::UInt64>(_inline_publishes.load());
+	root["inlineMessages"] = static_cast<Json::UInt64>(_inline_messages.load());
 
-void MqttClientImpl::handleConnectAsync(int rc)
-{
-	std::lock_guard<std::mutex> lock(_callback_mutex);
-	if (_connect_callback)
+	// 故障切换：endpoint 为主连接当前的代理，role 为使用该地址的连接
+	const Link* active = _active.load();
+	Json::Value endpoints(Json::arrayValue);
+
+	for (size_t i = 0; i < _endpoints.size(); ++i)
 	{
-		_connect_callback(rc);
+		const char* role = "";
+		for (const auto& link : _links)
+		{
+			if (link->endpoint == i)
+				role = link.get() == active ? "active" : "standby";
+		}
+
+		Json::Value item;
+		item["host"] = _endpoints[i].host;
+		item["port"] = _endpoints[i].port;
+		item["role"] = role;
+		item["healthy"] = _health[i].healthy;
+		item["failures"] = static_cast<Json::UInt64>(_health[i].failures);
+		endpoints.append(item);
 	}
-}
 
-void MqttClientImpl::handleDisconnectAsync(int rc)
-{
-	std::lock_guard<std::mutex> lock(_callback_mutex);
-	if (_disconnect_callback)
+	if (!_endpoints.empty())
 	{
-		_disconnect_callback();
+		const Endpoint& endpoint = _endpoints[active->endpoint];
+		root["endpoint"] = endpoint.host + ":" + std::to_string(endpoint.port);
 	}
+
+	bool standby = false;
+	for (const auto& link : _links)
+		standby = standby || (link.get() != active && link->up);
+
+	root["standby"] = standby;
+	root["failovers"] = static_cast<Json::UInt64>(_failovers);
+	root["replayed"] = static_cast<Json::UInt64>(_replayed.load());
+	root["endpoints"] = endpoints;
+	return root;
 }
 
-void MqttClientImpl::handleMessageAsync(const std::string& topic, const std::vector<uint8_t>& data)
+void MqttClientImpl::on_connect(Link& link, int rc, const mosquitto_property* properties)
 {
-	std::lock_guard<std::mutex> lock(_callback_mutex);
+	uint16_t brokerLimit = 0;
+	if (_v5.enabled && rc == 0)
+		mosquitto_property_read_int16(properties, MQTT_PROP_TOPIC_ALIAS_MAXIMUM, &brokerLimit, false);
+
+	Link* previous = nullptr;
 
-	// 查找匹配的回调函数
-	for (const auto& pair : _message_callbacks)
 	{
-		// 简单的字符串匹配，可以扩展为支持通配符
-		if (topic.find(pair.first) != std::string::npos)
+		std::lock_guard<std::mutex> lock(_connection_mutex);
+
+		const Endpoint& endpoint = _endpoints[link.endpoint];
+		link.up = rc == 0;
+		link.aliasMaximum = brokerLimit;
+		_health[link.endpoint].healthy = rc == 0;
+
+		if (rc == 0)
+			link.resetBackoff = true;
+		else
+			++_health[link.endpoint].failures;
+
+		settlePrimary(link);
+
+		Link* active = _active.load();
+
+		if (&link != active)
 		{
-			if (pair.second)
+			// 主连接可用时只作为备用连接，不订阅也不发布
+			if (rc != 0 || active->up)
 			{
-				pair.second(topic, data);
+				if (rc == 0)
+					LOG_INFO("已建立到MQTT代理 {}:{} 的备用连接", endpoint.host, endpoint.port);
+				else
+					LOG_WARN("MQTT代理 {}:{} 拒绝备用连接 - {}",
+							 endpoint.host,
+							 endpoint.port,
+							 _v5.enabled ? mosquitto_reason_string(rc) : mosquitto_connack_string(rc));
+
+				return;
 			}
-			break; // 找到第一个匹配的回调就返回
+
+			// 主连接尚未恢复，由备用连接接替
+			_active = &link;
+			previous = active;
+			previous->reset = true;
+			++_failovers;
 		}
 	}
-}
\ No newline at end of file
+
+	if (rc == 0)
+	{
+		activate(link, previous);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_alias_mutex);
+		_aliases.clear();
+		_alias_limit = 0;
+	}
+
+	LOG_WARN("MQTT代理拒绝连接 - {}",
+			 _v5.enabled ? mosquitto_reason_string(rc) : mosquitto_connack_string(rc));
+
+	_connected.store(false);
+
+	if (_disk_outbox && _drain_outbox)
+		_disk_outbox->setConnected(false);
+
+	// 异步处理连接回调
+	if (_job_queue)
+	{
+		_job_queue->submit([this, rc]() { handleConnectAsync(rc); });
+	}
+}
+
+void MqttClientImpl::activate(Link& link, Link* from)
+{
+	uint16_t aliasMaximum = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(_connection_mutex);
+
+		// 从断开(或启动)到连接成功的耗时，切换到备用连接时即为切换耗时
+		uint64_t elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+													 std::chrono::steady_clock::now() - _outage_start)
+													 .count());
+		++_connects;
+		_last_reconnect_ms = elapsed;
+		_max_reconnect_ms = std::max(_max_reconnect_ms, elapsed);
+		aliasMaximum = link.aliasMaximum;
+
+		const Endpoint& endpoint = _endpoints[link.endpoint];
+		if (from)
+			LOG_WARN("已切换到MQTT代理 {}:{}，耗时 {}ms", endpoint.host, endpoint.port, elapsed);
+		else
+			LOG_INFO("已连接到MQTT代理 {}:{}，耗时 {}ms", endpoint.host, endpoint.port, elapsed);
+	}
+
+	// 新连接上重新分配主题别名，上限取配置与代理 CONNACK 中的较小值(未携带表示不支持)
+	{
+		std::lock_guard<std::mutex> lock(_alias_mutex);
+		_aliases.clear();
+		_alias_limit = _v5.enabled ? std::min(aliasMaximum, _v5.topicAliasMaximum) : 0;
+	}
+
+	_connected.store(true);
+
+	if (_disk_outbox && _drain_outbox)
+		_disk_outbox->setConnected(true);
+
+	// 持久会话下代理会保留订阅，重新订阅无副作用；干净会话必须重新订阅
+	resubscribe(link);
+
+	if (from)
+		replayPending(*from);
+
+	// 异步处理连接回调
+	if (_job_queue)
+	{
+		_job_queue->submit([this]() { handleConnectAsync(0); });
+	}
+}
+
+void MqttClientImpl::on_disconnect(Link& link, int rc)
+{
+	Link* standby = nullptr;
+
+	{
+		std::lock_guard<std::mutex> lock(_connection_mutex);
+
+		const Endpoint& endpoint = _endpoints[link.endpoint];
+		bool wasUp = link.up;
+		link.up = false;
+
+		if (wasUp)
+			_health[link.endpoint].healthy = false;
+
+		if (&link != _active.load())
+		{
+			if (wasUp && !_stopping)
+				LOG_WARN("与MQTT代理 {}:{} 的备用连接断开", endpoint.host, endpoint.port);
+
+			return;
+		}
+
+		if (wasUp)
+		{
+			++_disconnects;
+			_outage_start = std::chrono::steady_clock::now();
+		}
+
+		// 备用连接可用时直接切换，本连接上未确认的消息在新连接上重新发布
+		for (const auto& other : _links)
+		{
+			if (!_stopping && other.get() != &link && other->up)
+				standby = other.get();
+		}
+
+		if (standby)
+		{
+			_active = standby;
+			link.reset = true;
+			++_failovers;
+
+			LOG_WARN("与MQTT代理 {}:{} 的连接断开，切换到备用连接", endpoint.host, endpoint.port);
+		}
+	}
+
+	// 断开时 mosquitto 丢弃未发出的 QoS 0 消息，不会再有 on_publish
+	failPendingPublishes(link);
+
+	if (standby)
+	{
+		activate(*standby, &link);
+		return;
+	}
+
+	_connected.store(false);
+
+	{
+		std::lock_guard<std::mutex> lock(_alias_mutex);
+		_aliases.clear();
+		_alias_limit = 0;
+	}
+
+	if (_disk_outbox && _drain_outbox)
+		_disk_outbox->setConnected(false);
+
+	// QoS 1/2 留在发件箱，重连后由 mosquitto 重发
+
+	// 异步处理断开连接回调
+	if (_job_queue)
+	{
+		_job_queue->submit([this, rc]() { handleDisconnectAsync(rc); });
+	}
+}
+
+void MqttClientImpl::on_message(const struct mosquitto_message* message)
+{
+	if (!message)
+	{
+		return;
+	}
+
+	std::string topic(message->topic ? message->topic : "");
+	const void* payload = message->payload;
+	size_t payload_len = message->payloadlen;
+
+	Subscriber subscriber;
+	if (!findSubscriber(topic, subscriber))
+		return;
+
+	// 空消息体只交给声明接收的回调，删除保留消息时收到的就是空消息
+	if (payload_len == 0 && !subscriber.dispatch.emptyPayload)
+		return;
+
+	// 有序回调共用一个单线程队列，其余回调由任务队列并行处理
+	JobQueue* queue = subscriber.dispatch.ordered ? _ordered_queue.get() : _job_queue.get();
+	if (!queue)
+		return;
+
+	std::vector<uint8_t> buffer(payload_len, 0);
+	if (payload_len > 0)
+		memcpy(buffer.data(), payload, payload_len);
+
+	// 该队列没有积压时直接在网络线程处理，省去一次线程切换
+	if (subscriber.dispatch.inlineDispatch && canRunInline(*queue))
+	{
+		++_inline_messages;
+		subscriber.callback(topic, buffer);
+		return;
+	}
+
+	// 异步处理消息回调
+	queue->submit([callback = std::move(subscriber.callback), topic, buffer = std::move(buffer)]() {
+		callback(topic, buffer);
+	});
+}
+
+void MqttClientImpl::on_publish(Link& link, int mid, int reason)
+{
+	PublishCallback done;
+
+	// v5 的 PUBACK 原因码不小于 0x80 表示代理拒绝了消息
+	bool accepted = reason < 0x80;
+
+	{
+		std::lock_guard<std::mutex> lock(_publish_mutex);
+
+		auto it = _outbox.find(outboundKey(link, mid));
+		if (it == _outbox.end())
+			return;
+
+		// QoS 1/2 在收到 PUBACK/PUBCOMP 后触发，记录确认延迟
+		if (!accepted)
+		{
+			++_failed;
+		}
+		else if (it->second.qos > 0)
+		{
+			uint64_t latency = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+														 std::chrono::steady_clock::now() - it->second.published)
+														 .count());
+			++_acked;
+			_ack_latency_total_us += latency;
+			_ack_latency_max_us = std::max(_ack_latency_max_us, latency);
+		}
+
+		done = std::move(it->second.done);
+		_outbox.erase(it);
+	}
+
+	if (!accepted)
+		LOG_WARN("MQTT代理拒绝消息 - {}", mosquitto_reason_string(reason));
+
+	if (done)
+		done(accepted);
+}
+
+void MqttClientImpl::connectCallback(
+	struct mosquitto*, void* obj, int rc, int flags, const mosquitto_property* properties)
+{
+	Link* link = static_cast<Link*>(obj);
+	link->owner->on_connect(*link, rc, properties);
+}
+
+void MqttClientImpl::disconnectCallback(struct mosquitto*, void* obj, int rc, const mosquitto_property*)
+{
+	Link* link = static_cast<Link*>(obj);
+	link->owner->on_disconnect(*link, rc);
+}
+
+void MqttClientImpl::publishCallback(
+	struct mosquitto*, void* obj, int mid, int reason, const mosquitto_property*)
+{
+	Link* link = static_cast<Link*>(obj);
+	link->owner->on_publish(*link, mid, reason);
+}
+
+void MqttClientImpl::messageCallback(struct mosquitto*,
+									 void* obj,
+									 const struct mosquitto_message* message,
+									 const mosquitto_property*)
+{
+	static_cast<Link*>(obj)->owner->on_message(message);
+}
+
+uint64_t MqttClientImpl::outboundKey(const Link& link, int mid)
+{
+	return (static_cast<uint64_t>(link.index) << 32) | static_cast<uint32_t>(mid);
+}
+
+void MqttClientImpl::handleConnectAsync(int rc)
+{
+	std::lock_guard<std::mutex> lock(_callback_mutex);
+	if (_connect_callback)
+	{
+		_connect_callback(rc);
+	}
+}
+
+void MqttClientImpl::handleDisconnectAsync(int rc)
+{
+	std::lock_guard<std::mutex> lock(_callback_mutex);
+	if (_disconnect_callback)
+	{
+		_disconnect_callback();
+	}
+}
+
+void MqttClientImpl::failPendingPublishes(const Link& link)
+{
+	std::vector<PublishCallback> pending;
+
+	{
+		std::lock_guard<std::mutex> lock(_publish_mutex);
+
+		for (auto it = _outbox.begin(); it != _outbox.end();)
+		{
+			if (it->second.qos > 0 || (it->first >> 32) != link.index)
+			{
+				++it;
+				continue;
+			}
+
+			++_failed;
+			pending.push_back(std::move(it->second.done));
+			it = _outbox.erase(it);
+		}
+	}
+
+	for (auto& done : pending)
+	{
+		if (done)
+			done(false);
+	}
+}
+
+void MqttClientImpl::replayPending(Link& link)
+{
+	std::vector<Outbound> pending;
+
+	{
+		std::lock_guard<std::mutex> lock(_publish_mutex);
+
+		for (auto it = _outbox.begin(); it != _outbox.end();)
+		{
+			if (it->second.qos == 0 || (it->first >> 32) != link.index)
+			{
+				++it;
+				continue;
+			}
+
+			pending.push_back(std::move(it->second));
+			it = _outbox.erase(it);
+		}
+	}
+
+	if (pending.empty())
+		return;
+
+	// 按原发布顺序重新发布
+	std::sort(pending.begin(), pending.end(), [](const Outbound& a, const Outbound& b) {
+		return a.published < b.published;
+	});
+
+	for (auto& outbound : pending)
+	{
+		if (!outbound.resend)
+		{
+			{
+				std::lock_guard<std::mutex> lock(_publish_mutex);
+				++_failed;
+			}
+
+			if (outbound.done)
+				outbound.done(false);
+
+			continue;
+		}
+
+		const Resend& resend = *outbound.resend;
+		publishTracked(resend.topic,
+					   resend.payload.data(),
+					   static_cast<int>(resend.payload.size()),
+					   outbound.qos,
+					   resend.retain,
+					   std::move(outbound.done),
+					   resend.properties);
+	}
+
+	_replayed += pending.size();
+	LOG_INFO("已在新的MQTT连接上重新发布 {} 条未确认的消息", pending.size());
+}
+
+void MqttClientImpl::resetLink(Link& link)
+{
+	{
+		std::unique_lock<std::shared_mutex> lock(link.mutex);
+
+		mosquitto_reinitialise(
+			link.mosq, link.clientId.empty() ? nullptr : link.clientId.c_str(), _clean_session, &link);
+		configure(link);
+	}
+
+	// 切换期间仍发布到本连接的消息
+	failPendingPublishes(link);
+	replayPending(link);
+}
+
+size_t MqttClientImpl::nextEndpoint(const Link& link, size_t from) const
+{
+	for (size_t i = 0; i < _endpoints.size(); ++i)
+	{
+		size_t candidate = (from + i) % _endpoints.size();
+		bool used = false;
+
+		for (const auto& other : _links)
+			used = used || (other.get() != &link && other->endpoint == candidate);
+
+		if (!used)
+			return candidate;
+	}
+
+	return link.endpoint;
+}
+
+void MqttClientImpl::networkLoop(Link* link)
+{
+	std::chrono::milliseconds delay;
+	size_t attempts = 0; // 本轮已尝试的地址数
+
+	{
+		std::unique_lock<std::mutex> lock(_connection_mutex);
+		delay = _reconnect.minDelay;
+
+		// 两条连接同时开始时备用连接可能先完成 CONNECT 而被提升为主连接，等主连接第一次
+		// 连接成功或失败后再开始
+		if (link != _links.front().get())
+			_connection_cv.wait(lock, [this]() { return _stopping || _primary_tried; });
+	}
+
+	for (;;)
+	{
+		Endpoint endpoint;
+		size_t candidates = 1;
+		bool reset = false;
+
+		{
+			std::lock_guard<std::mutex> lock(_connection_mutex);
+			if (_stopping)
+				break;
+
+			endpoint = _endpoints[link->endpoint];
+			reset = std::exchange(link->reset, false);
+
+			// 另一条连接占用的地址不参与本连接的轮换
+			if (_endpoints.size() > _links.size())
+				candidates = _endpoints.size() - (_links.size() - 1);
+		}
+
+		// 被切换掉的连接丢弃排队的消息，它们已在新连接上重新发布
+		if (reset)
+			resetLink(*link);
+
+		// mosquitto 的连接是阻塞的，代理不可达时要等到内核的连接超时，期间 disconnect 无法返回；
+		// 先限时探测地址，可达后再完整连接，首次连接失败(如域名解析失败)后同样可用
+		int rc = probeEndpoint(endpoint);
+
+		if (rc == MOSQ_ERR_SUCCESS && _v5.enabled)
+		{
+			// clean start 为 false 时，会话在断开后保留 sessionExpiry 秒
+			mosquitto_property* properties = nullptr;
+			if (_v5.sessionExpiry > 0)
+				mosquitto_property_add_int32(&properties, MQTT_PROP_SESSION_EXPIRY_INTERVAL, _v5.sessionExpiry);
+
+			rc = mosquitto_connect_bind_v5(
+				link->mosq, endpoint.host.c_str(), endpoint.port, _keepalive, nullptr, properties);
+			mosquitto_property_free_all(&properties);
+		}
+		else if (rc == MOSQ_ERR_SUCCESS)
+		{
+			rc = mosquitto_connect(link->mosq, endpoint.host.c_str(), endpoint.port, _keepalive);
+		}
+
+		if (rc != MOSQ_ERR_SUCCESS)
+		{
+			{
+				std::lock_guard<std::mutex> lock(_connection_mutex);
+				if (_stopping)
+					break;
+
+				settlePrimary(*link);
+
+				++_failed_attempts;
+				_health[link->endpoint].healthy = false;
+				++_health[link->endpoint].failures;
+
+				// 本轮还有未尝试的地址时立即换下一个，全部失败后等待退避间隔，从最优先的地址重新开始
+				if (++attempts < candidates)
+				{
+					link->endpoint = nextEndpoint(*link, link->endpoint + 1);
+				}
+				else
+				{
+					attempts = 0;
+					link->endpoint = nextEndpoint(*link, 0);
+				}
+			}
+
+			LOG_WARN("连接MQTT代理 {}:{} 失败 - {}", endpoint.host, endpoint.port, mosquitto_strerror(rc));
+
+			if (attempts == 0 && !waitBackoff(*link, delay))
+				break;
+
+			continue;
+		}
+
+		attempts = 0;
+
+		// CONNACK、收发与心跳都在 loop 中处理，连接断开或被拒绝时返回错误；备用连接被切换为
+		// 主连接后在下一轮改由 epoll 驱动
+		while (rc == MOSQ_ERR_SUCCESS)
+		{
+			if (_io_mode == IoMode::Epoll && _active.load() == link)
+			{
+				rc = runEventLoop(*link);
+				break;
+			}
+
+			rc = mosquitto_loop(link->mosq, 100, 1);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_connection_mutex);
+			if (_stopping)
+				break;
+
+			// 未收到 CONNACK 就断开同样算主连接失败
+			settlePrimary(*link);
+		}
+
+		LOG_WARN("与MQTT代理 {}:{} 的连接断开 - {}", endpoint.host, endpoint.port, mosquitto_strerror(rc));
+
+		if (!waitBackoff(*link, delay))
+			break;
+	}
+}
+
+int MqttClientImpl::probeEndpoint(const Endpoint& endpoint)
+{
+	std::chrono::milliseconds timeout;
+
+	{
+		std::lock_guard<std::mutex> lock(_connection_mutex);
+		timeout = _reconnect.connectTimeout;
+	}
+
+	addrinfo hints{};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+
+	addrinfo* addresses = nullptr;
+	std::string service = std::to_string(endpoint.port);
+	if (getaddrinfo(endpoint.host.c_str(), service.c_str(), &hints, &addresses) != 0)
+		return MOSQ_ERR_EAI;
+
+	auto deadline = std::chrono::steady_clock::now() + timeout;
+	int rc = MOSQ_ERR_ERRNO;
+	int error = ETIMEDOUT;
+
+	for (addrinfo* address = addresses; address && rc != MOSQ_ERR_SUCCESS && !isStopping();
+		 address = address->ai_next)
+	{
+		int fd = ::socket(address->ai_family,
+						  address->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+						  address->ai_protocol);
+		if (fd < 0)
+		{
+			error = errno;
+			continue;
+		}
+
+		if (::connect(fd, address->ai_addr, address->ai_addrlen) == 0)
+		{
+			rc = MOSQ_ERR_SUCCESS;
+		}
+		else if (errno != EINPROGRESS)
+		{
+			error = errno;
+		}
+		else
+		{
+			// 分段等待，disconnect 时不必等到超时
+			while (!isStopping())
+			{
+				auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+					deadline - std::chrono::steady_clock::now());
+				if (remaining.count() <= 0)
+				{
+					error = ETIMEDOUT;
+					break;
+				}
+
+				pollfd pfd{ fd, POLLOUT, 0 };
+				int n = ::poll(&pfd, 1, static_cast<int>(std::min<int64_t>(remaining.count(), 100)));
+
+				if (n < 0 && errno != EINTR)
+				{
+					error = errno;
+					break;
+				}
+
+				if (n > 0)
+				{
+					socklen_t length = sizeof(error);
+					if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0)
+						error = errno;
+					else if (error == 0)
+						rc = MOSQ_ERR_SUCCESS;
+
+					break;
+				}
+			}
+		}
+
+		::close(fd);
+	}
+
+	freeaddrinfo(addresses);
+
+	// MOSQ_ERR_ERRNO 的说明取自 errno
+	if (rc != MOSQ_ERR_SUCCESS)
+		errno = error;
+
+	return rc;
+}
+
+void MqttClientImpl::settlePrimary(const Link& link)
+{
+	if (&link != _links.front().get() || _primary_tried)
+		return;
+
+	_primary_tried = true;
+	_connection_cv.notify_all();
+}
+
+bool MqttClientImpl::waitBackoff(Link& link, std::chrono::milliseconds& delay)
+{
+	thread_local std::mt19937 rng(std::random_device{}());
+
+	std::unique_lock<std::mutex> lock(_connection_mutex);
+
+	// 上次连接成功过，从最小间隔重新开始
+	if (link.resetBackoff)
+	{
+		delay = _reconnect.minDelay;
+		link.resetBackoff = false;
+	}
+
+	std::chrono::milliseconds wait;
+
+	// 备用连接只用于切换，按固定间隔探测
+	if (&link != _active.load())
+	{
+		wait = _failover.probeInterval;
+		LOG_DEBUG("{}ms 后探测MQTT代理 {}:{}",
+				  wait.count(),
+				  _endpoints[link.endpoint].host,
+				  _endpoints[link.endpoint].port);
+	}
+	else
+	{
+		std::uniform_int_distribution<int64_t> jitter(delay.count() / 2, delay.count());
+		wait = std::chrono::milliseconds(jitter(rng));
+		delay = std::min(delay * 2, _reconnect.maxDelay);
+
+		LOG_INFO("{}ms 后重连MQTT代理", wait.count());
+	}
+
+	bool stopped = _connection_cv.wait_for(lock, wait, [this]() { return _stopping; });
+	return !stopped;
+}
+
+void MqttClientImpl::resubscribe(Link& link)
+{
+	if (!_job_queue)
+		return;
+
+	std::unordered_map<std::string, int> subscriptions;
+
+	{
+		std::lock_guard<std::mutex> lock(_callback_mutex);
+		subscriptions = _subscriptions;
+	}
+
+	if (subscriptions.empty())
+		return;
+
+	_job_queue->submit([this, &link, subscriptions = std::move(subscriptions)]() {
+		std::shared_lock<std::shared_mutex> lock(link.mutex);
+
+		for (const auto& [topic, qos] : subscriptions)
+		{
+			int rc = mosquitto_subscribe(link.mosq, nullptr, topic.c_str(), qos);
+
+			if (rc != MOSQ_ERR_SUCCESS)
+			{
+				LOG_ERROR("重新订阅失败 - {}: {}", topic, mosquitto_strerror(rc));
+				return;
+			}
+		}
+
+		wake();
+		LOG_INFO("已重新订阅 {} 个主题", subscriptions.size());
+	});
+}
+
+int MqttClientImpl::runEventLoop(Link& link)
+{
+	int fd = mosquitto_socket(link.mosq);
+	int epfd = epoll_create1(EPOLL_CLOEXEC);
+
+	if (fd < 0 || epfd < 0)
+	{
+		if (epfd >= 0)
+			::close(epfd);
+
+		return MOSQ_ERR_NO_CONN;
+	}
+
+	epoll_event ev = {};
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+
+	ev.data.fd = _wake_fd;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, _wake_fd, &ev);
+
+	uint32_t watched = EPOLLIN;
+	int rc = MOSQ_ERR_SUCCESS;
+
+	while (rc == MOSQ_ERR_SUCCESS && !isStopping())
+	{
+		// 只在有待发数据时关注可写，避免空转
+		uint32_t wanted = mosquitto_want_write(link.mosq) ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+		if (wanted != watched)
+		{
+			ev.events = wanted;
+			ev.data.fd = fd;
+			epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev);
+			watched = wanted;
+		}
+
+		// 超时保证 loop_misc 按时发送心跳
+		epoll_event events[2];
+		int n = epoll_wait(epfd, events, 2, 1000);
+
+		if (n < 0 && errno != EINTR)
+		{
+			LOG_ERROR("MQTT epoll_wait 失败 - {}", strerror(errno));
+			rc = MOSQ_ERR_ERRNO;
+			break;
+		}
+
+		for (int i = 0; i < n && rc == MOSQ_ERR_SUCCESS; ++i)
+		{
+			if (events[i].data.fd == _wake_fd)
+			{
+				eventfd_t value;
+				eventfd_read(_wake_fd, &value);
+
+				// 其他线程刚发布的消息直接写出，无需等下一轮可写事件
+				if (mosquitto_want_write(link.mosq))
+					rc = mosquitto_loop_write(link.mosq, 16);
+
+				continue;
+			}
+
+			if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+				rc = mosquitto_loop_read(link.mosq, 16);
+
+			if (rc == MOSQ_ERR_SUCCESS && (events[i].events & EPOLLOUT))
+				rc = mosquitto_loop_write(link.mosq, 16);
+		}
+
+		if (rc == MOSQ_ERR_SUCCESS)
+			rc = mosquitto_loop_misc(link.mosq);
+	}
+
+	// 停止时尽量把 DISCONNECT 发出去
+	if (rc == MOSQ_ERR_SUCCESS && mosquitto_want_write(link.mosq))
+		mosquitto_loop_write(link.mosq, 16);
+
+	::close(epfd);
+	return rc;
+}
+
+void MqttClientImpl::wake()
+{
+	if (_wake_fd >= 0)
+		eventfd_write(_wake_fd, 1);
+}
+
+bool MqttClientImpl::isStopping() const
+{
+	std::lock_guard<std::mutex> lock(_connection_mutex);
+	return _stopping;
+}
+
+bool MqttClientImpl::findSubscriber(const std::string& topic, Subscriber& subscriber) const
+{
+	std::lock_guard<std::mutex> lock(_callback_mutex);
+
+	// 简单的字符串匹配，只取第一个匹配的回调；复制后在锁外调用，回调中可以登记回调或订阅
+	for (const auto& pair : _message_callbacks)
+	{
+		if (topic.find(pair.first) == std::string::npos)
+			continue;
+
+		if (!pair.second.callback)
+			return false;
+
+		subscriber = pair.second;
+		return true;
+	}
+
+	return false;
+}
+
+bool MqttClientImpl::canRunInline(const JobQueue& queue) const
+{
+	// 已取出但仍在执行的任务同样会被当前线程超过
+	return _io_mode == IoMode::Epoll && _wake_fd >= 0 && queue.getPendingCount() == 0;
+}
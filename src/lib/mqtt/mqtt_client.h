@@ -1,18 +1,81 @@
 #ifndef MQTT_CLIENT_H
 #define MQTT_CLIENT_H
 
-#include <mosquittopp.h>
+#include <chrono>
+#include <condition_variable>
+#include <shared_mutex>
+#include <thread>
+
+#include <mosquitto.h>
+#include <json/json.h>
 
 #include <defines.h>
 #include <mqtt/job.h>
+#include <mqtt/mqtt_outbox.h>
+#include <mqtt/publish_properties.h>
+#include <utils/buffer_pool.h>
 #include <utils/config.h>
 
-class CORE_API MqttClientImpl : public mosqpp::mosquittopp
+class CORE_API MqttClientImpl
 {
 public:
 	using MessageCallback = std::function<void(const std::string&, const std::vector<uint8_t>&)>;
 	using ConnectCallback = std::function<void(int)>;
 	using DisconnectCallback = std::function<void()>;
+	// 发布结果：true 表示已交给网络(QoS 0)、收到 PUBACK(QoS 1/2)或已转入发件箱，false 表示
+	// 发布失败或连接断开时丢弃
+	using PublishCallback = std::function<void(bool)>;
+
+	// 网络 I/O 方式
+	enum class IoMode
+	{
+		Loop,  // 网络线程调用 mosquitto loop()，收发消息经任务队列中转
+		Epoll  // 网络线程以 epoll 驱动 loop_read/loop_write/loop_misc，任务队列空闲时
+			   // 直接在调用线程发布、在网络线程分发标记为 inline 的消息回调
+	};
+
+	// 断线重连的退避间隔：每次失败翻倍，直到上限；实际等待在 [间隔/2, 间隔] 内随机，
+	// 避免大量网关同时重连
+	struct ReconnectOptions
+	{
+		std::chrono::milliseconds minDelay{ 500 };
+		std::chrono::milliseconds maxDelay{ 30000 };
+		// 建立 TCP 连接的时限，代理不可达时不等待内核的连接超时
+		std::chrono::milliseconds connectTimeout{ 5000 };
+	};
+
+	// 代理地址，多个地址按优先顺序排列
+	struct Endpoint
+	{
+		std::string host;
+		int port = 1883;
+	};
+
+	// 多个代理地址时的故障切换
+	struct FailoverOptions
+	{
+		// 与另一个可用代理保持一条已完成 CONNECT 的备用连接，主连接断开时直接切换，
+		// 无需重新建立 TCP 连接和 CONNECT；为 false 时断开后按顺序逐个重连
+		bool warmStandby = true;
+		// 备用连接不可用时探测其他地址的间隔
+		std::chrono::milliseconds probeInterval{ 5000 };
+	};
+
+	// MQTT v5：发布属性、主题别名和会话保留时间
+	struct V5Options
+	{
+		bool enabled = false;
+		uint16_t topicAliasMaximum = 32; // QoS 0 发布使用的主题别名数上限(再受代理限制)，0 表示不使用
+		uint32_t sessionExpiry = 0;		 // 断开后代理保留会话的时间(秒)，持久会话须大于 0
+	};
+
+	// 消息回调的分发方式
+	struct DispatchOptions
+	{
+		bool inlineDispatch = false; // epoll 模式下可直接在网络线程调用，回调须很快返回
+		bool emptyPayload = false;	 // 也接收空消息(如被清除的保留消息)，否则丢弃
+		bool ordered = false;		 // 与其他有序回调一起按到达顺序在同一个线程中依次调用
+	};
 
 	MqttClientImpl(const std::string& client_id = "", bool clean_session = true);
 
@@ -23,17 +86,51 @@ public:
 
 	~MqttClientImpl();
 
-	// 连接到MQTT代理
+	MqttClientImpl(const MqttClientImpl&) = delete;
+	MqttClientImpl& operator=(const MqttClientImpl&) = delete;
+
+	// 连接到MQTT代理，由网络线程在后台建立连接，失败或断开后按退避间隔重连；
+	// 已启动时返回 false
 	bool connect(const std::string& host, int port = 1883, int keepalive = 60);
 
-	// 断开连接
+	// 连接到按优先顺序排列的一组代理，连接失败时依次尝试下一个地址
+	bool connect(const std::vector<Endpoint>& endpoints, int keepalive = 60);
+
+	// 断开连接并停止重连
 	void disconnect();
 
-	// 发布消息（异步）
+	// 须在连接前设置
+	void setReconnect(const ReconnectOptions& options);
+
+	// 须在连接前设置
+	void setIoMode(IoMode mode);
+
+	// 须在连接前设置
+	void setV5(const V5Options& options);
+
+	// 须在连接前设置
+	void setFailover(const FailoverOptions& options);
+
+	// 遗嘱消息：连接异常断开时由代理发布；须在连接前设置，之后每次重连沿用
+	void setWill(const std::string& topic, const std::string& payload, int qos = 1, bool retain = true);
+
+	// 等待已提交的发布、订阅交给 mosquitto，用于断开前发出最后的消息
+	void flush();
+
+	// 发布消息（异步）；properties 只在 v5 连接上发送
 	void publishAsync(const std::string& topic,
 					  const std::vector<uint8_t>& payload,
 					  int qos = 0,
-					  bool retain = false);
+					  bool retain = false,
+					  PublishProperties properties = PublishProperties());
+
+	// 发布消息（异步），payload 以引用计数句柄传递，不复制数据
+	void publishAsync(const std::string& topic,
+					  Buffer payload,
+					  int qos = 0,
+					  bool retain = false,
+					  PublishCallback done = nullptr,
+					  PublishProperties properties = PublishProperties());
 
 	// 订阅主题（异步）
 	void subscribeAsync(const std::string& topic, int qos = 0);
@@ -41,8 +138,11 @@ public:
 	// 取消订阅（异步）
 	void unsubscribeAsync(const std::string& topic);
 
-	// 设置消息回调
+	// 设置消息回调，默认经任务队列并行调用
 	void setMessageCallback(const std::string& topic, MessageCallback callback);
+	void setMessageCallback(const std::string& topic,
+							MessageCallback callback,
+							const DispatchOptions& dispatch);
 
 	// 设置连接回调
 	void setConnectCallback(ConnectCallback callback);
@@ -53,32 +153,219 @@ public:
 	// 获取连接状态
 	bool isConnected() const;
 
-protected:
-	// mosquittopp回调函数
-	void on_connect(int rc) override;
-	void on_disconnect(int rc) override;
-	void on_message(const struct mosquitto_message* message) override;
-	void on_publish(int mid) override;
-	void on_subscribe(int mid, int qos_count, const int* granted_qos) override;
-	void on_unsubscribe(int mid) override;
+	// QoS 1/2 未确认消息的上限，超出的消息由 mosquitto 排队，0 表示不限制；须在连接前设置
+	void setMaxInflight(unsigned int count);
+
+	// 发件箱(等待确认的消息)与 PUBACK 延迟统计
+	Json::Value getPublishStats() const;
+
+	// 与代理断开期间把无法发布的消息存入 outbox，重连后由其重新发布；outbox 须比客户端
+	// 存活更久，并在客户端析构前停止。多个客户端共用一个 outbox 时，只有 drain 为 true 的
+	// 客户端负责重新发布，其余的只存入。须在连接前设置
+	void setOutbox(MqttOutbox* outbox, bool drain = true);
+
+	// 连接次数、重连耗时、故障切换等统计
+	Json::Value getConnectionStats() const;
+
+private:
+	// 到代理的一条连接；启用热备时有两条，_active 指向承载发布和订阅的一条，另一条只保持连接
+	struct Link
+	{
+		MqttClientImpl* owner = nullptr;
+		uint32_t index = 0;
+		struct mosquitto* mosq = nullptr;
+		// 客户端标识，备用连接加 "-standby" 后缀，避免共享会话的代理集群以同一标识互相挤掉
+		std::string clientId;
+		// 发布、订阅等调用持共享锁，网络线程重建句柄时持独占锁
+		std::shared_mutex mutex;
+		std::thread thread;
+		// 以下受 _connection_mutex 保护
+		size_t endpoint = 0;		   // 当前使用的地址在 _endpoints 中的位置
+		bool up = false;			   // 已收到 CONNACK
+		bool reset = false;			   // 被切换掉后重连前须丢弃 mosquitto 中排队的消息
+		bool resetBackoff = false;	   // 连接成功过，退避间隔从最小值重新开始
+		uint16_t aliasMaximum = 0;	   // CONNACK 中代理允许的主题别名数
+	};
+
+	// mosquitto回调函数，v3.1.1 连接时属性为空
+	void on_connect(Link& link, int rc, const mosquitto_property* properties);
+	void on_disconnect(Link& link, int rc);
+	void on_message(const struct mosquitto_message* message);
+	void on_publish(Link& link, int mid, int reason);
+
+	static void connectCallback(struct mosquitto*, void* obj, int rc, int flags, const mosquitto_property* properties);
+	static void disconnectCallback(struct mosquitto*, void* obj, int rc, const mosquitto_property*);
+	static void publishCallback(struct mosquitto*, void* obj, int mid, int reason, const mosquitto_property*);
+	static void messageCallback(struct mosquitto*,
+								void* obj,
+								const struct mosquitto_message* message,
+								const mosquitto_property*);
 
 private:
+	std::vector<std::unique_ptr<Link>> _links;
+	std::atomic<Link*> _active;
+
+	struct Subscriber
+	{
+		MessageCallback callback;
+		DispatchOptions dispatch;
+	};
+
 	mutable std::mutex _callback_mutex;
-	std::unordered_map<std::string, MessageCallback> _message_callbacks;
+	std::unordered_map<std::string, Subscriber> _message_callbacks;
 	ConnectCallback _connect_callback;
 	DisconnectCallback _disconnect_callback;
 
+	// 启用热备时 QoS 1/2 消息的副本，切换代理后在新连接上重新发布
+	struct Resend
+	{
+		std::string topic;
+		std::vector<uint8_t> payload;
+		bool retain;
+		PublishProperties properties;
+	};
+
+	// 发件箱：等待 on_publish 的消息，QoS 0 只登记带回调的消息
+	struct Outbound
+	{
+		PublishCallback done;
+		int qos;
+		std::chrono::steady_clock::time_point published;
+		std::shared_ptr<const Resend> resend;
+	};
+
+	mutable std::mutex _publish_mutex;
+	// 键为 outboundKey(连接, mid)，各连接的 mid 独立编号
+	std::unordered_map<uint64_t, Outbound> _outbox;
+	unsigned int _max_inflight;
+	uint64_t _published[3];
+	uint64_t _acked;
+	uint64_t _failed;
+	uint64_t _ack_latency_total_us;
+	uint64_t _ack_latency_max_us;
+
+	// 吞吐统计，速率按两次读取统计的间隔计算
+	std::atomic<uint64_t> _sent_messages;
+	std::atomic<uint64_t> _sent_bytes;
+	mutable std::chrono::steady_clock::time_point _rate_time;
+	mutable uint64_t _rate_messages;
+	mutable uint64_t _rate_bytes;
+
+	MqttOutbox* _disk_outbox;
+	bool _drain_outbox;
+
+	// 已订阅的主题，每次连接成功后重新订阅
+	std::unordered_map<std::string, int> _subscriptions;
+
+	// 网络线程与重连统计
+	mutable std::mutex _connection_mutex;
+	std::condition_variable _connection_cv;
+	ReconnectOptions _reconnect;
+	FailoverOptions _failover;
+	std::vector<Endpoint> _endpoints;
+	int _keepalive;
+	bool _stopping;
+	bool _primary_tried; // 主连接第一次连接已有结果(成功或失败)，此后才启动备用连接
+	uint64_t _connects;
+	uint64_t _disconnects;
+	uint64_t _failed_attempts;
+	uint64_t _last_reconnect_ms;
+	uint64_t _max_reconnect_ms;
+	std::chrono::steady_clock::time_point _outage_start;
+
+	// 各地址的探测结果
+	struct EndpointHealth
+	{
+		bool healthy = false;
+		uint64_t failures = 0;
+	};
+
+	std::vector<EndpointHealth> _health;
+	uint64_t _failovers;
+	std::atomic<uint64_t> _replayed;
+
+	// epoll 模式：其他线程发布后通过 eventfd 唤醒网络线程写出
+	IoMode _io_mode;
+	int _wake_fd;
+	std::atomic<uint64_t> _inline_publishes;
+	std::atomic<uint64_t> _inline_messages;
+
+	// v5 主题别名：每条连接重新分配，QoS 0 消息首次发布带完整主题，之后只带别名
+	V5Options _v5;
+	std::mutex _alias_mutex;
+	std::unordered_map<std::string, uint16_t> _aliases;
+	uint16_t _alias_limit;
+	std::atomic<uint64_t> _aliased_messages;
+
 	std::unique_ptr<JobQueue> _job_queue;
+	// 发布只用一个线程按提交顺序执行，同一设备的消息不会被另一个线程超过
+	std::unique_ptr<JobQueue> _publish_queue;
+	// 有序回调只用一个线程，先到的消息处理完才处理后到的
+	std::unique_ptr<JobQueue> _ordered_queue;
 	std::atomic<bool> _connected;
 	std::string _client_id;
 	std::string _username;
 	std::string _password;
+	bool _clean_session;
+
+	// 遗嘱消息，重建连接句柄时重新设置
+	bool _has_will;
+	std::string _will_topic;
+	std::string _will_payload;
+	int _will_qos;
+	bool _will_retain;
 
 
 	// 内部辅助函数
+	std::unique_ptr<Link> createLink(uint32_t index);
+	// 设置回调与连接选项，新建或重建句柄后调用
+	void configure(Link& link);
+	// 丢弃句柄中排队的消息，其中登记过的消息在当前连接上重新发布
+	void resetLink(Link& link);
+	// 连接成为主连接：使用其主题别名上限，重新订阅，from 不为空时重新发布其未确认的消息
+	void activate(Link& link, Link* from);
+	// 在当前主连接上重新发布 link 上未确认的 QoS 1/2 消息
+	void replayPending(Link& link);
+	// 从 from 开始按顺序选择下一个地址，跳过另一条连接正在使用的，调用方持有 _connection_mutex
+	size_t nextEndpoint(const Link& link, size_t from) const;
+	static uint64_t outboundKey(const Link& link, int mid);
 	void handleConnectAsync(int rc);
 	void handleDisconnectAsync(int rc);
-	void handleMessageAsync(const std::string& topic, const std::vector<uint8_t>& data);
+	// spool 为 true 时，断开期间或因断开发布失败的消息转入发件箱
+	int publishTracked(const std::string& topic,
+					   const void* payload,
+					   int size,
+					   int qos,
+					   bool retain,
+					   PublishCallback done,
+					   const PublishProperties& properties = PublishProperties(),
+					   bool spool = true);
+	// 调用方持有 _publish_mutex(需要登记时)，v5 下按需使用主题别名
+	int publishV5(Link& link,
+				  int* mid,
+				  const std::string& topic,
+				  const void* payload,
+				  int size,
+				  int qos,
+				  bool retain,
+				  const PublishProperties& properties);
+	void failPendingPublishes(const Link& link);
+	void networkLoop(Link* link);
+	// 以限时的非阻塞连接探测地址是否可达，返回 mosquitto 错误码，disconnect 时提前返回
+	int probeEndpoint(const Endpoint& endpoint);
+	// 以 epoll 驱动已建立的主连接，断开或停止时返回
+	int runEventLoop(Link& link);
+	void wake();
+	bool isStopping() const;
+	// 复制 topic 匹配的第一个回调，没有时返回 false
+	bool findSubscriber(const std::string& topic, Subscriber& subscriber) const;
+	// epoll 模式下 queue 中没有排队或正在执行的任务时可跳过该队列
+	bool canRunInline(const JobQueue& queue) const;
+	void resubscribe(Link& link);
+	// link 为主连接时记录其第一次连接已有结果，放行等待中的备用连接，调用方持有 _connection_mutex
+	void settlePrimary(const Link& link);
+	// 等待退避间隔(备用连接为探测间隔)，disconnect 时提前返回 false
+	bool waitBackoff(Link& link, std::chrono::milliseconds& delay);
 };
 
 
@@ -0,0 +1,420 @@
+#include <mqtt/mqtt_outbox.h>
+#include <utils/logger.h>
+
+#include <cstddef>
+#include <cstring>
+
+namespace {
+
+	// 段文件格式：64 字节文件头，之后为顺序追加的记录，magic 不匹配处为日志结尾
+	constexpr uint32_t kFileMagic = 0x584F4242;	  // "BBOX"
+	constexpr uint32_t kRecordMagic = 0x47534D42; // "BMSG"
+	constexpr uint32_t kVersion = 1;
+	constexpr size_t kHeaderSize = 64;
+
+	// 重新发布失败(连接刚断开)后的重试间隔
+	constexpr std::chrono::seconds kRetryWait(1);
+
+	enum RecordState : uint8_t
+	{
+		kWriting = 0,
+		kLive = 1,
+		kConsumed = 2
+	};
+
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+	};
+
+	// 记录头之后依次为主题、消息体和 v5 属性；旧文件中 propertiesLength 所在字节为 0
+	struct RecordHeader
+	{
+		uint32_t magic;
+		uint32_t length;
+		uint16_t topicLength;
+		uint8_t qos;
+		uint8_t retain;
+		uint8_t state;
+		uint8_t reserved;
+		uint16_t propertiesLength;
+		int64_t enqueuedMs;
+	};
+
+	static_assert(sizeof(RecordHeader) == 24, "RecordHeader 布局变化会破坏已有文件");
+
+	size_t recordSize(size_t topicLength, size_t length, size_t propertiesLength = 0)
+	{
+		return (sizeof(RecordHeader) + topicLength + length + propertiesLength + 7) & ~size_t(7);
+	}
+
+	void terminate(MappedFile& file, size_t offset)
+	{
+		if (offset + sizeof(uint32_t) <= file.size())
+			std::memset(file.data() + offset, 0, sizeof(uint32_t));
+	}
+}
+
+MqttOutbox::MqttOutbox(const Options& options, Classifier classifier)
+	: _options(options),
+	  _classifier(std::move(classifier)),
+	  _writeOffset(kHeaderSize),
+	  _bytes(0),
+	  _nextId(1),
+	  _connected(false),
+	  _stopping(false),
+	  _stored(0),
+	  _drained(0)
+{
+	if (_options.drainRate == 0)
+		_options.drainRate = 1;
+
+	if (_options.path.empty())
+		return;
+
+	if (_options.fileSize < kHeaderSize + recordSize(0, 0) || !_file.open(_options.path, _options.fileSize))
+	{
+		LOG_WARN("MQTT 发件箱文件不可用，断开期间的消息将被丢弃 - {}", _options.path);
+		_file.close();
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	load();
+}
+
+MqttOutbox::~MqttOutbox() { stop(); }
+
+void MqttOutbox::start(Publisher publisher)
+{
+	if (!_file.isOpen() || _thread.joinable())
+		return;
+
+	_publisher = std::move(publisher);
+	_thread = std::thread(&MqttOutbox::run, this);
+}
+
+void MqttOutbox::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+
+	_cv.notify_one();
+
+	if (_thread.joinable())
+		_thread.join();
+
+	if (_file.isOpen())
+		_file.sync(false);
+}
+
+bool MqttOutbox::push(const std::string& topic,
+					  const void* payload,
+					  size_t size,
+					  int qos,
+					  bool retain,
+					  const std::string& properties)
+{
+	if (!_file.isOpen())
+		return false;
+
+	std::string category = _classifier ? _classifier(topic) : std::string();
+	size_t need = recordSize(topic.size(), size, properties.size());
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if (policyFor(category) == Policy::Discard || topic.size() > UINT16_MAX ||
+			properties.size() > UINT16_MAX || need > _file.size() - kHeaderSize ||
+			!makeRoom(category, need))
+		{
+			++_dropped[category];
+			return false;
+		}
+
+		Clock::time_point now = Clock::now();
+		uint8_t* p = _file.data() + _writeOffset;
+
+		RecordHeader record = {};
+		record.magic = kRecordMagic;
+		record.length = static_cast<uint32_t>(size);
+		record.topicLength = static_cast<uint16_t>(topic.size());
+		record.qos = static_cast<uint8_t>(qos);
+		record.retain = retain ? 1 : 0;
+		record.state = kWriting;
+		record.propertiesLength = static_cast<uint16_t>(properties.size());
+		record.enqueuedMs =
+			std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+
+		// 先写内容和结尾标记，最后置为有效
+		std::memcpy(p, &record, sizeof(record));
+		std::memcpy(p + sizeof(record), topic.data(), topic.size());
+		std::memcpy(p + sizeof(record) + topic.size(), payload, size);
+		std::memcpy(p + sizeof(record) + topic.size() + size, properties.data(), properties.size());
+		terminate(_file, _writeOffset + need);
+		p[offsetof(RecordHeader, state)] = kLive;
+
+		if (_entries.empty())
+			LOG_WARN("MQTT 消息转入发件箱 - {}", _options.path);
+
+		_entries.push_back({ _nextId++, _writeOffset, need, topic, category, now });
+		_writeOffset += need;
+		_bytes += need;
+		++_stored;
+	}
+
+	_cv.notify_one();
+	return true;
+}
+
+void MqttOutbox::setConnected(bool connected)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_connected = connected;
+	}
+
+	_cv.notify_one();
+}
+
+Json::Value MqttOutbox::getStats() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	Json::Value root;
+	Json::Value dropped(Json::objectValue);
+
+	for (const auto& [category, count] : _dropped)
+		dropped[category.empty() ? "default" : category] = static_cast<Json::UInt64>(count);
+
+	int64_t oldestMs = 0;
+	if (!_entries.empty())
+	{
+		oldestMs = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() -
+																		 _entries.front().enqueued)
+					   .count();
+	}
+
+	root["persistent"] = _file.isOpen();
+	root["capacity"] = static_cast<Json::UInt64>(_file.size());
+	root["depth"] = static_cast<Json::UInt64>(_entries.size());
+	root["bytes"] = static_cast<Json::UInt64>(_bytes);
+	root["oldestAgeMs"] = static_cast<Json::Int64>(oldestMs);
+	root["draining"] = _connected && !_entries.empty();
+	root["stored"] = static_cast<Json::UInt64>(_stored);
+	root["drained"] = static_cast<Json::UInt64>(_drained);
+	root["dropped"] = dropped;
+	return root;
+}
+
+bool MqttOutbox::parsePolicy(const std::string& name, Policy& policy)
+{
+	if (name == "discard")
+		policy = Policy::Discard;
+	else if (name == "drop_oldest")
+		policy = Policy::DropOldest;
+	else if (name == "drop_newest")
+		policy = Policy::DropNewest;
+	else
+		return false;
+
+	return true;
+}
+
+void MqttOutbox::run()
+{
+	auto interval = std::chrono::microseconds(1000000 / _options.drainRate);
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (!_stopping)
+	{
+		_cv.wait(lock, [this]() { return _stopping || (_connected && !_entries.empty()); });
+
+		if (_stopping)
+			break;
+
+		// 复制最早的消息，发布期间允许追加、丢弃或压缩
+		uint64_t id = _entries.front().id;
+		std::string topic = _entries.front().topic;
+		const uint8_t* p = _file.data() + _entries.front().offset;
+
+		RecordHeader record;
+		std::memcpy(&record, p, sizeof(record));
+
+		const uint8_t* payload = p + sizeof(record) + record.topicLength;
+		std::vector<uint8_t> data(payload, payload + record.length);
+		std::string properties(reinterpret_cast<const char*>(payload + record.length),
+							   record.propertiesLength);
+
+		lock.unlock();
+		bool ok = _publisher && _publisher(topic, data, record.qos, record.retain != 0, properties);
+		lock.lock();
+
+		if (!ok)
+		{
+			_cv.wait_for(lock, kRetryWait, [this]() { return _stopping; });
+			continue;
+		}
+
+		if (!_entries.empty() && _entries.front().id == id)
+		{
+			markConsumed(_entries.front());
+			_bytes -= _entries.front().size;
+			_entries.pop_front();
+		}
+
+		++_drained;
+
+		if (_entries.empty())
+		{
+			_writeOffset = kHeaderSize;
+			terminate(_file, _writeOffset);
+			_file.sync(true);
+
+			LOG_INFO("MQTT 发件箱已清空，累计重新发布 {} 条", _drained);
+		}
+
+		// 限速，避免重连后积压的消息挤占实时流量
+		_cv.wait_for(lock, interval, [this]() { return _stopping; });
+	}
+}
+
+void MqttOutbox::load()
+{
+	uint8_t* base = _file.data();
+	FileHeader header;
+	std::memcpy(&header, base, sizeof(header));
+
+	if (header.magic != kFileMagic || header.version != kVersion)
+	{
+		header = { kFileMagic, kVersion };
+		std::memset(base, 0, kHeaderSize);
+		std::memcpy(base, &header, sizeof(header));
+		terminate(_file, kHeaderSize);
+		return;
+	}
+
+	size_t offset = kHeaderSize;
+
+	while (offset + sizeof(RecordHeader) <= _file.size())
+	{
+		RecordHeader record;
+		std::memcpy(&record, base + offset, sizeof(record));
+
+		size_t size = recordSize(record.topicLength, record.length, record.propertiesLength);
+
+		if (record.magic != kRecordMagic || record.state == kWriting || offset + size > _file.size())
+			break;
+
+		if (record.state == kLive)
+		{
+			std::string topic(reinterpret_cast<const char*>(base + offset + sizeof(record)),
+							  record.topicLength);
+			std::string category = _classifier ? _classifier(topic) : std::string();
+
+			_entries.push_back({ _nextId++,
+								 offset,
+								 size,
+								 std::move(topic),
+								 std::move(category),
+								 Clock::time_point(std::chrono::milliseconds(record.enqueuedMs)) });
+			_bytes += size;
+		}
+
+		offset += size;
+	}
+
+	_writeOffset = offset;
+	terminate(_file, _writeOffset);
+
+	if (!_entries.empty())
+	{
+		compact();
+		LOG_INFO("已从 {} 恢复 MQTT 发件箱消息 {} 条", _options.path, _entries.size());
+	}
+}
+
+MqttOutbox::Policy MqttOutbox::policyFor(const std::string& category) const
+{
+	auto it = _options.policies.find(category);
+	return it != _options.policies.end() ? it->second : _options.defaultPolicy;
+}
+
+bool MqttOutbox::makeRoom(const std::string& category, size_t size)
+{
+	if (_writeOffset + size <= _file.size())
+		return true;
+
+	size_t capacity = _file.size() - kHeaderSize;
+
+	// 中间有已丢弃的记录时压缩即可
+	if (_bytes + size <= capacity)
+	{
+		compact();
+		return true;
+	}
+
+	if (policyFor(category) != Policy::DropOldest)
+		return false;
+
+	size_t reclaimable = 0;
+	for (const auto& entry : _entries)
+	{
+		if (entry.category == category)
+			reclaimable += entry.size;
+	}
+
+	if (_bytes - reclaimable + size > capacity)
+		return false;
+
+	// 从最早的开始丢弃同类消息，多腾出 1/16 容量，避免写满后每条消息都压缩一次
+	size_t slack = capacity / 16;
+	uint64_t dropped = 0;
+	for (auto it = _entries.begin(); it != _entries.end() && _bytes + size + slack > capacity;)
+	{
+		if (it->category != category)
+		{
+			++it;
+			continue;
+		}
+
+		markConsumed(*it);
+		_bytes -= it->size;
+		it = _entries.erase(it);
+		++dropped;
+	}
+
+	_dropped[category] += dropped;
+	LOG_DEBUG("MQTT 发件箱已满，丢弃最早的 {} 消息 {} 条", category, dropped);
+
+	compact();
+	return true;
+}
+
+void MqttOutbox::compact()
+{
+	// 记录按偏移递增排列，依次前移不会覆盖未移动的记录
+	uint8_t* base = _file.data();
+	size_t offset = kHeaderSize;
+
+	for (auto& entry : _entries)
+	{
+		if (entry.offset != offset)
+			std::memmove(base + offset, base + entry.offset, entry.size);
+
+		entry.offset = offset;
+		offset += entry.size;
+	}
+
+	_writeOffset = offset;
+	terminate(_file, _writeOffset);
+	_file.sync(true);
+}
+
+void MqttOutbox::markConsumed(const Entry& entry)
+{
+	_file.data()[entry.offset + offsetof(RecordHeader, state)] = kConsumed;
+}
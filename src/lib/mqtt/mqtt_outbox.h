@@ -0,0 +1,125 @@
+#ifndef MQTT_OUTBOX_H_
+#define MQTT_OUTBOX_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <json/json.h>
+
+#include <defines.h>
+#include <utils/mapped_file.h>
+
+// 与代理断开期间的发件箱
+//
+// 无法发布的消息追加到内存映射的段文件中(固定大小)，重连后由发送线程按入队顺序、以
+// 限定的速率重新发布。消息体原样保存，其中的 stream/seq 不变，消费端据此排序去重。
+// 文件写满时按主题分类的策略丢弃；重启后恢复未发出的消息。
+class CORE_API MqttOutbox
+{
+public:
+	using Clock = std::chrono::system_clock;
+	using Classifier = std::function<std::string(const std::string&)>;
+	// 重新发布一条消息(主题、消息体、QoS、retain、序列化的 v5 属性)，返回是否已交给 MQTT 客户端
+	using Publisher = std::function<
+		bool(const std::string&, const std::vector<uint8_t>&, int, bool, const std::string&)>;
+
+	enum class Policy
+	{
+		Discard,	// 不进入发件箱
+		DropOldest, // 写满时丢弃同类最早的消息
+		DropNewest	// 写满时丢弃新消息
+	};
+
+	struct Options
+	{
+		std::string path;						 // 段文件路径
+		size_t fileSize = 16 * 1024 * 1024;		 // 段文件大小，即发件箱容量上限
+		size_t drainRate = 200;					 // 重连后每秒重新发布的消息数
+		std::unordered_map<std::string, Policy> policies; // 按主题分类的丢弃策略
+		Policy defaultPolicy = Policy::DropOldest;
+	};
+
+	MqttOutbox(const Options& options, Classifier classifier);
+
+	~MqttOutbox();
+
+	MqttOutbox(const MqttOutbox&) = delete;
+	MqttOutbox& operator=(const MqttOutbox&) = delete;
+
+	// 段文件是否可用，不可用时 push 总是返回 false
+	bool isOpen() const { return _file.isOpen(); }
+
+	// 启动发送线程
+	void start(Publisher publisher);
+
+	// 停止发送线程，须在 MQTT 客户端析构前调用
+	void stop();
+
+	// 保存一条消息，properties 为序列化的 v5 属性，按策略丢弃时返回 false
+	bool push(const std::string& topic,
+			  const void* payload,
+			  size_t size,
+			  int qos,
+			  bool retain,
+			  const std::string& properties = std::string());
+
+	// 与代理的连接状态，连接后开始重新发布
+	void setConnected(bool connected);
+
+	// 深度、最早消息的等待时间、丢弃等统计
+	Json::Value getStats() const;
+
+	static bool parsePolicy(const std::string& name, Policy& policy);
+
+private:
+	struct Entry
+	{
+		uint64_t id;
+		size_t offset;
+		size_t size; // 记录占用的字节数
+		std::string topic;
+		std::string category;
+		Clock::time_point enqueued;
+	};
+
+	void run();
+
+	// 以下调用方持有锁
+	void load();
+	Policy policyFor(const std::string& category) const;
+	bool makeRoom(const std::string& category, size_t size);
+	void compact();
+	void markConsumed(const Entry& entry);
+
+private:
+	Options _options;
+	Classifier _classifier;
+	Publisher _publisher;
+	MappedFile _file;
+
+	mutable std::mutex _mutex;
+	std::condition_variable _cv;
+	std::deque<Entry> _entries;
+	size_t _writeOffset;
+	size_t _bytes;
+	uint64_t _nextId;
+	bool _connected;
+	bool _stopping;
+
+	uint64_t _stored;
+	uint64_t _drained;
+	std::unordered_map<std::string, uint64_t> _dropped;
+
+	std::thread _thread;
+};
+
+#endif // MQTT_OUTBOX_H_
@@ -1,66 +1,206 @@
 #include <mqtt/mqtt_proxy.h>
+#include <mqtt/command_decoder.h>
 #include <utils/base64.h>
 #include <utils/logger.h>
+#include <utils/string_utils.h>
 
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
 #include <mutex>
 #include <random>
 #include <iomanip>
+#include <unistd.h>
 
 namespace {
 
-	// 生成UUID字符串的局部函数
-	std::string generateUUID()
+	// 写入 36 字节的 UUID 字符串(不含结尾符)
+	void writeUUID(char* out)
 	{
-		std::random_device rd;
-		std::mt19937 gen(rd());
+		static const char* hex = "0123456789abcdef";
+		thread_local std::mt19937 gen(std::random_device{}());
 		std::uniform_int_distribution<> dis(0, 15);
 		std::uniform_int_distribution<> dis2(8, 11);
 
-		std::stringstream ss;
-
 		// UUID格式: xxxxxxxx-xxxx-4xxx-yxxx-xxxxxxxxxxxx
-		for (int i = 0; i < 8; i++)
-		{
-			ss << std::hex << dis(gen);
-		}
-		ss << "-";
-		for (int i = 0; i < 4; i++)
-		{
-			ss << std::hex << dis(gen);
-		}
-		ss << "-4"; // 版本4标识
-		for (int i = 0; i < 3; i++)
+		for (int i = 0; i < 36; i++)
 		{
-			ss << std::hex << dis(gen);
+			if (i == 8 || i == 13 || i == 18 || i == 23)
+				out[i] = '-';
+			else if (i == 14)
+				out[i] = '4'; // 版本4标识
+			else if (i == 19)
+				out[i] = hex[dis2(gen)]; // UUID变体标识 (8, 9, a, b)
+			else
+				out[i] = hex[dis(gen)];
 		}
-		ss << "-";
-		ss << std::hex << dis2(gen); // UUID变体标识 (8, 9, a, b)
-		for (int i = 0; i < 3; i++)
+	}
+
+	// 生成UUID字符串的局部函数
+	std::string generateUUID()
+	{
+		char uuid[36];
+		writeUUID(uuid);
+		return std::string(uuid, sizeof(uuid));
+	}
+
+	// 按主机名生成固定的客户端标识，重启后不变，持久会话依赖于此
+	std::string defaultClientId()
+	{
+		char host[256] = {};
+		if (gethostname(host, sizeof(host) - 1) != 0 || host[0] == '\0')
+			return "bluetooth-bridge";
+
+		return std::string("bluetooth-bridge-") + host;
+	}
+
+	// 写入 "%Y-%m-%d %H:%M:%S" 格式的本地时间，返回写入的字节数
+	size_t writeTime(char* out, size_t size, const std::chrono::system_clock::time_point& tp)
+	{
+		std::time_t tt = std::chrono::system_clock::to_time_t(tp);
+		std::tm tm;
+		localtime_r(&tt, &tm);
+
+		return std::strftime(out, size, "%Y-%m-%d %H:%M:%S", &tm);
+	}
+
+	std::string formatTime(const std::chrono::system_clock::time_point& tp)
+	{
+		char buffer[32];
+		return std::string(buffer, writeTime(buffer, sizeof(buffer), tp));
+	}
+
+	// 追加写入，调用方保证容量足够
+	char* append(char* p, const char* data, size_t size)
+	{
+		std::memcpy(p, data, size);
+		return p + size;
+	}
+
+	// 主题分类在配置和发件箱策略中的名称，顺序与 MqttProxy::TopicClass 一致
+	const char* const kTopicClassNames[] = { "telemetry", "events", "status" };
+
+	// 集群主题：owner/<地址> 为设备归属记录，presence/<实例> 为在线状态，node/<实例>/<命令>
+	// 为转发给该实例的命令
+	const std::string kClusterPrefix = "/org/booway/bluetooth/cluster/";
+
+	std::string ownerTopic(const std::string& address) { return kClusterPrefix + "owner/" + address; }
+
+	std::string presenceTopic(const std::string& instance) { return kClusterPrefix + "presence/" + instance; }
+
+	std::string nodeTopic(const std::string& instance, const std::string& command)
+	{
+		return kClusterPrefix + "node/" + instance + "/" + command;
+	}
+
+	std::string presenceBody(const std::string& instance, bool online)
+	{
+		Json::Value root;
+		root["instance"] = instance;
+		root["status"] = online ? "online" : "offline";
+		root["time"] = formatTime(std::chrono::system_clock::now());
+		return root.toStyledString();
+	}
+
+	bool parseBody(const std::vector<uint8_t>& payload, Json::Value& root)
+	{
+		Json::CharReaderBuilder readerBuilder;
+		std::unique_ptr<Json::CharReader> reader(readerBuilder.newCharReader());
+		const char* begin = reinterpret_cast<const char*>(payload.data());
+		JSONCPP_STRING errs;
+
+		return reader->parse(begin, begin + payload.size(), &root, &errs) && root.isObject();
+	}
+
+	// 命令针对的设备：传输命令为 transfer.address，其余为 device.address。只扫描地址，
+	// 不建立 JSON DOM，也不解码 data
+	std::string commandAddress(const std::string& command, const std::vector<uint8_t>& payload)
+	{
+		const char* scope = command.compare(0, 8, "transfer") == 0 ? "transfer" : "device";
+
+		CommandDecoder decoder;
+		CommandDecoder::Command decoded;
+		std::string error;
+
+		if (!decoder.decode(
+				payload.data(), payload.size(), scope, decoded, error, CommandDecoder::kAddress) ||
+			!decoded.has(CommandDecoder::kAddress))
+			return std::string();
+
+		return decoded.address;
+	}
+
+	// FNV-1a，分片结果与进程、编译器无关，重启后同一设备仍落在同一分片
+	size_t shardIndex(const std::string& address, size_t count)
+	{
+		uint32_t hash = 2166136261u;
+		for (char c : address)
 		{
-			ss << std::hex << dis(gen);
+			hash ^= static_cast<uint8_t>(std::tolower(static_cast<unsigned char>(c)));
+			hash *= 16777619u;
 		}
-		ss << "-";
-		for (int i = 0; i < 12; i++)
+
+		return hash % count;
+	}
+
+	// 代理地址列表，每项为 "host:port" 或 {"host": ..., "port": ...}，未写端口时为 defaultPort
+	std::vector<MqttClientImpl::Endpoint> parseEndpoints(const Json::Value& node, int defaultPort)
+	{
+		std::vector<MqttClientImpl::Endpoint> endpoints;
+
+		if (!node.isArray())
+			return endpoints;
+
+		for (const auto& item : node)
 		{
-			ss << std::hex << dis(gen);
+			MqttClientImpl::Endpoint endpoint;
+			endpoint.port = defaultPort;
+
+			if (item.isObject())
+			{
+				endpoint.host = item["host"].asString();
+				endpoint.port = item.get("port", defaultPort).asInt();
+			}
+			else if (item.isString())
+			{
+				std::string value = item.asString();
+				size_t colon = value.rfind(':');
+
+				endpoint.host = value.substr(0, colon);
+				if (colon != std::string::npos)
+					endpoint.port = std::atoi(value.c_str() + colon + 1);
+			}
+
+			if (endpoint.host.empty() || endpoint.port <= 0)
+			{
+				LOG_WARN("忽略无效的MQTT代理地址 - {}", item.toStyledString());
+				continue;
+			}
+
+			endpoints.push_back(endpoint);
 		}
 
-		return ss.str();
+		return endpoints;
 	}
 
-	std::string formatTime(const std::chrono::system_clock::time_point& tp)
+	// 读取聚合配置，未配置的项沿用 base
+	UplinkEncoder::BatchOptions parseBatch(const Json::Value& node, UplinkEncoder::BatchOptions base)
 	{
-		// 转换为 time_t
-		std::time_t tt = std::chrono::system_clock::to_time_t(tp);
+		if (!node.isObject())
+			return base;
 
-		// 转换为本地时间结构
-		std::tm* tm = std::localtime(&tt);
+		if (node.isMember("max_delay_ms"))
+			base.maxDelay = std::chrono::milliseconds(std::max(0, node["max_delay_ms"].asInt()));
 
-		// 格式化为字符串
-		std::stringstream ss;
-		ss << std::put_time(tm, "%Y-%m-%d %H:%M:%S");
+		if (node.isMember("max_bytes"))
+			base.maxBytes = static_cast<size_t>(std::max(1, node["max_bytes"].asInt()));
 
-		return ss.str();
+		if (node.isMember("mode"))
+			base.concat = node["mode"].asString() == "concat";
+
+		return base;
 	}
 }
 
@@ -71,50 +211,353 @@ MqttProxy::MqttProxy(BluetoothManager& btManager, BluetoothServer& btServer, Jso
 {
 }
 
-MqttProxy::~MqttProxy() {}
+MqttProxy::~MqttProxy()
+{
+	// 先停止分片发送线程，它会查找会话
+	_transfers.reset();
+
+	// 发件箱的发送线程使用 _mqtt 重新发布
+	if (_outbox)
+		_outbox->stop();
+
+	// 主动连接的客户端析构时会回调 onServerDisconnected，须在其他成员析构前完成
+	_sessions.clear();
+
+	// 正常断开时代理不发布遗嘱，主动声明离线，其他实例不再转发命令到本实例
+	if (_cluster && _mqtt)
+	{
+		std::string body = presenceBody(_cluster->self(), false);
+		_mqtt->publishAsync(
+			presenceTopic(_cluster->self()), std::vector<uint8_t>(body.begin(), body.end()), 1, true);
+		_mqtt->flush();
+	}
+}
+
+MqttProxy::TopicClass MqttProxy::topicClass(std::string_view topic)
+{
+	// 未列出的主题(状态、统计等周期消息)为 status
+	static constexpr std::pair<std::string_view, TopicClass> kClasses[] = {
+		{ "receiveFromDevice", kTelemetry }, { "replayedFromDevice", kTelemetry },
+		{ "newConnection", kEvents },		 { "loseConnection", kEvents },
+		{ "getLastError", kEvents },		 { "transferProgress", kEvents },
+	};
+
+	std::string_view name = topic.substr(topic.rfind('/') + 1);
+
+	for (const auto& [suffix, value] : kClasses)
+	{
+		if (name == suffix)
+			return value;
+	}
+
+	return kStatus;
+}
 
 bool MqttProxy::createAndConnect()
 {
 	// MQTT配置参数
-	std::string cliendId = generateUUID();
+	std::string cliendId = _config.getString("mqtt.client_id", "");
 	std::string username = _config.getString("mqtt.username", "admin");
 	std::string password = _config.getString("mqtt.password", "123456");
 	std::string server = _config.getString("mqtt.host", "127.0.0.1");
 	int32_t port = _config.getInt("mqtt.port", 1883);
+	int32_t keepalive = _config.getInt("mqtt.keepalive", 60);
+	bool cleanSession = _config.getBool("mqtt.clean_session", true);
+
+	if (cliendId.empty())
+		cliendId = defaultClientId();
 
 	// 创建MQTT客户端
-	_mqtt = std::make_unique<MqttClientImpl>(cliendId, username, password, true);
+	_mqtt = std::make_unique<MqttClientImpl>(cliendId, username, password, cleanSession);
+
+	// 断线重连的退避间隔
+	MqttClientImpl::ReconnectOptions reconnect;
+	reconnect.minDelay = std::chrono::milliseconds(
+		std::max(1, _config.getInt("mqtt.reconnect.min_delay_ms", 500)));
+	reconnect.maxDelay = std::chrono::milliseconds(
+		std::max(1, _config.getInt("mqtt.reconnect.max_delay_ms", 30000)));
+	reconnect.connectTimeout = std::chrono::milliseconds(
+		std::max(100, _config.getInt("mqtt.reconnect.connect_timeout_ms", 5000)));
+	_mqtt->setReconnect(reconnect);
+
+	// 主备代理：按顺序排列的地址，未配置时只使用 mqtt.host/mqtt.port
+	std::vector<MqttClientImpl::Endpoint> endpoints =
+		parseEndpoints(_config.getRoot()["mqtt"]["endpoints"], port);
+	if (endpoints.empty())
+		endpoints.push_back({ server, port });
+
+	MqttClientImpl::FailoverOptions failover;
+	failover.warmStandby = _config.getBool("mqtt.failover.warm_standby", true);
+	failover.probeInterval = std::chrono::milliseconds(
+		std::max(100, _config.getInt("mqtt.failover.probe_interval_ms", 5000)));
+	_mqtt->setFailover(failover);
+
+	// MQTT v5：主题别名、消息过期和精简的上行封装
+	MqttClientImpl::V5Options v5;
+	std::string protocol = _config.getString("mqtt.protocol", "3.1.1");
+	v5.enabled = protocol == "5";
+
+	if (!v5.enabled && protocol != "3.1.1")
+		LOG_WARN("未知的 MQTT 协议版本 - {}，使用 3.1.1", protocol);
+
+	v5.topicAliasMaximum = static_cast<uint16_t>(
+		std::min(65535, std::max(0, _config.getInt("mqtt.v5.topic_alias_maximum", 32))));
+	// 持久会话须设置会话保留时间，否则代理在断开时即丢弃会话
+	v5.sessionExpiry = static_cast<uint32_t>(std::max(
+		0, _config.getInt("mqtt.v5.session_expiry_sec", cleanSession ? 0 : 24 * 3600)));
+
+	_mqtt->setV5(v5);
+
+	_rawUplink = v5.enabled && _config.getBool("mqtt.v5.raw_uplink", false);
+	if (!v5.enabled && _config.getBool("mqtt.v5.raw_uplink", false))
+		LOG_WARN("mqtt.v5.raw_uplink 需要 MQTT v5，已忽略");
+
+	// 网络 I/O 方式
+	std::string ioModeName = _config.getString("mqtt.io_mode", "loop");
+	MqttClientImpl::IoMode ioMode =
+		ioModeName == "epoll" ? MqttClientImpl::IoMode::Epoll : MqttClientImpl::IoMode::Loop;
+
+	if (ioModeName != "epoll" && ioModeName != "loop")
+		LOG_WARN("未知的 MQTT 网络 I/O 方式 - {}，使用 loop", ioModeName);
+
+	_mqtt->setIoMode(ioMode);
+
+	// QoS 1/2 未确认消息窗口
+	unsigned int maxInflight =
+		static_cast<unsigned int>(std::max(0, _config.getInt("mqtt.publish.max_inflight", 20)));
+	_mqtt->setMaxInflight(maxInflight);
+
+	// 与代理断开期间的消息存入磁盘发件箱
+	std::string outboxPath = _config.getString("mqtt.outbox.path", "");
+	if (!outboxPath.empty())
+	{
+		MqttOutbox::Options outboxOptions;
+		outboxOptions.path = outboxPath;
+		outboxOptions.fileSize = static_cast<size_t>(
+			std::max(4096, _config.getInt("mqtt.outbox.file_size", 16 * 1024 * 1024)));
+		outboxOptions.drainRate =
+			static_cast<size_t>(std::max(1, _config.getInt("mqtt.outbox.drain_rate", 200)));
+
+		// 默认断开期间的周期状态不保存，遥测写满时丢弃最早的，事件写满时丢弃新的
+		outboxOptions.policies = { { "telemetry", MqttOutbox::Policy::DropOldest },
+								   { "events", MqttOutbox::Policy::DropNewest },
+								   { "status", MqttOutbox::Policy::Discard } };
+
+		const Json::Value& policies = _config.getRoot()["mqtt"]["outbox"]["policies"];
+		if (policies.isObject())
+		{
+			for (const auto& name : policies.getMemberNames())
+			{
+				MqttOutbox::Policy policy;
+				if (MqttOutbox::parsePolicy(policies[name].asString(), policy))
+					outboxOptions.policies[name] = policy;
+				else
+					LOG_WARN("未知的发件箱策略 - {}: {}", name, policies[name].asString());
+			}
+		}
+
+		_outbox = std::make_unique<MqttOutbox>(outboxOptions, [](const std::string& topic) {
+			return std::string(kTopicClassNames[topicClass(topic)]);
+		});
+		_mqtt->setOutbox(_outbox.get());
+	}
+
+	// 集群模式：多个实例以共享订阅分担命令，异常断开时由代理发布离线遗嘱
+	if (_config.getBool("mqtt.cluster.enabled", false))
+	{
+		std::string instance = _config.getString("mqtt.cluster.instance_id", "");
+		if (instance.empty())
+			instance = cliendId;
+
+		_clusterGroup = _config.getString("mqtt.cluster.group", "bluetooth-bridge");
+		_cluster = std::make_unique<ClusterDirectory>(instance);
+		_mqtt->setWill(presenceTopic(instance), presenceBody(instance, false), 1, true);
+
+		LOG_INFO("MQTT集群模式 - 实例 {}，共享组 {}", instance, _clusterGroup);
+	}
 
 	// 设置连接回调
-	_mqtt->setConnectCallback([](int rc) {
+	_mqtt->setConnectCallback([this](int rc) {
 		LOG_INFO("MQTT连接回调 - 返回码 - {}", rc);
 
+		_flow.setConnected(rc == 0);
+
 		if (rc == 0)
 			LOG_INFO("MQTT连接成功!");
 		else
 			LOG_ERROR("MQTT连接失败，错误码 - {}", rc);
+
+		// 每次连接后重新声明在线，覆盖上一次断开时的遗嘱
+		if (rc == 0 && _cluster)
+		{
+			std::string body = presenceBody(_cluster->self(), true);
+			_mqtt->publishAsync(presenceTopic(_cluster->self()),
+								std::vector<uint8_t>(body.begin(), body.end()),
+								1,
+								true);
+		}
 	});
 
 	// 设置断开连接回调
-	_mqtt->setDisconnectCallback([]() { LOG_WARN("MQTT已断开连接"); });
+	_mqtt->setDisconnectCallback([this]() {
+		LOG_WARN("MQTT已断开连接");
+		_flow.setConnected(false);
+	});
 
-	// 连接到MQTT代理
-	if (!_mqtt->connect(server, port, 60))
+	// 连接到MQTT代理，代理暂不可达时在后台重试
+	LOG_INFO("MQTT客户端标识 - {}，{}", cliendId, cleanSession ? "干净会话" : "持久会话");
+
+	if (endpoints.size() > 1)
+	{
+		LOG_INFO("MQTT代理地址 {} 个，{}",
+				 endpoints.size(),
+				 failover.warmStandby ? "保持热备连接" : "断开后依次重连");
+	}
+
+	if (!_mqtt->connect(endpoints, keepalive))
 	{
 		LOG_ERROR("无法连接到MQTT代理");
 		return false;
 	}
 
+	// 发布分片：设备上行按地址分散到多条连接，单条连接的发送缓冲和网络线程不再是瓶颈
+	int shards = std::max(0, _config.getInt("mqtt.publish.shards", 0));
+	for (int i = 0; i < shards; ++i)
+	{
+		std::string shardId = cliendId + "-pub" + std::to_string(i);
+		auto shard = std::make_unique<MqttClientImpl>(shardId, username, password, cleanSession);
+
+		shard->setReconnect(reconnect);
+		shard->setFailover(failover);
+		shard->setIoMode(ioMode);
+		shard->setV5(v5);
+		shard->setMaxInflight(maxInflight);
+
+		// 共用控制连接的发件箱，积压由控制连接重新发布
+		if (_outbox)
+			shard->setOutbox(_outbox.get(), false);
+
+		shard->setDisconnectCallback([shardId]() { LOG_WARN("MQTT发布分片已断开连接 - {}", shardId); });
+
+		if (!shard->connect(endpoints, keepalive))
+		{
+			LOG_ERROR("无法连接MQTT发布分片 - {}", shardId);
+			return false;
+		}
+
+		_shards.push_back(std::move(shard));
+	}
+
+	if (!_shards.empty())
+		LOG_INFO("MQTT发布分片 {} 个", _shards.size());
+
 	return true;
 }
 
 
 bool MqttProxy::setup()
 {
+	// 上行信用流控，须在连接回调触发前配置
+	FlowControl::Options flowOptions;
+	flowOptions.highWatermark = _config.getInt("mqtt.flow.high_watermark", 256);
+	flowOptions.lowWatermark = _config.getInt("mqtt.flow.low_watermark", 64);
+	flowOptions.pauseWhenDisconnected = _config.getBool("mqtt.flow.pause_when_disconnected", true);
+	_flow.setOptions(flowOptions);
+
+	// 上行序号与重放缓存
+	UplinkReplay::Options replayOptions;
+	replayOptions.maxMessages =
+		static_cast<size_t>(std::max(0, _config.getInt("mqtt.replay.max_messages", 256)));
+	replayOptions.maxBytes =
+		static_cast<size_t>(std::max(0, _config.getInt("mqtt.replay.max_bytes", 256 * 1024)));
+	_replay.setOptions(replayOptions);
+
+	// 按主题分类的发布 QoS：设备事件默认 QoS 1，遥测和周期状态默认 QoS 0
+	for (size_t i = 0; i < kTopicClassCount; ++i)
+	{
+		const char* name = kTopicClassNames[i];
+		int qos = _config.getInt(std::string("mqtt.publish.qos.") + name, i == kEvents ? 1 : 0);
+		_qos[i] = std::min(std::max(qos, 0), 2);
+
+		// v5 消息过期时间，代理上积压超过该时间的消息不再投递，0 表示不过期
+		int expiry = _config.getInt(std::string("mqtt.v5.message_expiry_sec.") + name, 0);
+		_expiry[i] = static_cast<uint32_t>(std::max(0, expiry));
+	}
+
+	// 设备离线期间的下行暂存，可选持久化
+	if (_config.getBool("mqtt.offline_queue.enabled", false))
+	{
+		OfflineQueue::Options queueOptions;
+		queueOptions.maxMessages =
+			static_cast<size_t>(std::max(1, _config.getInt("mqtt.offline_queue.max_messages", 256)));
+		queueOptions.maxBytes =
+			static_cast<size_t>(std::max(1, _config.getInt("mqtt.offline_queue.max_bytes", 65536)));
+		queueOptions.ttl = std::chrono::seconds(std::max(1, _config.getInt("mqtt.offline_queue.ttl_sec", 60)));
+		queueOptions.path = _config.getString("mqtt.offline_queue.path", "");
+		queueOptions.fileSize = static_cast<size_t>(
+			std::max(4096, _config.getInt("mqtt.offline_queue.file_size", 4 * 1024 * 1024)));
+
+		_offlineQueue = std::make_unique<OfflineQueue>(queueOptions);
+	}
+
 	if (!createAndConnect())
 		return false;
 
 	// ==== 初始化MQTT订阅和发布 =====
+	// 上行编码线程池，读线程只负责入队
+	UplinkEncoder::Options encoderOptions;
+	encoderOptions.workers = static_cast<size_t>(std::max(1, _config.getInt("mqtt.encoder.workers", 2)));
+	encoderOptions.ringCapacity =
+		static_cast<size_t>(std::max(2, _config.getInt("mqtt.encoder.ring_capacity", 1024)));
+
+	// 按设备聚合上行帧，默认逐帧发布
+	const Json::Value& batch = _config.getRoot()["mqtt"]["batch"];
+	_batchDefault = parseBatch(batch, UplinkEncoder::BatchOptions());
+
+	const Json::Value& batchDevices = batch["devices"];
+	if (batchDevices.isObject())
+	{
+		for (const auto& address : batchDevices.getMemberNames())
+			_batchDevices[toLower(address)] = parseBatch(batchDevices[address], _batchDefault);
+	}
+
+	_encoder = std::make_unique<UplinkEncoder>(
+		encoderOptions,
+		[this](const std::string& address,
+			   const std::vector<UplinkEncoder::Frame>& frames,
+			   const UplinkEncoder::BatchOptions& options) {
+			size_t count = frames.size();
+
+			if (count == 1)
+				LOG_INFO("已接收: {}({} bytes)", address, frames.front().data.size());
+			else
+				LOG_INFO("已接收: {}({} 帧聚合发布)", address, count);
+
+			// 编码线程按设备固定，序号与发布顺序一致
+			static const std::string kTopic = "/org/booway/bluetooth/receiveFromDevice";
+			UplinkReplay::Stamp stamp = _replay.next(address);
+			PublishProperties properties = propertiesFor(kTopic);
+			Buffer body = _rawUplink ? encodeRaw(address, stamp, frames, options.concat, properties)
+									 : encodeFrames(address, stamp, frames, options.concat);
+			_replay.store(address, stamp, body, properties);
+
+			publishDevice(
+				address,
+				kTopic,
+				std::move(body),
+				[this, address, count](bool) { _flow.release(address, count); },
+				std::move(properties));
+		},
+		std::bind(&MqttProxy::batchOptions, this, std::placeholders::_1));
+
+	// 未确认的上行帧超过高水位或代理断开时，读线程暂停 recv
+	_server.setReadGate(std::bind(&MqttProxy::waitReadable, this, std::placeholders::_1));
+
+	// 按设备/服务UUID分帧，每条 receiveFromDevice 对应一个完整帧
+	_framing.load(_config.getRoot()["bluetooth"]["framing"]);
+	_server.setDecoderFactory(std::bind(&MqttProxy::createDecoder, this, std::placeholders::_1));
+
+	// 编码器与分帧就绪后再安装连接与数据回调，回调可能在安装后立即由读线程触发
 	_server.setClientConnectCallback(std::bind(&MqttProxy::onClientConnected,
 											   this,
 											   std::placeholders::_1,
@@ -128,33 +571,48 @@ bool MqttProxy::setup()
 	_server.setDataReceivedCallback(std::bind(&MqttProxy::onReceiveClientData,
 											  this,
 											  std::placeholders::_1,
-											  std::placeholders::_2,
-											  std::placeholders::_3));
+											  std::placeholders::_2));
+
 
+	// 集群中各实例的设备归属与在线状态
+	if (_cluster)
+	{
+		// 清除的记录以空消息送达
+		MqttClientImpl::DispatchOptions records;
+		records.emptyPayload = true;
+
+		_mqtt->subscribeAsync(kClusterPrefix + "owner/+", 1);
+		_mqtt->setMessageCallback(
+			kClusterPrefix + "owner/",
+			std::bind(&MqttProxy::onOwnerRecord, this, std::placeholders::_1, std::placeholders::_2),
+			records);
+
+		_mqtt->subscribeAsync(kClusterPrefix + "presence/+", 1);
+		_mqtt->setMessageCallback(
+			kClusterPrefix + "presence/",
+			std::bind(&MqttProxy::onPresence, this, std::placeholders::_1, std::placeholders::_2),
+			records);
+	}
 
 	// 连接到设备(客户端连接)
-	std::string topic = "/org/booway/bluetooth/connectDevice";
-	_mqtt->subscribeAsync(topic, 0);
-	_mqtt->setMessageCallback(
-		topic,
-		std::bind(&MqttProxy::connectTo, this, std::placeholders::_1, std::placeholders::_2));
+	subscribeCommand("connectDevice",
+					 std::bind(&MqttProxy::connectTo, this, std::placeholders::_1, std::placeholders::_2));
 
 	// 与设备断开连接(客户端、服务端)
-	topic = "/org/booway/bluetooth/disconnectDevice";
-	_mqtt->subscribeAsync(topic, 0);
-	_mqtt->setMessageCallback(
-		topic,
-		std::bind(&MqttProxy::disconnectTo, this, std::placeholders::_1, std::placeholders::_2));
+	subscribeCommand("disconnectDevice",
+					 std::bind(&MqttProxy::disconnectTo, this, std::placeholders::_1, std::placeholders::_2));
 
 	// 处理MQTT发送数据到设备
-	topic = "/org/booway/bluetooth/sendToDevice";
-	_mqtt->subscribeAsync(topic, 0);
-	_mqtt->setMessageCallback(
-		topic,
-		std::bind(&MqttProxy::sendTo, this, std::placeholders::_1, std::placeholders::_2));
-
-	// 移除已配对设备
-	topic = "/org/booway/bluetooth/removeDevices";
+	// 开启合并写入时下行数据只入队到设备连接，epoll 模式下可直接在网络线程处理；否则 send
+	// 和离线补发会阻塞写套接字，仍经任务队列处理
+	MqttClientImpl::DispatchOptions downlink;
+	downlink.inlineDispatch = _config.getBool("bluetooth.downlink.coalesce", false);
+	subscribeCommand("sendToDevice",
+					 std::bind(&MqttProxy::sendTo, this, std::placeholders::_1, std::placeholders::_2),
+					 downlink);
+
+	// 移除已配对设备，以下命令不针对单个设备，集群中每个实例都处理
+	std::string topic = "/org/booway/bluetooth/removeDevices";
 	_mqtt->subscribeAsync(topic, 0);
 	_mqtt->setMessageCallback(
 		topic,
@@ -169,87 +627,328 @@ bool MqttProxy::setup()
 										std::placeholders::_1,
 										std::placeholders::_2));
 
+	// 按需扫描设备
+	topic = "/org/booway/bluetooth/startDiscovery";
+	_mqtt->subscribeAsync(topic, 0);
+	_mqtt->setMessageCallback(
+		topic,
+		std::bind(&MqttProxy::startDiscovery, this, std::placeholders::_1, std::placeholders::_2));
+
+	// 按序号范围重放上行消息
+	subscribeCommand("replayFromDevice",
+					 std::bind(&MqttProxy::replayFrom, this, std::placeholders::_1, std::placeholders::_2));
+
+	// 大块数据分片下发
+	TransferManager::Options transferOptions;
+	transferOptions.windowBytes =
+		static_cast<size_t>(std::max(1024, _config.getInt("mqtt.transfer.window_bytes", 256 * 1024)));
+	transferOptions.writeBytes =
+		static_cast<size_t>(std::max(1, _config.getInt("mqtt.transfer.write_bytes", 4096)));
+	transferOptions.maxTransfers =
+		static_cast<size_t>(std::max(1, _config.getInt("mqtt.transfer.max_transfers", 8)));
+	transferOptions.progressInterval =
+		std::chrono::milliseconds(std::max(100, _config.getInt("mqtt.transfer.progress_interval_ms", 1000)));
+	transferOptions.idleTimeout =
+		std::chrono::seconds(std::max(1, _config.getInt("mqtt.transfer.idle_timeout_sec", 120)));
+	transferOptions.ackRequired = _config.getBool("mqtt.transfer.ack_required", false);
+
+	_transfers = std::make_unique<TransferManager>(
+		transferOptions,
+		[this](const std::string& address) { return _sessions.find(address); },
+		[this](const Json::Value& progress) {
+			Json::Value root;
+			Json::Value transfer = progress;
+			transfer["publishId"] = generateUUID();
+			transfer["publishTime"] = formatTime(std::chrono::system_clock::now());
+			root["transfer"] = transfer;
+
+			std::string body = root.toStyledString();
+			std::vector<uint8_t> payload(body.begin(), body.end());
+			publishDevice(progress["address"].asString(),
+						  "/org/booway/bluetooth/transferProgress",
+						  payload);
+		});
+
+	// 集群模式下分片、确认、提交和取消也须带 address，才能转发到开始传输的实例。
+	// 传输命令按到达顺序依次处理，分片和提交不会被并行的任务线程打乱
+	MqttClientImpl::DispatchOptions transferDispatch;
+	transferDispatch.ordered = true;
+
+	for (const char* name :
+		 { "transferBegin", "transferChunk", "transferAck", "transferCommit", "transferAbort" })
+	{
+		subscribeCommand(name,
+						 std::bind(&MqttProxy::transfer, this, std::placeholders::_1, std::placeholders::_2),
+						 transferDispatch);
+	}
+
 
 	return true;
 }
 
+void MqttProxy::subscribeCommand(const std::string& command,
+								 MqttClientImpl::MessageCallback handler,
+								 const MqttClientImpl::DispatchOptions& dispatch)
+{
+	std::string topic = "/org/booway/bluetooth/" + command;
+
+	if (!_cluster)
+	{
+		_mqtt->subscribeAsync(topic, 0);
+		_mqtt->setMessageCallback(topic, std::move(handler), dispatch);
+		return;
+	}
+
+	// 其他实例转发来的命令已确定由本实例处理
+	std::string forwarded = nodeTopic(_cluster->self(), command);
+	_mqtt->subscribeAsync(forwarded, 1);
+	_mqtt->setMessageCallback(forwarded, handler, dispatch);
+
+	// 共享订阅的消息仍以原主题送达，回调按原主题登记
+	_mqtt->subscribeAsync("$share/" + _clusterGroup + "/" + topic, 0);
+	_mqtt->setMessageCallback(
+		topic,
+		[this, command, handler](const std::string& received, const std::vector<uint8_t>& payload) {
+			routeCommand(command, handler, received, payload);
+		},
+		dispatch);
+}
+
+void MqttProxy::routeCommand(const std::string& command,
+							 const MqttClientImpl::MessageCallback& handler,
+							 const std::string& topic,
+							 const std::vector<uint8_t>& payload)
+{
+	// 没有其他在线实例时不必解析消息
+	std::string owner;
+	if (_cluster->hasPeers())
+	{
+		std::string address = commandAddress(command, payload);
+		if (!address.empty())
+			owner = _cluster->remoteOwner(address);
+	}
+
+	if (owner.empty())
+	{
+		_cluster->countLocal();
+		handler(topic, payload);
+		return;
+	}
+
+	LOG_DEBUG("命令 {} 转发到设备所在实例 {}", command, owner);
+
+	_cluster->countForwarded();
+	_mqtt->publishAsync(nodeTopic(owner, command), payload, 1, false);
+}
+
+void MqttProxy::onOwnerRecord(const std::string& topic, const std::vector<uint8_t>& payload)
+{
+	std::string address = topic.substr(topic.rfind('/') + 1);
+
+	// 空消息表示记录已清除
+	Json::Value root;
+	if (payload.empty() || !parseBody(payload, root))
+	{
+		_cluster->setOwner(address, "");
+		return;
+	}
+
+	std::string owner = root["owner"].asString();
+
+	// 本实例上一次运行留下的记录，设备已不在本实例上
+	if (owner == _cluster->self() && !_sessions.find(address))
+	{
+		_cluster->setOwner(address, owner);
+		releaseDevice(address);
+		return;
+	}
+
+	_cluster->setOwner(address, owner);
+}
+
+void MqttProxy::onPresence(const std::string& topic, const std::vector<uint8_t>& payload)
+{
+	std::string instance = topic.substr(topic.rfind('/') + 1);
+
+	Json::Value root;
+	bool online = !payload.empty() && parseBody(payload, root) && root["status"].asString() == "online";
+
+	_cluster->setPresence(instance, online);
+	LOG_INFO("集群实例 {} {}", instance, online ? "在线" : "离线");
+}
+
+void MqttProxy::claimDevice(const std::string& address)
+{
+	if (!_cluster || !_mqtt)
+		return;
+
+	Json::Value root;
+	root["owner"] = _cluster->self();
+	root["time"] = formatTime(std::chrono::system_clock::now());
+
+	// 先更新本地记录，保留消息回显之前的命令也在本实例处理
+	_cluster->setOwner(address, _cluster->self());
+
+	std::string body = root.toStyledString();
+	_mqtt->publishAsync(ownerTopic(address), std::vector<uint8_t>(body.begin(), body.end()), 1, true);
+}
+
+void MqttProxy::releaseDevice(const std::string& address)
+{
+	// 设备已由其他实例接管时保留其记录
+	if (!_cluster || !_mqtt || !_cluster->ownedBySelf(address))
+		return;
+
+	_cluster->setOwner(address, "");
+	_mqtt->publishAsync(ownerTopic(address), std::vector<uint8_t>(), 1, true);
+}
+
 void MqttProxy::publish(const std::string& topic, const std::vector<uint8_t>& payload)
 {
 	if (_mqtt)
-		_mqtt->publishAsync(topic, payload, 0, false);
+		_mqtt->publishAsync(topic, payload, qosFor(topic), false, propertiesFor(topic));
 }
 
-void MqttProxy::connectTo(const std::string& topic, const std::vector<uint8_t>& payload)
+void MqttProxy::publish(const std::string& topic,
+						Buffer payload,
+						MqttClientImpl::PublishCallback done)
 {
-	std::string jsonBody(payload.begin(), payload.end());
+	if (_mqtt)
+		_mqtt->publishAsync(
+			topic, std::move(payload), qosFor(topic), false, std::move(done), propertiesFor(topic));
+	else if (done)
+		done(false);
+}
 
-	// 解析message 为json
-	Json::CharReaderBuilder readerBuilder;
-	Json::Value root;
+void MqttProxy::publishDevice(const std::string& address,
+							  const std::string& topic,
+							  const std::vector<uint8_t>& payload)
+{
+	if (MqttClientImpl* client = clientFor(address))
+		client->publishAsync(topic, payload, qosFor(topic), false, propertiesFor(topic));
+}
+
+void MqttProxy::publishDevice(const std::string& address,
+							  const std::string& topic,
+							  Buffer payload,
+							  MqttClientImpl::PublishCallback done,
+							  PublishProperties properties)
+{
+	if (properties.empty())
+		properties = propertiesFor(topic);
+
+	if (MqttClientImpl* client = clientFor(address))
+		client->publishAsync(
+			topic, std::move(payload), qosFor(topic), false, std::move(done), std::move(properties));
+	else if (done)
+		done(false);
+}
+
+MqttClientImpl* MqttProxy::clientFor(const std::string& address) const
+{
+	if (_shards.empty())
+		return _mqtt.get();
+
+	return _shards[shardIndex(address, _shards.size())].get();
+}
+
+PublishProperties MqttProxy::propertiesFor(const std::string& topic) const
+{
+	PublishProperties properties;
+
+	properties.messageExpiry = _expiry[topicClass(topic)];
+	return properties;
+}
+
+int MqttProxy::qosFor(const std::string& topic) const
+{
+	return _qos[topicClass(topic)];
+}
+
+UplinkEncoder::BatchOptions MqttProxy::batchOptions(const std::string& address) const
+{
+	auto it = _batchDevices.find(toLower(address));
+	return it != _batchDevices.end() ? it->second : _batchDefault;
+}
+
+bool MqttProxy::waitReadable(const std::string& address)
+{
+	return _flow.waitReadable(address, std::chrono::milliseconds(100));
+}
+
+void MqttProxy::connectTo(const std::string& topic, const std::vector<uint8_t>& payload)
+{
+	// 直接从消息字节中取出命令字段
+	CommandDecoder decoder;
+	CommandDecoder::Command device;
 	JSONCPP_STRING errs;
-	std::istringstream iss(jsonBody);
 
-	if (!Json::parseFromStream(readerBuilder, iss, &root, &errs))
+	if (!decoder.decode(payload.data(), payload.size(), "device", device, errs))
 	{
 		LOG_ERROR("解析JSON消息失败 - {}", errs);
 		return;
 	}
 
-	std::string publishId = "";
-	std::string publishTime = "";
 	int clientConnTimeout = _config.getInt("bluetooth.client.socket_accpet_timeout_ms", 1000);
 	int clientRecvTimeout = _config.getInt("bluetooth.client.socket_recv_timeout_ms", 1000);
 	int clientBufferSize = _config.getInt("bluetooth.client.socket_buffer_size", 1024);
 
-	auto parseJson = [&](const Json::Value& root, JSONCPP_STRING& lastError) -> bool {
-		if (!root.isMember("device"))
+	auto parseJson = [&](const CommandDecoder::Command& device, JSONCPP_STRING& lastError) -> bool {
+		if (!device.scoped)
 		{
 			lastError = "JSON解析错误：缺少 'device' 字段";
 			return false;
 		}
 
-		Json::Value device = root["device"];
-
-		if (device.isMember("publishId"))
-			publishId = device["publishId"].asString();
-
-		if (device.isMember("publishTime"))
-			publishTime = device["publishTime"].asString();
+		if (!device.error.empty())
+		{
+			lastError = device.error;
+			return false;
+		}
 
-		if (!device.isMember("pincode"))
+		if (!device.has(CommandDecoder::kPincode))
 		{
 			lastError = "JSON解析错误: 缺少 'pincode' 字段";
 			return false;
 		}
 
-		if (!device.isMember("address"))
+		if (!device.has(CommandDecoder::kAddress))
 		{
 			lastError = "JSON解析错误: 缺少 'address' 字段";
 			return false;
 		}
 
-		std::string address = device["address"].asString();
-		std::string pincode = device["pincode"].asString();
+		const std::string& address = device.address;
+		const std::string& pincode = device.pincode;
+
+		// 配对、连接期间暂停设备发现
+		DiscoveryScheduler::ConnectGuard guard(_manager.getDiscoveryScheduler());
 
-		if (!_manager.requestConnectWithPincode(address, pincode, lastError))
+		// 回环等传输无需经过 BlueZ 配对、连接
+		if (_server.getTransport()->requiresPairing() &&
+			!_manager.requestConnectWithPincode(address, pincode, lastError))
 			return false;
 
-		std::unique_lock<std::mutex> lock(_clientsMutex);
-		auto it = _clients.find(address);
-		if (it != _clients.end())
+		// 两个方向的连接共用会话表，同一设备只保留一条连接
+		if (std::shared_ptr<Session> session = _sessions.find(address))
 		{
-			// 已存在客户端，尝试重新连接
-			auto& client = it->second;
-			if (!client->connect(address, 0))
+			if (session->isOpen())
 			{
-				lastError = "设备RFCOMM串口连接失败: " + address;
+				lastError = "设备已连接: " + address;
 				return false;
 			}
 		}
-		else
+
 		{
 			// 创建客户端
-			auto client = std::make_unique<BluetoothClient>(address);
+			auto client = std::make_shared<BluetoothClient>(address);
+			client->setTransport(_server.getTransport());
+			client->setBufferPool(_server.getBufferPool());
+			client->setDownlink(_server.getDownlinkOptions(), _server.getDownlinkStats());
+			client->setReadGate(
+				std::bind(&MqttProxy::waitReadable, this, std::placeholders::_1));
+			client->setDecoderFactory(
+				std::bind(&MqttProxy::createDecoder, this, std::placeholders::_1));
 			client->setBufferSize(clientBufferSize);
 			client->setConnectTimeout(clientConnTimeout);
 			client->setRecvTimeout(clientRecvTimeout);
@@ -266,8 +965,7 @@ void MqttProxy::connectTo(const std::string& topic, const std::vector<uint8_t>&
 			client->setDataReceivedCallback(std::bind(&MqttProxy::onReceiveServerData,
 													  this,
 													  std::placeholders::_1,
-													  std::placeholders::_2,
-													  std::placeholders::_3));
+													  std::placeholders::_2));
 
 			if (!client->connect(address, 0))
 			{
@@ -275,17 +973,30 @@ void MqttProxy::connectTo(const std::string& topic, const std::vector<uint8_t>&
 				return false;
 			}
 
-			_clients[address] = std::move(client);
+			std::shared_ptr<Session> session = client->getSession();
+			std::weak_ptr<BluetoothClient> weak = client;
+			session->setCloseHandler([weak]() {
+				if (auto c = weak.lock())
+					c->disconnect();
+			});
+
+			_sessions.add(session, client);
+
+			// 登记前连接已断开
+			if (!session->isOpen())
+				_sessions.removeClosed(address);
+			else
+				onSessionOpened(address);
 		}
 
 		return true;
 	};
 
-	if (!parseJson(root, errs))
+	if (!parseJson(device, errs))
 	{
 		Json::Value root;
-		root["subscribeId"] = publishId;
-		root["subscribeTime"] = publishTime;
+		root["subscribeId"] = device.publishId;
+		root["subscribeTime"] = device.publishTime;
 		root["message"] = errs;
 		std::string body = root.toStyledString();
 		std::vector<uint8_t> payload(body.begin(), body.end());
@@ -296,77 +1007,297 @@ void MqttProxy::connectTo(const std::string& topic, const std::vector<uint8_t>&
 
 void MqttProxy::disconnectTo(const std::string& topic, const std::vector<uint8_t>& payload)
 {
-	std::string jsonBody(payload.begin(), payload.end());
-
-	// 解析message 为json
-	Json::CharReaderBuilder readerBuilder;
-	Json::Value root;
+	// 直接从消息字节中取出命令字段
+	CommandDecoder decoder;
+	CommandDecoder::Command device;
 	JSONCPP_STRING errs;
-	std::istringstream iss(jsonBody);
 
-	if (!Json::parseFromStream(readerBuilder, iss, &root, &errs))
+	if (!decoder.decode(payload.data(), payload.size(), "device", device, errs))
 	{
 		LOG_ERROR("解析JSON消息失败 - {}", errs);
 		return;
 	}
 
-	std::string publishId = "";
-	std::string publishTime = "";
+	auto parseJson = [&](const CommandDecoder::Command& device, JSONCPP_STRING& lastError) -> bool {
+		if (!device.scoped)
+		{
+			lastError = "JSON解析错误：缺少 'device' 字段";
+			return false;
+		}
 
-	auto parseJson = [&](const Json::Value& root, JSONCPP_STRING& lastError) -> bool {
-		if (!root.isMember("device"))
+		if (!device.error.empty())
+		{
+			lastError = device.error;
+			return false;
+		}
+
+		if (!device.has(CommandDecoder::kAddress))
+		{
+			lastError = "JSON解析错误: 缺少 'address' 字段";
+			return false;
+		}
+
+		const std::string& address = device.address;
+
+		// 由会话的所有者(服务端或客户端)完成断开
+		if (std::shared_ptr<Session> session = _sessions.find(address))
+			session->close();
+
+		return true;
+	};
+
+	if (!parseJson(device, errs))
+	{
+		Json::Value root;
+		root["subscribeId"] = device.publishId;
+		root["subscribeTime"] = device.publishTime;
+		root["message"] = errs;
+		std::string body = root.toStyledString();
+		std::vector<uint8_t> payload(body.begin(), body.end());
+
+		publish("/org/booway/bluetooth/getLastError", payload);
+	}
+}
+
+void MqttProxy::sendTo(const std::string& topic, const std::vector<uint8_t>& payload)
+{
+	// 直接从消息字节中取出命令字段
+	CommandDecoder decoder(_server.getBufferPool());
+	CommandDecoder::Command device;
+	JSONCPP_STRING errs;
+
+	if (!decoder.decode(payload.data(), payload.size(), "device", device, errs))
+	{
+		LOG_ERROR("解析JSON消息失败 - {}", errs);
+		return;
+	}
+
+	auto parseJson = [&](CommandDecoder::Command& device, JSONCPP_STRING& lastError) -> bool {
+		if (!device.scoped)
 		{
 			lastError = "JSON解析错误：缺少 'device' 字段";
 			return false;
 		}
 
-		Json::Value device = root["device"];
+		if (!device.error.empty())
+		{
+			lastError = device.error;
+			return false;
+		}
 
-		if (device.isMember("publishId"))
-			publishId = device["publishId"].asString();
+		if (!device.has(CommandDecoder::kAddress))
+		{
+			lastError = "JSON解析错误: 缺少 'address' 字段";
+			return false;
+		}
 
-		if (device.isMember("publishTime"))
-			publishTime = device["publishTime"].asString();
+		if (!device.has(CommandDecoder::kData))
+		{
+			lastError = "JSON解析错误: 缺少 'data' 字段";
+			return false;
+		}
+
+		if (!device.has(CommandDecoder::kSize))
+		{
+			lastError = "JSON解析错误: 缺少 'size' 字段";
+			return false;
+		}
+
+		const std::string& address = device.address;
+
+		if (device.size != device.data.size())
+		{
+			lastError = "JSON解析错误: 数据校验失败";
+			return false;
+		}
+
+		_manager.getDiscoveryScheduler().notifyTraffic();
+
+		// 一次查找，直接写入(或入队到)该设备的连接
+		std::shared_ptr<Session> session = _sessions.find(address);
+
+		// 设备离线或仍有积压时暂存，保证补发顺序
+		if (_offlineQueue)
+		{
+			bool online = session && session->isOpen();
+
+			// 集群中不属于本实例的离线设备可能在其他实例上连入，暂存在本实例会一直滞留
+			if (!online && _cluster && !_cluster->ownedBySelf(address))
+			{
+				lastError = "设备未连接到本实例: " + address;
+				return false;
+			}
+
+			switch (_offlineQueue->admit(address, device.data.data(), device.data.size(), online))
+			{
+			case OfflineQueue::Admit::Full:
+				lastError = "设备离线队列已满: " + address;
+				return false;
+			case OfflineQueue::Admit::Queued:
+				// 入队期间会话可能刚建立，补发一次避免滞留到下次连接
+				flushOffline(address);
+				return true;
+			case OfflineQueue::Admit::Direct:
+				break;
+			}
+		}
+
+		if (!session)
+		{
+			lastError = "设备未连接: " + address;
+			return false;
+		}
+
+		// 解码得到的缓冲区直接交给连接，合并写入时随队列保留到写出；队列已满(超过
+		// max_queued_bytes)或写入失败时返回错误，由上位机按顺序重发
+		if (session->send(std::move(device.data)) < 0)
+		{
+			lastError = session->isOpen() ? "下行队列已满或发送失败: " + address : "设备未连接: " + address;
+			return false;
+		}
+
+		return true;
+	};
+
+	if (!parseJson(device, errs))
+	{
+		Json::Value root;
+		root["subscribeId"] = device.publishId;
+		root["subscribeTime"] = device.publishTime;
+		root["message"] = errs;
+		std::string body = root.toStyledString();
+		std::vector<uint8_t> payload(body.begin(), body.end());
+
+		publish("/org/booway/bluetooth/getLastError", payload);
+	}
+}
+
+void MqttProxy::removeDevices(const std::string& topic, const std::vector<uint8_t>& payload)
+{
+	// 直接从消息字节中取出命令字段
+	CommandDecoder decoder;
+	CommandDecoder::Command command;
+	JSONCPP_STRING errs;
+
+	if (!decoder.decode(payload.data(), payload.size(), nullptr, command, errs))
+	{
+		LOG_ERROR("解析JSON消息失败 - {}", errs);
+		return;
+	}
+
+	auto parseJson = [&](const CommandDecoder::Command& command, JSONCPP_STRING& lastError) -> bool {
+		if (!command.error.empty())
+		{
+			lastError = command.error;
+			return false;
+		}
+
+		std::vector<std::string> addressList;
+
+		if (command.has(CommandDecoder::kAddressList))
+			addressList = command.addressList;
+		else if (command.has(CommandDecoder::kAddress))
+			addressList.push_back(command.address);
+		else
+		{
+			lastError = "JSON解析错误：缺少 'address' 字段";
+			return false;
+		}
+
+		bool hasError = false;
+
+		for (const std::string& deviceAddr : addressList)
+		{
+			std::string removeErr;
+			if (!_manager.requestRemoveDevice(deviceAddr, removeErr))
+			{
+				hasError = true;
+				lastError = removeErr;
+			}
+		}
+
+		return !hasError;
+	};
+
+	if (!parseJson(command, errs))
+	{
+		Json::Value root;
+		root["subscribeId"] = command.publishId;
+		root["subscribeTime"] = command.publishTime;
+		root["message"] = errs;
+		std::string body = root.toStyledString();
+		std::vector<uint8_t> payload(body.begin(), body.end());
+
+		publish("/org/booway/bluetooth/getLastError", payload);
+	}
+}
+
+
+void MqttProxy::connectBenchmarkTest(const std::string& topic, const std::vector<uint8_t>& payload)
+{
+	// 直接从消息字节中取出命令字段
+	CommandDecoder decoder;
+	CommandDecoder::Command command;
+	JSONCPP_STRING errs;
+
+	if (!decoder.decode(payload.data(), payload.size(), nullptr, command, errs))
+	{
+		LOG_ERROR("解析JSON消息失败 - {}", errs);
+		return;
+	}
+
+	const std::string& address = command.address;
+	int64_t times = command.times;
+
+	Json::Value body;
+	Json::Value device;
+	device["address"] = address;
+	device["pincode"] = "0000";
+	device["publishId"] = "019af669-232c-7433-9e1a-50613d2803b4";
+	device["publishTime"] = "2024-06-12 10:20:30";
+	body["device"] = device;
+
+	std::string str = body.toStyledString();
+	std::vector<uint8_t> sendData(str.begin(), str.end());
+
+	bool bSend = true;
 
-		if (!device.isMember("address"))
-		{
-			lastError = "JSON解析错误: 缺少 'address' 字段";
-			return false;
-		}
+	for (int64_t i = 0; i < times * 2; ++i)
+	{
+		if (bSend)
+			publish("/org/booway/bluetooth/connectDevice", sendData);
+		else
+			publish("/org/booway/bluetooth/disconnectDevice", sendData);
 
-		std::string address = device["address"].asString();
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-		{
-			// 设备是服务端，断开作为客户端的连接
-			auto it = _clients.find(address);
-			if (it != _clients.end())
-				it->second->disconnect();
-		}
+		bSend = !bSend;
+	}
+}
 
-		{
-			// 设备是客户端，服务端主动断开连接
-			auto it = _clientIds.find(address);
-			if (it != _clientIds.end())
-				_server.disconnectClient(it->second);
-		}
+void MqttProxy::startDiscovery(const std::string& topic, const std::vector<uint8_t>& payload)
+{
+	std::string jsonBody(payload.begin(), payload.end());
 
-		return true;
-	};
+	// 解析message 为json
+	Json::CharReaderBuilder readerBuilder;
+	Json::Value root;
+	JSONCPP_STRING errs;
+	std::istringstream iss(jsonBody);
 
-	if (!parseJson(root, errs))
+	if (!Json::parseFromStream(readerBuilder, iss, &root, &errs))
 	{
-		Json::Value root;
-		root["subscribeId"] = publishId;
-		root["subscribeTime"] = publishTime;
-		root["message"] = errs;
-		std::string body = root.toStyledString();
-		std::vector<uint8_t> payload(body.begin(), body.end());
-
-		publish("/org/booway/bluetooth/getLastError", payload);
+		LOG_ERROR("解析JSON消息失败 - {}", errs);
+		return;
 	}
+
+	int duration = root.isMember("duration_ms") ? root["duration_ms"].asInt() : 10000;
+
+	LOG_INFO("按需扫描设备 - {}ms", duration);
+	_manager.getDiscoveryScheduler().requestScan(duration);
 }
 
-void MqttProxy::sendTo(const std::string& topic, const std::vector<uint8_t>& payload)
+void MqttProxy::replayFrom(const std::string& topic, const std::vector<uint8_t>& payload)
 {
 	std::string jsonBody(payload.begin(), payload.end());
 
@@ -392,68 +1323,47 @@ void MqttProxy::sendTo(const std::string& topic, const std::vector<uint8_t>& pay
 			return false;
 		}
 
-		auto device = root["device"];
+		const Json::Value& device = root["device"];
 		if (device.isMember("publishId"))
 			publishId = device["publishId"].asString();
 
 		if (device.isMember("publishTime"))
 			publishTime = device["publishTime"].asString();
 
-		if (!device.isMember("address"))
-		{
-			lastError = "JSON解析错误: 缺少 'address' 字段";
-			return false;
-		}
-
-		if (!device.isMember("data"))
-		{
-			lastError = "JSON解析错误: 缺少 'data' 字段";
-			return false;
-		}
-
-		if (!device.isMember("size"))
+		if (!device.isMember("address") || !device.isMember("stream") || !device.isMember("from"))
 		{
-			lastError = "JSON解析错误: 缺少 'size' 字段";
+			lastError = "JSON解析错误: 缺少 'address'、'stream' 或 'from' 字段";
 			return false;
 		}
 
-		std::string str;
 		std::string address = device["address"].asString();
-		std::string strBase64 = device["data"].asString();
-
-		try
-		{
-			str = base64_decode(strBase64);
-		}
-		catch (const std::exception& e)
-		{
-			lastError = "JSON解析错误: 数据Base64解码失败";
-			return false;
-		}
+		uint64_t stream = device["stream"].asUInt64();
+		uint64_t from = device["from"].asUInt64();
+		uint64_t to = device.isMember("to") ? device["to"].asUInt64() : 0;
 
-		std::vector<uint8_t> data(str.begin(), str.end());
+		std::vector<UplinkReplay::Message> messages;
+		uint64_t first = 0;
+		uint64_t last = 0;
+		size_t count = _replay.collect(address, stream, from, to, messages, first, last);
 
-		Json::UInt size = device["size"].asUInt();
-		if (size != str.length())
+		// 精简封装的消息按原属性重放，stream/seq 仍在用户属性中
+		for (auto& message : messages)
 		{
-			lastError = "JSON解析错误: 数据校验失败";
-			return false;
+			publishDevice(address,
+						  "/org/booway/bluetooth/replayedFromDevice",
+						  std::move(message.payload),
+						  nullptr,
+						  std::move(message.properties));
 		}
 
-		{
-			// 设备是服务端，发送数据到连接的客户端
-			std::lock_guard<std::mutex> lock(_clientIdsMutex);
-			auto it = _clientIds.find(address);
-			if (it != _clientIds.end())
-				_server.sendToClient(it->second, data);
-		}
+		LOG_INFO("{} 重放上行消息 {} 条(请求 {}-{}，缓存 {}-{})", address, count, from, to, first, last);
 
+		// 部分或全部已不在缓存中
+		if (count == 0 || from < first)
 		{
-			// 设备是客户端，发送数据到连接的服务端
-			std::lock_guard<std::mutex> lock(_clientsMutex);
-			auto it = _clients.find(address);
-			if (it != _clients.end())
-				it->second->send(std::vector<uint8_t>(str.begin(), str.end()));
+			lastError = "重放范围已不在缓存中: " + address + " " + std::to_string(from) + "-" +
+						std::to_string(to) + "，缓存 " + std::to_string(first) + "-" + std::to_string(last);
+			return false;
 		}
 
 		return true;
@@ -472,7 +1382,7 @@ void MqttProxy::sendTo(const std::string& topic, const std::vector<uint8_t>& pay
 	}
 }
 
-void MqttProxy::removeDevices(const std::string& topic, const std::vector<uint8_t>& payload)
+void MqttProxy::transfer(const std::string& topic, const std::vector<uint8_t>& payload)
 {
 	std::string jsonBody(payload.begin(), payload.end());
 
@@ -492,48 +1402,88 @@ void MqttProxy::removeDevices(const std::string& topic, const std::vector<uint8_
 	std::string publishTime = "";
 
 	auto parseJson = [&](const Json::Value& root, JSONCPP_STRING& lastError) -> bool {
-		if (!root.isMember("address"))
+		if (!root.isMember("transfer"))
 		{
-			lastError = "JSON解析错误：缺少 'address' 字段";
+			lastError = "JSON解析错误：缺少 'transfer' 字段";
 			return false;
 		}
 
-		std::vector<std::string> addressList;
-		auto address = root["address"];
+		const Json::Value& transfer = root["transfer"];
+		if (transfer.isMember("publishId"))
+			publishId = transfer["publishId"].asString();
+
+		if (transfer.isMember("publishTime"))
+			publishTime = transfer["publishTime"].asString();
 
-		if (address.isArray())
+		if (!transfer.isMember("transferId"))
 		{
-			for (const auto& addr : address)
-				addressList.push_back(addr.asString());
+			lastError = "JSON解析错误: 缺少 'transferId' 字段";
+			return false;
 		}
-		else
-			addressList.push_back(address.asString());
 
-		if (root.isMember("publishId"))
-			publishId = root["publishId"].asString();
+		std::string id = transfer["transferId"].asString();
+		std::string action = topic.substr(topic.rfind('/') + 1);
 
-		if (root.isMember("publishTime"))
-			publishTime = root["publishTime"].asString();
-
-		if (!root.isMember("address"))
+		if (action == "transferBegin")
 		{
-			lastError = "JSON解析错误: 缺少 'address' 字段";
-			return false;
+			if (!transfer.isMember("address") || !transfer.isMember("size"))
+			{
+				lastError = "JSON解析错误: 缺少 'address' 或 'size' 字段";
+				return false;
+			}
+
+			return _transfers->begin(id,
+									 transfer["address"].asString(),
+									 transfer["size"].asUInt64(),
+									 lastError);
 		}
 
-		bool hasError = false;
+		if (action == "transferChunk")
+		{
+			if (!transfer.isMember("offset") || !transfer.isMember("data"))
+			{
+				lastError = "JSON解析错误: 缺少 'offset' 或 'data' 字段";
+				return false;
+			}
 
-		for (const std::string& deviceAddr : addressList)
+			std::string data;
+
+			try
+			{
+				data = base64_decode(transfer["data"].asString());
+			}
+			catch (const std::exception& e)
+			{
+				lastError = "JSON解析错误: 数据Base64解码失败";
+				return false;
+			}
+
+			if (transfer.isMember("size") && transfer["size"].asUInt64() != data.size())
+			{
+				lastError = "JSON解析错误: 数据校验失败";
+				return false;
+			}
+
+			_manager.getDiscoveryScheduler().notifyTraffic();
+
+			return _transfers->chunk(id, transfer["offset"].asUInt64(), data, lastError);
+		}
+
+		if (action == "transferAck")
 		{
-			std::string removeErr;
-			if (!_manager.requestRemoveDevice(deviceAddr, removeErr))
+			if (!transfer.isMember("offset"))
 			{
-				hasError = true;
-				lastError = removeErr;
+				lastError = "JSON解析错误: 缺少 'offset' 字段";
+				return false;
 			}
+
+			return _transfers->ack(id, transfer["offset"].asUInt64(), lastError);
 		}
 
-		return !hasError;
+		if (action == "transferCommit")
+			return _transfers->commit(id, lastError);
+
+		return _transfers->abort(id, lastError);
 	};
 
 	if (!parseJson(root, errs))
@@ -549,53 +1499,6 @@ void MqttProxy::removeDevices(const std::string& topic, const std::vector<uint8_
 	}
 }
 
-
-void MqttProxy::connectBenchmarkTest(const std::string& topic, const std::vector<uint8_t>& payload)
-{
-	std::string jsonBody(payload.begin(), payload.end());
-
-	// 解析message 为json
-	Json::CharReaderBuilder readerBuilder;
-	Json::Value root;
-	JSONCPP_STRING errs;
-	std::istringstream iss(jsonBody);
-
-	if (!Json::parseFromStream(readerBuilder, iss, &root, &errs))
-	{
-		LOG_ERROR("解析JSON消息失败 - {}", errs);
-		return;
-	}
-
-	std::string address = root["address"].asString();
-	int times = root["times"].asInt();
-
-	Json::Value body;
-	Json::Value device;
-	device["address"] = address;
-	device["pincode"] = "0000";
-	device["publishId"] = "019af669-232c-7433-9e1a-50613d2803b4";
-	device["publishTime"] = "2024-06-12 10:20:30";
-	body["device"] = device;
-
-	std::string str = body.toStyledString();
-	std::vector<uint8_t> sendData(str.begin(), str.end());
-
-	bool bSend = true;
-
-	for (int i = 0; i < times * 2; ++i)
-	{
-		if (bSend)
-			publish("/org/booway/bluetooth/connectDevice", sendData);
-		else
-			publish("/org/booway/bluetooth/disconnectDevice", sendData);
-
-		std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
-		bSend = !bSend;
-	}
-}
-
-
 #define JSON_BODY_CONNECTION(x, name)                                                              \
 	Json::Value root, device;                                                                      \
 	device["address"] = (x);                                                                       \
@@ -609,10 +1512,8 @@ void MqttProxy::onClientConnected(int clientId, const std::string& address)
 {
 	LOG_INFO("已连接: {}/{} -> {}", clientId, address, _server.getLocalAddress());
 
-	{
-		std::lock_guard<std::mutex> lock(_clientIdsMutex);
-		_clientIds[address] = clientId;
-	}
+	_sessions.add(_server.getSession(clientId));
+	onSessionOpened(address);
 
 	// 如果在发现设备列表中，返回名称
 	std::string name;
@@ -623,18 +1524,20 @@ void MqttProxy::onClientConnected(int clientId, const std::string& address)
 	// 发布客户端连接事件
 	JSON_BODY_CONNECTION(address, name)
 	std::vector<uint8_t> payload(body.begin(), body.end());
-	publish("/org/booway/bluetooth/newConnection", payload);
+	publishDevice(address, "/org/booway/bluetooth/newConnection", payload);
 }
 
 void MqttProxy::onClientDisconnected(int clientId, const std::string& address)
 {
 	LOG_INFO("已断开: {}/{} -> {}", clientId, address, _server.getLocalAddress());
 
+	_sessions.removeClosed(address);
+
+	// 同一设备已有新的会话时继续持有
+	if (!_sessions.find(address))
 	{
-		std::lock_guard<std::mutex> lock(_clientIdsMutex);
-		auto it = _clientIds.find(address);
-		if (it != _clientIds.end())
-			_clientIds.erase(it);
+		releaseDevice(address);
+		_flow.remove(address);
 	}
 
 	// 如果在发现设备列表中，返回名称
@@ -646,7 +1549,7 @@ void MqttProxy::onClientDisconnected(int clientId, const std::string& address)
 	// 发布客户端断开连接时间
 	JSON_BODY_CONNECTION(address, name)
 	std::vector<uint8_t> payload(body.begin(), body.end());
-	publish("/org/booway/bluetooth/loseConnection", payload);
+	publishDevice(address, "/org/booway/bluetooth/loseConnection", payload);
 }
 
 void MqttProxy::onServerConnected(const std::string& address, uint8_t channel)
@@ -662,25 +1565,21 @@ void MqttProxy::onServerConnected(const std::string& address, uint8_t channel)
 	// 发布连接到服务端事件
 	JSON_BODY_CONNECTION(address, name)
 	std::vector<uint8_t> payload(body.begin(), body.end());
-	publish("/org/booway/bluetooth/newConnection", payload);
+	publishDevice(address, "/org/booway/bluetooth/newConnection", payload);
 }
 
 void MqttProxy::onServerDisconnected(const std::string& address, uint8_t channel)
 {
 	LOG_INFO("已断开: {} -> {}/{}", _server.getLocalAddress(), channel, address);
 
-	// 保留内存，避免在_clients.erase时析构，导致无法获取远程设备地址
-	std::unique_ptr<BluetoothClient> client;
+	// 客户端仍在自身的断开流程中，由会话表延后释放
+	_sessions.removeClosed(address);
 
+	// 同一设备已有新的会话时继续持有
+	if (!_sessions.find(address))
 	{
-		std::lock_guard<std::mutex> lock(_clientsMutex);
-		auto it = _clients.find(address);
-		if (it != _clients.end())
-		{
-
-			client = std::move(it->second);
-			_clients.erase(it);
-		}
+		releaseDevice(address);
+		_flow.remove(address);
 	}
 
 	// 如果在发现设备列表中，返回名称
@@ -692,33 +1591,281 @@ void MqttProxy::onServerDisconnected(const std::string& address, uint8_t channel
 	// 发布与服务端断开连接事件
 	JSON_BODY_CONNECTION(address, name)
 	std::vector<uint8_t> payload(body.begin(), body.end());
-	publish("/org/booway/bluetooth/loseConnection", payload);
+	publishDevice(address, "/org/booway/bluetooth/loseConnection", payload);
 }
 
-#define JSON_BODY_DATA_CREATE(x, d, s)                                                             \
-	Json::Value root, device;                                                                      \
-	device["address"] = (x);                                                                       \
-	device["publishId"] = generateUUID();                                                          \
-	device["publishTime"] = formatTime(std::chrono::system_clock::now());                          \
-	device["data"] = base64_encode((d), (s));                                                      \
-	device["size"] = static_cast<Json::UInt>(s);                                                   \
-	root["device"] = device;                                                                       \
-	std::string body = root.toStyledString();
+std::unique_ptr<FrameDecoder> MqttProxy::createDecoder(const std::string& address)
+{
+	std::vector<std::string> uuids;
+
+	// 回环传输下没有 BlueZ 设备对象
+	if (_server.getTransport()->requiresPairing())
+	{
+		if (const Device* device = _manager.findDevice(address))
+			uuids = device->getProperties().uuids;
+	}
+
+	return _framing.create(address, uuids);
+}
 
-void MqttProxy::onReceiveClientData(const std::string& address, const uint8_t* data, size_t size)
+Buffer MqttProxy::encodeFrames(const std::string& address,
+							   const UplinkReplay::Stamp& stamp,
+							   const std::vector<UplinkEncoder::Frame>& frames,
+							   bool concat)
 {
-	LOG_INFO("已接收: {}({} bytes) -> SERVER", address, size);
+	// 单帧:   {"device":{"address":"..","stream":S,"seq":Q,"publishId":"..","publishTime":"..","data":"..","size":N}}
+	// 拼接:   {"device":{...,"data":"..","size":N,"count":C}}
+	// 帧数组: {"device":{...,"frames":[{"data":"..","size":N,"timestamp":T},...],"size":N,"count":C}}
+	size_t total = 0;
+	size_t capacity = 240 + address.size();
 
-	JSON_BODY_DATA_CREATE(address, data, size)
-	std::vector<uint8_t> payload(body.begin(), body.end());
-	publish("/org/booway/bluetooth/receiveFromDevice", payload);
+	for (const auto& frame : frames)
+	{
+		total += frame.data.size();
+		capacity += (frame.data.size() + 2) / 3 * 4 + 80;
+	}
+
+	BufferPool* pool = _server.getBufferPool();
+	Buffer body = pool ? pool->acquire(capacity) : Buffer::allocate(capacity);
+
+	char* begin = reinterpret_cast<char*>(body.data());
+	char* p = begin;
+	char number[24];
+
+	static const char kAddress[] = "{\"device\":{\"address\":\"";
+	static const char kStream[] = "\",\"stream\":";
+	static const char kSeq[] = ",\"seq\":";
+	static const char kPublishId[] = ",\"publishId\":\"";
+	static const char kPublishTime[] = "\",\"publishTime\":\"";
+	static const char kData[] = "\",\"data\":\"";
+	static const char kFrames[] = "\",\"frames\":[";
+	static const char kFrameData[] = "{\"data\":\"";
+	static const char kSize[] = "\",\"size\":";
+	static const char kTimestamp[] = ",\"timestamp\":";
+	static const char kTotalSize[] = "],\"size\":";
+	static const char kCount[] = ",\"count\":";
+
+	p = append(p, kAddress, sizeof(kAddress) - 1);
+	p = append(p, address.data(), address.size());
+	p = append(p, kStream, sizeof(kStream) - 1);
+	p = append(p,
+			   number,
+			   snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(stamp.stream)));
+	p = append(p, kSeq, sizeof(kSeq) - 1);
+	p = append(p,
+			   number,
+			   snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(stamp.seq)));
+	p = append(p, kPublishId, sizeof(kPublishId) - 1);
+	writeUUID(p);
+	p += 36;
+	p = append(p, kPublishTime, sizeof(kPublishTime) - 1);
+	p += writeTime(p, 32, std::chrono::system_clock::now());
+
+	if (frames.size() == 1 || concat)
+	{
+		p = append(p, kData, sizeof(kData) - 1);
+
+		if (frames.size() == 1)
+		{
+			const BufferSlice& frame = frames.front().data;
+			p += base64_encode_to(frame.data(), frame.size(), p);
+		}
+		else
+		{
+			// base64 需要连续数据，先拼接到临时缓冲区
+			Buffer joined = pool ? pool->acquire(total) : Buffer::allocate(total);
+			uint8_t* q = joined.data();
+
+			for (const auto& frame : frames)
+			{
+				std::memcpy(q, frame.data.data(), frame.data.size());
+				q += frame.data.size();
+			}
+
+			p += base64_encode_to(joined.data(), total, p);
+		}
+
+		p = append(p, kSize, sizeof(kSize) - 1);
+	}
+	else
+	{
+		p = append(p, kFrames, sizeof(kFrames) - 1);
+
+		for (size_t i = 0; i < frames.size(); ++i)
+		{
+			const auto& frame = frames[i];
+			auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+				frame.received.time_since_epoch());
+
+			if (i > 0)
+				*p++ = ',';
+
+			p = append(p, kFrameData, sizeof(kFrameData) - 1);
+			p += base64_encode_to(frame.data.data(), frame.data.size(), p);
+			p = append(p, kSize, sizeof(kSize) - 1);
+			p = append(p, number, snprintf(number, sizeof(number), "%zu", frame.data.size()));
+			p = append(p, kTimestamp, sizeof(kTimestamp) - 1);
+			p = append(p,
+					   number,
+					   snprintf(number, sizeof(number), "%lld", static_cast<long long>(timestamp.count())));
+			*p++ = '}';
+		}
+
+		p = append(p, kTotalSize, sizeof(kTotalSize) - 1);
+	}
+
+	p = append(p, number, snprintf(number, sizeof(number), "%zu", total));
+
+	if (frames.size() > 1)
+	{
+		p = append(p, kCount, sizeof(kCount) - 1);
+		p = append(p, number, snprintf(number, sizeof(number), "%zu", frames.size()));
+	}
+
+	p = append(p, "}}", 2);
+
+	body.resize(static_cast<size_t>(p - begin));
+	return body;
 }
 
-void MqttProxy::onReceiveServerData(const std::string& address, const uint8_t* data, size_t size)
+Buffer MqttProxy::encodeRaw(const std::string& address,
+							const UplinkReplay::Stamp& stamp,
+							const std::vector<UplinkEncoder::Frame>& frames,
+							bool concat,
+							PublishProperties& properties)
 {
-	LOG_INFO("已接收: {}({} bytes) -> CLIENT", address, size);
+	// 消息体为各帧原始数据依次拼接；多帧且不拼接时，sizes 给出各帧长度，消费端据此切分
+	size_t total = 0;
+	std::string sizes;
 
-	JSON_BODY_DATA_CREATE(address, data, size)
-	std::vector<uint8_t> payload(body.begin(), body.end());
-	publish("/org/booway/bluetooth/receiveFromDevice", payload);
+	for (const auto& frame : frames)
+	{
+		total += frame.data.size();
+
+		if (!concat && frames.size() > 1)
+		{
+			if (!sizes.empty())
+				sizes += ',';
+
+			sizes += std::to_string(frame.data.size());
+		}
+	}
+
+	BufferPool* pool = _server.getBufferPool();
+	Buffer body = pool ? pool->acquire(total) : Buffer::allocate(total);
+	uint8_t* p = body.data();
+
+	for (const auto& frame : frames)
+	{
+		std::memcpy(p, frame.data.data(), frame.data.size());
+		p += frame.data.size();
+	}
+
+	body.resize(total);
+
+	properties.contentType = "application/octet-stream";
+	properties.userProperties = { { "address", address },
+								  { "stream", std::to_string(stamp.stream) },
+								  { "seq", std::to_string(stamp.seq) },
+								  { "publishTime", formatTime(std::chrono::system_clock::now()) } };
+
+	if (frames.size() > 1)
+		properties.userProperties.emplace_back("count", std::to_string(frames.size()));
+
+	if (!sizes.empty())
+		properties.userProperties.emplace_back("sizes", sizes);
+
+	return body;
+}
+
+void MqttProxy::onReceiveClientData(const std::string& address, const BufferSlice& frame)
+{
+	_manager.getDiscoveryScheduler().notifyTraffic();
+	_flow.acquire(address);
+	_encoder->push(address, frame);
+}
+
+void MqttProxy::onReceiveServerData(const std::string& address, const BufferSlice& frame)
+{
+	_manager.getDiscoveryScheduler().notifyTraffic();
+	_flow.acquire(address);
+	_encoder->push(address, frame);
+}
+
+void MqttProxy::onSessionOpened(const std::string& address)
+{
+	_replay.reset(address);
+	flushOffline(address);
+
+	if (_transfers)
+		_transfers->resume(address);
+
+	claimDevice(address);
+}
+
+void MqttProxy::flushOffline(const std::string& address)
+{
+	if (!_offlineQueue)
+		return;
+
+	std::shared_ptr<Session> session = _sessions.find(address);
+	if (!session || !session->isOpen())
+		return;
+
+	_offlineQueue->flush(address, [&session](const std::vector<uint8_t>& data) {
+		return session->send(data) >= 0;
+	});
+}
+
+Json::Value MqttProxy::getOfflineQueueStats()
+{
+	if (!_offlineQueue)
+		return Json::Value();
+
+	_offlineQueue->expire();
+	return _offlineQueue->getStats();
+}
+
+Json::Value MqttProxy::getStats() const
+{
+	Json::Value root;
+
+	if (_encoder)
+		root["encoder"] = _encoder->getStats();
+
+	root["flow"] = _flow.getStats();
+
+	if (_cluster)
+		root["cluster"] = _cluster->getStats();
+
+	if (_mqtt)
+	{
+		root["connection"] = _mqtt->getConnectionStats();
+		root["publish"] = _mqtt->getPublishStats();
+	}
+
+	if (!_shards.empty())
+	{
+		Json::Value shards(Json::arrayValue);
+
+		for (const auto& shard : _shards)
+		{
+			Json::Value item;
+			item["connection"] = shard->getConnectionStats();
+			item["publish"] = shard->getPublishStats();
+			shards.append(item);
+		}
+
+		root["shards"] = shards;
+	}
+
+	if (_outbox)
+		root["outbox"] = _outbox->getStats();
+	root["sessions"] = _sessions.getStats();
+	root["replay"] = _replay.getStats();
+
+	if (_transfers)
+		root["transfer"] = _transfers->getStats();
+
+	return root;
 }
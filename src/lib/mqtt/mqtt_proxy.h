@@ -1,15 +1,25 @@
 #ifndef MQTT_PROXY_H_
 #define MQTT_PROXY_H_
 
+#include <array>
 #include <mutex>
+#include <string_view>
 #include <unordered_map>
 
+#include <mqtt/cluster_directory.h>
+#include <mqtt/flow_control.h>
 #include <mqtt/mqtt_client.h>
+#include <mqtt/offline_queue.h>
+#include <mqtt/transfer_manager.h>
+#include <mqtt/uplink_replay.h>
+#include <mqtt/uplink_encoder.h>
 #include <utils/config.h>
 
 #include <bluetooth/bluetooth_manager.h>
 #include <bluetooth/rfcomm/server.h>
 #include <bluetooth/rfcomm/client.h>
+#include <bluetooth/rfcomm/frame_decoder.h>
+#include <bluetooth/rfcomm/session.h>
 
 
 class CORE_API MqttProxy
@@ -23,12 +33,29 @@ public:
 
 	void publish(const std::string& topic, const std::vector<uint8_t>& payload);
 
+	void publish(const std::string& topic,
+				 Buffer payload,
+				 MqttClientImpl::PublishCallback done = nullptr);
+
+	// 上行编码、流控等运行统计
+	Json::Value getStats() const;
+
+	// 离线下行队列的深度、过期和补发延迟，同时清理过期消息；未启用时返回 null
+	Json::Value getOfflineQueueStats();
+
 protected:
 	void connectTo(const std::string& topic, const std::vector<uint8_t>& payload);
 	void disconnectTo(const std::string& topic, const std::vector<uint8_t>& payload);
 	void sendTo(const std::string& topic, const std::vector<uint8_t>& payload);
 	void removeDevices(const std::string& topic, const std::vector<uint8_t>& payload);
 	void connectBenchmarkTest(const std::string& topic, const std::vector<uint8_t>& payload);
+	void startDiscovery(const std::string& topic, const std::vector<uint8_t>& payload);
+
+	// 按 stream/序号范围重放缓存的上行消息
+	void replayFrom(const std::string& topic, const std::vector<uint8_t>& payload);
+
+	// transferBegin/transferChunk/transferCommit/transferAbort
+	void transfer(const std::string& topic, const std::vector<uint8_t>& payload);
 
 	void onClientConnected(int clientId, const std::string& address);
 	void onClientDisconnected(int clientId, const std::string& address);
@@ -36,26 +63,127 @@ protected:
 	void onServerConnected(const std::string& address, uint8_t channel);
 	void onServerDisconnected(const std::string& address, uint8_t channel);
 
-	void onReceiveClientData(const std::string& address, const uint8_t* data, size_t size);
-	void onReceiveServerData(const std::string& address, const uint8_t* data, size_t size);
+	void onReceiveClientData(const std::string& address, const BufferSlice& frame);
+	void onReceiveServerData(const std::string& address, const BufferSlice& frame);
 
 
 private:
+	// 发布主题的分类，按类配置 QoS 和消息过期时间
+	enum TopicClass : size_t
+	{
+		kTelemetry,
+		kEvents,
+		kStatus,
+		kTopicClassCount
+	};
+
+	// 按主题最后一段分类，每次发布都会调用，不分配内存
+	static TopicClass topicClass(std::string_view topic);
+
 	bool createAndConnect();
 
+	// 设备会话已建立：补发离线消息，继续暂停的分片传输，集群模式下登记设备归属
+	void onSessionOpened(const std::string& address);
+
+	// 订阅针对单个设备的命令；集群模式下经共享订阅接收并按设备归属转发，同时订阅本实例的
+	// 转发主题
+	void subscribeCommand(
+		const std::string& command,
+		MqttClientImpl::MessageCallback handler,
+		const MqttClientImpl::DispatchOptions& dispatch = MqttClientImpl::DispatchOptions());
+
+	// 设备由其他在线实例持有时转发到该实例，否则在本实例处理
+	void routeCommand(const std::string& command,
+					  const MqttClientImpl::MessageCallback& handler,
+					  const std::string& topic,
+					  const std::vector<uint8_t>& payload);
+
+	// 集群中其他实例的设备归属记录与在线状态
+	void onOwnerRecord(const std::string& topic, const std::vector<uint8_t>& payload);
+	void onPresence(const std::string& topic, const std::vector<uint8_t>& payload);
+
+	// 发布或清除本实例的设备归属记录(保留消息)
+	void claimDevice(const std::string& address);
+	void releaseDevice(const std::string& address);
+
+	// 设备会话已建立时按顺序补发离线期间暂存的下行消息
+	void flushOffline(const std::string& address);
+
+	std::unique_ptr<FrameDecoder> createDecoder(const std::string& address);
+
+	// 读线程的流控门限，积压时最多等待 100ms 后返回
+	bool waitReadable(const std::string& address);
+
+	// 主题所属分类(telemetry/events/status)配置的发布 QoS
+	int qosFor(const std::string& topic) const;
+
+	// 主题所属分类配置的 v5 发布属性(消息过期时间)
+	PublishProperties propertiesFor(const std::string& topic) const;
+
+	// 设备的上行消息和事件按地址固定由一条发布连接发出，保证同一设备的消息有序；
+	// 未配置发布分片时为 _mqtt
+	MqttClientImpl* clientFor(const std::string& address) const;
+
+	void publishDevice(const std::string& address,
+					   const std::string& topic,
+					   const std::vector<uint8_t>& payload);
+
+	// properties 为空时使用 propertiesFor(topic)
+	void publishDevice(const std::string& address,
+					   const std::string& topic,
+					   Buffer payload,
+					   MqttClientImpl::PublishCallback done = nullptr,
+					   PublishProperties properties = PublishProperties());
+
+	// 设备的上行聚合策略，设备配置优先于默认配置
+	UplinkEncoder::BatchOptions batchOptions(const std::string& address) const;
+
+	// 将一帧或聚合的多帧编码为带序号的 receiveFromDevice 消息，直接写入缓冲池中的缓冲区
+	Buffer encodeFrames(const std::string& address,
+						const UplinkReplay::Stamp& stamp,
+						const std::vector<UplinkEncoder::Frame>& frames,
+						bool concat);
+
+	// v5 精简封装：消息体为原始帧数据，地址、序号和时间放在用户属性中
+	Buffer encodeRaw(const std::string& address,
+					 const UplinkReplay::Stamp& stamp,
+					 const std::vector<UplinkEncoder::Frame>& frames,
+					 bool concat,
+					 PublishProperties& properties);
+
 	BluetoothManager& _manager;
 	BluetoothServer& _server;
 	JsonConfig& _config;
-
+	FramingConfig _framing;
+	std::array<int, kTopicClassCount> _qos{};
+	std::array<uint32_t, kTopicClassCount> _expiry{};
+	bool _rawUplink = false;
+	UplinkEncoder::BatchOptions _batchDefault;
+	std::unordered_map<std::string, UplinkEncoder::BatchOptions> _batchDevices;
+	// 须在 _mqtt 之前声明，发布回调中归还信用
+	FlowControl _flow;
+	// 须在 _mqtt 之前声明，客户端析构时仍可能存入消息；未启用时为空
+	std::unique_ptr<MqttOutbox> _outbox;
+	UplinkReplay _replay;
+	// 须在 _mqtt 之前声明，消息回调中使用；未启用集群模式时为空
+	std::unique_ptr<ClusterDirectory> _cluster;
+	std::string _clusterGroup;
+
+	// 控制连接：订阅全部命令主题，发布与设备无关的状态
 	std::unique_ptr<MqttClientImpl> _mqtt;
-	std::mutex _clientIdsMutex;
-	std::mutex _clientsMutex;
+	// 发布分片，每个分片一条独立的代理连接，只发布不订阅
+	std::vector<std::unique_ptr<MqttClientImpl>> _shards;
+	// 须在 _mqtt、_shards 之后声明，先于它们析构
+	std::unique_ptr<UplinkEncoder> _encoder;
+
+	// 设备会话(设备连入或主动连接)，主动连接的 BluetoothClient 随会话保留
+	SessionRegistry _sessions;
 
-	// 作为服务断连接的设备
-	std::unordered_map<std::string, int> _clientIds;
-	// 作为客户端
-	std::unordered_map<std::string, std::unique_ptr<BluetoothClient>> _clients;
+	// 未启用时为空
+	std::unique_ptr<OfflineQueue> _offlineQueue;
 
+	// 发送线程查找会话并通过 _mqtt 发布进度，须最先析构
+	std::unique_ptr<TransferManager> _transfers;
 };
 
 #endif // MQTT_PROXY_H_
\ No newline at end of file
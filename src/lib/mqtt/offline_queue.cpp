@@ -0,0 +1,408 @@
+#include <mqtt/offline_queue.h>
+#include <utils/logger.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+namespace {
+
+	// 持久化文件格式：64 字节文件头，之后为顺序追加的记录，magic 不匹配处为日志结尾
+	constexpr uint32_t kFileMagic = 0x514F4242;	  // "BBOQ"
+	constexpr uint32_t kRecordMagic = 0x43455242; // "BREC"
+	constexpr uint32_t kVersion = 1;
+	constexpr size_t kHeaderSize = 64;
+	constexpr size_t kNpos = static_cast<size_t>(-1);
+
+	enum RecordState : uint8_t
+	{
+		kWriting = 0,
+		kLive = 1,
+		kConsumed = 2
+	};
+
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+	};
+
+	struct RecordHeader
+	{
+		uint32_t magic;
+		uint32_t length;
+		int64_t enqueuedMs;
+		int64_t expiresMs;
+		char address[18];
+		uint8_t state;
+		uint8_t reserved[5];
+	};
+
+	static_assert(sizeof(RecordHeader) == 48, "RecordHeader 布局变化会破坏已有文件");
+
+	size_t recordSize(size_t length) { return (sizeof(RecordHeader) + length + 7) & ~size_t(7); }
+
+	int64_t toMs(const OfflineQueue::Clock::time_point& tp)
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(tp.time_since_epoch()).count();
+	}
+
+	OfflineQueue::Clock::time_point fromMs(int64_t ms)
+	{
+		return OfflineQueue::Clock::time_point(std::chrono::milliseconds(ms));
+	}
+
+	// 在 offset 处写入日志结尾标记
+	void terminate(MappedFile& file, size_t offset)
+	{
+		if (offset + sizeof(uint32_t) <= file.size())
+			std::memset(file.data() + offset, 0, sizeof(uint32_t));
+	}
+}
+
+OfflineQueue::OfflineQueue(const Options& options)
+	: _options(options),
+	  _writeOffset(kHeaderSize),
+	  _enqueued(0),
+	  _expired(0),
+	  _dropped(0),
+	  _flushed(0),
+	  _latencyTotalMs(0),
+	  _latencyMaxMs(0)
+{
+	if (_options.path.empty())
+		return;
+
+	_file = std::make_unique<MappedFile>();
+
+	if (_options.fileSize < kHeaderSize + recordSize(0) || !_file->open(_options.path, _options.fileSize))
+	{
+		LOG_WARN("离线队列持久化文件不可用，仅保存在内存 - {}", _options.path);
+		_file.reset();
+		return;
+	}
+
+	load();
+}
+
+OfflineQueue::~OfflineQueue()
+{
+	if (_file)
+		_file->sync(false);
+}
+
+OfflineQueue::Admit OfflineQueue::admit(const std::string& address,
+										const uint8_t* data,
+										size_t size,
+										bool online)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto it = _queues.find(address);
+	bool backlog = it != _queues.end() && (!it->second.messages.empty() || it->second.flushing);
+
+	if (online && !backlog)
+		return Admit::Direct;
+
+	DeviceQueue& queue = _queues[address];
+	Clock::time_point now = Clock::now();
+
+	if (!queue.flushing)
+		expireLocked(address, queue, now);
+
+	if (queue.messages.size() >= _options.maxMessages ||
+		queue.bytes + size > _options.maxBytes)
+	{
+		++_dropped;
+		return Admit::Full;
+	}
+
+	push(address,
+		 Message{ std::vector<uint8_t>(data, data + size), now, now + _options.ttl, kNpos });
+	++_enqueued;
+
+	return Admit::Queued;
+}
+
+size_t OfflineQueue::flush(const std::string& address, const Sender& send)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto it = _queues.find(address);
+		if (it == _queues.end() || it->second.flushing)
+			return 0;
+
+		it->second.flushing = true;
+	}
+
+	size_t sent = 0;
+
+	while (true)
+	{
+		std::vector<uint8_t> data;
+		Clock::time_point enqueued;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			DeviceQueue& queue = _queues[address];
+
+			expireLocked(address, queue, Clock::now());
+
+			if (queue.messages.empty())
+			{
+				_queues.erase(address);
+				break;
+			}
+
+			// 发送成功后才出队，期间压缩文件仍会保留该消息
+			data = queue.messages.front().data;
+			enqueued = queue.messages.front().enqueued;
+		}
+
+		bool ok = send(data);
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		DeviceQueue& queue = _queues[address];
+
+		if (!ok)
+		{
+			queue.flushing = false;
+			LOG_WARN("{} 离线消息补发中断，剩余 {} 条", address, queue.messages.size());
+			break;
+		}
+
+		Message& front = queue.messages.front();
+		markConsumed(front.offset);
+		queue.bytes -= front.data.size();
+		queue.messages.pop_front();
+
+		uint64_t latency = static_cast<uint64_t>(
+			std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - enqueued).count());
+
+		_latencyTotalMs += latency;
+		_latencyMaxMs = std::max(_latencyMaxMs, latency);
+		++_flushed;
+		++sent;
+	}
+
+	if (sent > 0)
+		LOG_INFO("{} 已补发离线消息 {} 条", address, sent);
+
+	return sent;
+}
+
+void OfflineQueue::expire()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	Clock::time_point now = Clock::now();
+
+	for (auto it = _queues.begin(); it != _queues.end();)
+	{
+		DeviceQueue& queue = it->second;
+
+		if (!queue.flushing)
+			expireLocked(it->first, queue, now);
+
+		if (queue.messages.empty() && !queue.flushing)
+			it = _queues.erase(it);
+		else
+			++it;
+	}
+
+	if (_file)
+		_file->sync(true);
+}
+
+Json::Value OfflineQueue::getStats() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	Json::Value root;
+	Json::Value devices(Json::objectValue);
+	uint64_t queued = 0;
+	Clock::time_point now = Clock::now();
+
+	for (const auto& [address, queue] : _queues)
+	{
+		if (queue.messages.empty())
+			continue;
+
+		Json::Value device;
+		device["depth"] = static_cast<Json::UInt64>(queue.messages.size());
+		device["bytes"] = static_cast<Json::UInt64>(queue.bytes);
+		device["oldestMs"] = static_cast<Json::Int64>(
+			std::chrono::duration_cast<std::chrono::milliseconds>(now - queue.messages.front().enqueued)
+				.count());
+		devices[address] = device;
+
+		queued += queue.messages.size();
+	}
+
+	root["persistent"] = _file != nullptr;
+	root["queued"] = static_cast<Json::UInt64>(queued);
+	root["enqueued"] = static_cast<Json::UInt64>(_enqueued);
+	root["expired"] = static_cast<Json::UInt64>(_expired);
+	root["dropped"] = static_cast<Json::UInt64>(_dropped);
+	root["flushed"] = static_cast<Json::UInt64>(_flushed);
+	root["flushLatencyAvgMs"] = static_cast<Json::UInt64>(_flushed ? _latencyTotalMs / _flushed : 0);
+	root["flushLatencyMaxMs"] = static_cast<Json::UInt64>(_latencyMaxMs);
+	root["devices"] = devices;
+	return root;
+}
+
+void OfflineQueue::push(const std::string& address, Message message)
+{
+	if (_file)
+		message.offset = append(address, message);
+
+	DeviceQueue& queue = _queues[address];
+	queue.bytes += message.data.size();
+	queue.messages.push_back(std::move(message));
+}
+
+size_t OfflineQueue::expireLocked(const std::string& address, DeviceQueue& queue, Clock::time_point now)
+{
+	size_t expired = 0;
+
+	for (auto it = queue.messages.begin(); it != queue.messages.end();)
+	{
+		if (it->expires > now)
+		{
+			++it;
+			continue;
+		}
+
+		markConsumed(it->offset);
+		queue.bytes -= it->data.size();
+		it = queue.messages.erase(it);
+		++expired;
+	}
+
+	if (expired > 0)
+	{
+		_expired += expired;
+		LOG_WARN("{} 离线消息过期丢弃 {} 条", address, expired);
+	}
+
+	return expired;
+}
+
+void OfflineQueue::load()
+{
+	uint8_t* base = _file->data();
+	FileHeader header;
+	std::memcpy(&header, base, sizeof(header));
+
+	if (header.magic != kFileMagic || header.version != kVersion)
+	{
+		// 新文件或格式不兼容，重新初始化
+		header = { kFileMagic, kVersion };
+		std::memset(base, 0, kHeaderSize);
+		std::memcpy(base, &header, sizeof(header));
+		terminate(*_file, kHeaderSize);
+		_writeOffset = kHeaderSize;
+		return;
+	}
+
+	size_t offset = kHeaderSize;
+	size_t loaded = 0;
+	Clock::time_point now = Clock::now();
+
+	while (offset + sizeof(RecordHeader) <= _file->size())
+	{
+		RecordHeader record;
+		std::memcpy(&record, base + offset, sizeof(record));
+
+		if (record.magic != kRecordMagic || record.state == kWriting ||
+			offset + recordSize(record.length) > _file->size())
+			break;
+
+		if (record.state == kLive && fromMs(record.expiresMs) > now)
+		{
+			const uint8_t* payload = base + offset + sizeof(RecordHeader);
+			std::string address(record.address, strnlen(record.address, sizeof(record.address)));
+
+			Message message{ std::vector<uint8_t>(payload, payload + record.length),
+							 fromMs(record.enqueuedMs),
+							 fromMs(record.expiresMs),
+							 offset };
+
+			DeviceQueue& queue = _queues[address];
+			queue.bytes += message.data.size();
+			queue.messages.push_back(std::move(message));
+			++loaded;
+		}
+
+		offset += recordSize(record.length);
+	}
+
+	_writeOffset = offset;
+	terminate(*_file, _writeOffset);
+
+	if (loaded > 0)
+		LOG_INFO("已从 {} 恢复离线消息 {} 条", _options.path, loaded);
+}
+
+size_t OfflineQueue::append(const std::string& address, const Message& message)
+{
+	size_t size = recordSize(message.data.size());
+
+	if (address.size() >= sizeof(RecordHeader::address))
+		return kNpos;
+
+	if (_writeOffset + size > _file->size())
+		compact();
+
+	if (_writeOffset + size > _file->size())
+	{
+		LOG_WARN("离线队列持久化文件已满，消息仅保存在内存 - {}", address);
+		return kNpos;
+	}
+
+	uint8_t* p = _file->data() + _writeOffset;
+
+	RecordHeader record = {};
+	record.magic = kRecordMagic;
+	record.length = static_cast<uint32_t>(message.data.size());
+	record.enqueuedMs = toMs(message.enqueued);
+	record.expiresMs = toMs(message.expires);
+	std::memcpy(record.address, address.data(), address.size());
+	record.state = kWriting;
+
+	// 先写内容和结尾标记，最后置为有效
+	std::memcpy(p, &record, sizeof(record));
+	std::memcpy(p + sizeof(record), message.data.data(), message.data.size());
+	terminate(*_file, _writeOffset + size);
+	p[offsetof(RecordHeader, state)] = kLive;
+
+	size_t offset = _writeOffset;
+	_writeOffset += size;
+	return offset;
+}
+
+void OfflineQueue::markConsumed(size_t offset)
+{
+	if (_file && offset != kNpos)
+		_file->data()[offset + offsetof(RecordHeader, state)] = kConsumed;
+}
+
+void OfflineQueue::compact()
+{
+	// 按内存中的有效消息重写日志，丢弃已补发和已过期的记录
+	_writeOffset = kHeaderSize;
+	terminate(*_file, _writeOffset);
+
+	for (auto& [address, queue] : _queues)
+	{
+		for (auto& message : queue.messages)
+		{
+			message.offset = kNpos;
+
+			if (_writeOffset + recordSize(message.data.size()) <= _file->size())
+				message.offset = append(address, message);
+		}
+	}
+
+	_file->sync(true);
+}
@@ -0,0 +1,107 @@
+#ifndef MQTT_OFFLINE_QUEUE_H_
+#define MQTT_OFFLINE_QUEUE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <json/json.h>
+
+#include <defines.h>
+#include <utils/mapped_file.h>
+
+// 设备离线期间的下行暂存队列
+//
+// sendToDevice 的目标设备未连接时按设备地址暂存，超过 TTL 的消息丢弃；会话建立后
+// 按入队顺序补发，补发期间新到的下行消息排在积压之后。可选持久化到内存映射文件，
+// 重启后恢复未过期的消息。
+class CORE_API OfflineQueue
+{
+public:
+	using Clock = std::chrono::system_clock;
+	using Sender = std::function<bool(const std::vector<uint8_t>&)>;
+
+	struct Options
+	{
+		size_t maxMessages = 256;		  // 每个设备最多暂存的消息数
+		size_t maxBytes = 64 * 1024;	  // 每个设备最多暂存的字节数
+		std::chrono::seconds ttl{ 60 };	  // 消息有效期
+		std::string path;				  // 持久化文件，为空时只保存在内存
+		size_t fileSize = 4 * 1024 * 1024; // 持久化文件大小
+	};
+
+	enum class Admit
+	{
+		Direct, // 设备在线且无积压，由调用方直接发送
+		Queued, // 已暂存
+		Full	// 队列已满，丢弃
+	};
+
+	explicit OfflineQueue(const Options& options);
+
+	~OfflineQueue();
+
+	OfflineQueue(const OfflineQueue&) = delete;
+	OfflineQueue& operator=(const OfflineQueue&) = delete;
+
+	// 设备在线且无积压、未在补发时返回 Direct；否则复制 data 尝试暂存
+	Admit admit(const std::string& address, const uint8_t* data, size_t size, bool online);
+
+	// 按顺序补发该设备的积压，send 返回 false 时停止并保留剩余消息；返回发送的条数
+	size_t flush(const std::string& address, const Sender& send);
+
+	// 丢弃过期消息，由周期任务调用
+	void expire();
+
+	// 队列深度、过期、补发延迟等统计
+	Json::Value getStats() const;
+
+private:
+	struct Message
+	{
+		std::vector<uint8_t> data;
+		Clock::time_point enqueued;
+		Clock::time_point expires;
+		size_t offset; // 在持久化文件中的位置，未持久化时为 npos
+	};
+
+	struct DeviceQueue
+	{
+		std::deque<Message> messages;
+		size_t bytes = 0;
+		bool flushing = false;
+	};
+
+	// 以下调用方持有锁
+	void push(const std::string& address, Message message);
+	size_t expireLocked(const std::string& address, DeviceQueue& queue, Clock::time_point now);
+
+	// 持久化
+	void load();
+	size_t append(const std::string& address, const Message& message);
+	void markConsumed(size_t offset);
+	void compact();
+
+private:
+	Options _options;
+	std::unique_ptr<MappedFile> _file;
+	size_t _writeOffset;
+
+	mutable std::mutex _mutex;
+	std::unordered_map<std::string, DeviceQueue> _queues;
+
+	uint64_t _enqueued;
+	uint64_t _expired;
+	uint64_t _dropped;
+	uint64_t _flushed;
+	uint64_t _latencyTotalMs;
+	uint64_t _latencyMaxMs;
+};
+
+#endif // MQTT_OFFLINE_QUEUE_H_
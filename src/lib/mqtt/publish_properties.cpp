@@ -0,0 +1,96 @@
+#include <mqtt/publish_properties.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+	// 格式：u32 过期时间，u16 长度前缀的 contentType、correlationData，u16 用户属性数，
+	// 之后为成对的 u16 长度前缀字符串；整数按本机字节序，只在本机的发件箱中使用
+	void putU16(std::string& out, uint16_t value) { out.append(reinterpret_cast<const char*>(&value), 2); }
+
+	void putString(std::string& out, const std::string& value)
+	{
+		putU16(out, static_cast<uint16_t>(value.size()));
+		out.append(value);
+	}
+
+	bool getU16(const std::string& data, size_t& offset, uint16_t& value)
+	{
+		if (offset + 2 > data.size())
+			return false;
+
+		std::memcpy(&value, data.data() + offset, 2);
+		offset += 2;
+		return true;
+	}
+
+	bool getString(const std::string& data, size_t& offset, std::string& value)
+	{
+		uint16_t length = 0;
+		if (!getU16(data, offset, length) || offset + length > data.size())
+			return false;
+
+		value.assign(data, offset, length);
+		offset += length;
+		return true;
+	}
+}
+
+bool PublishProperties::empty() const
+{
+	return messageExpiry == 0 && contentType.empty() && correlationData.empty() && userProperties.empty();
+}
+
+std::string PublishProperties::serialize() const
+{
+	std::string out;
+
+	if (empty())
+		return out;
+
+	out.append(reinterpret_cast<const char*>(&messageExpiry), 4);
+	putString(out, contentType.substr(0, UINT16_MAX));
+	putString(out, correlationData.substr(0, UINT16_MAX));
+	putU16(out, static_cast<uint16_t>(std::min<size_t>(userProperties.size(), UINT16_MAX)));
+
+	for (size_t i = 0; i < userProperties.size() && i < UINT16_MAX; ++i)
+	{
+		putString(out, userProperties[i].first.substr(0, UINT16_MAX));
+		putString(out, userProperties[i].second.substr(0, UINT16_MAX));
+	}
+
+	return out;
+}
+
+bool PublishProperties::parse(const std::string& data, PublishProperties& properties)
+{
+	properties = PublishProperties();
+
+	if (data.empty())
+		return true;
+
+	if (data.size() < 4)
+		return false;
+
+	size_t offset = 0;
+	std::memcpy(&properties.messageExpiry, data.data(), 4);
+	offset += 4;
+
+	uint16_t count = 0;
+	if (!getString(data, offset, properties.contentType) ||
+		!getString(data, offset, properties.correlationData) || !getU16(data, offset, count))
+	{
+		return false;
+	}
+
+	properties.userProperties.resize(count);
+
+	for (auto& [name, value] : properties.userProperties)
+	{
+		if (!getString(data, offset, name) || !getString(data, offset, value))
+			return false;
+	}
+
+	return offset == data.size();
+}
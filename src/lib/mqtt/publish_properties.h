@@ -0,0 +1,28 @@
+#ifndef MQTT_PUBLISH_PROPERTIES_H_
+#define MQTT_PUBLISH_PROPERTIES_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <defines.h>
+
+// MQTT v5 PUBLISH 属性，以 v3.1.1 连接时忽略
+struct CORE_API PublishProperties
+{
+	uint32_t messageExpiry = 0; // 消息在代理上的保留时间(秒)，0 表示不过期
+	std::string contentType;
+	std::string correlationData;
+	std::vector<std::pair<std::string, std::string>> userProperties;
+
+	bool empty() const;
+
+	// 序列化为字节串，随消息存入发件箱；空属性序列化为空串
+	std::string serialize() const;
+
+	// 解析 serialize 的结果，空串得到空属性
+	static bool parse(const std::string& data, PublishProperties& properties);
+};
+
+#endif // MQTT_PUBLISH_PROPERTIES_H_
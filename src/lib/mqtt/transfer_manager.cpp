@@ -0,0 +1,651 @@
+#include <mqtt/transfer_manager.h>
+#include <utils/logger.h>
+
+#include <algorithm>
+
+namespace {
+
+	// 无可写数据时的等待时间，也是进度与超时检查的最小间隔
+	constexpr std::chrono::milliseconds kIdleWait(50);
+
+	// 单次等待连接可写的时间，避免长时间占用会话
+	constexpr std::chrono::milliseconds kWriteWait(20);
+}
+
+TransferManager::TransferManager(const Options& options, SessionLookup lookup, ProgressCallback progress)
+	: _options(options),
+	  _lookup(std::move(lookup)),
+	  _progress(std::move(progress)),
+	  _stopping(false),
+	  _signaled(false),
+	  _completed(0),
+	  _failed(0),
+	  _bytesWritten(0)
+{
+	if (_options.writeBytes == 0)
+		_options.writeBytes = 1;
+
+	_thread = std::thread(&TransferManager::run, this);
+}
+
+TransferManager::~TransferManager()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+
+	_cv.notify_one();
+
+	if (_thread.joinable())
+		_thread.join();
+}
+
+bool TransferManager::begin(const std::string& id,
+							const std::string& address,
+							uint64_t size,
+							std::string& error)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		Clock::time_point now = Clock::now();
+
+		auto it = _transfers.find(id);
+		if (it != _transfers.end())
+		{
+			Transfer& transfer = *it->second;
+
+			if (transfer.address != address || transfer.size != size)
+			{
+				error = "传输ID已存在: " + id;
+				return false;
+			}
+
+			// 续传：发布当前进度，上位机从 received 继续发送
+			transfer.lastActivity = now;
+			transfer.dirty = true;
+			_signaled = true;
+		}
+		else
+		{
+			if (size == 0)
+			{
+				error = "传输大小无效: " + id;
+				return false;
+			}
+
+			if (_transfers.size() >= _options.maxTransfers)
+			{
+				error = "同时进行的传输过多";
+				return false;
+			}
+
+			// 同一设备的两个传输会交错写入
+			for (const auto& [otherId, other] : _transfers)
+			{
+				if (other->address == address)
+				{
+					error = "设备已有进行中的传输: " + address;
+					return false;
+				}
+			}
+
+			auto transfer = std::make_shared<Transfer>();
+			transfer->id = id;
+			transfer->address = address;
+			transfer->size = size;
+			transfer->started = now;
+			transfer->lastActivity = now;
+			transfer->lastProgress = now;
+
+			_transfers[id] = transfer;
+			_signaled = true;
+
+			LOG_INFO("{} 开始分片传输 {}({} bytes)", address, id, size);
+		}
+	}
+
+	_cv.notify_one();
+	return true;
+}
+
+bool TransferManager::chunk(const std::string& id, uint64_t offset, const std::string& data, std::string& error)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto it = _transfers.find(id);
+		if (it == _transfers.end())
+		{
+			error = "传输不存在: " + id;
+			return false;
+		}
+
+		Transfer& transfer = *it->second;
+
+		if (transfer.state != State::Receiving)
+		{
+			error = "传输已提交或已结束: " + id;
+			return false;
+		}
+
+		if (offset > transfer.size || data.size() > transfer.size - offset)
+		{
+			error = "分片超出传输大小: " + id;
+			return false;
+		}
+
+		if (offset > transfer.received)
+		{
+			// 后面的分片先到(如上位机并发发送)，在窗口内暂存到前面的分片到达
+			if (offset + data.size() - transfer.bufferStart > _options.windowBytes)
+			{
+				error = "分片不连续: 期望偏移 " + std::to_string(transfer.received) + "，实际 " +
+						std::to_string(offset);
+				transfer.dirty = true;
+				_signaled = true;
+				return false;
+			}
+
+			std::string& held = transfer.held[offset];
+			if (held.size() < data.size())
+				held = data;
+
+			transfer.lastActivity = Clock::now();
+			return true;
+		}
+
+		// 重发的分片只取未接收的部分
+		uint64_t skip = transfer.received - offset;
+		if (skip >= data.size())
+			return true;
+
+		size_t size = data.size() - static_cast<size_t>(skip);
+
+		if (transfer.received - transfer.bufferStart + size > _options.windowBytes)
+		{
+			error = "传输窗口已满: " + id;
+			transfer.dirty = true;
+			_signaled = true;
+			return false;
+		}
+
+		transfer.pending.emplace_back(data.begin() + static_cast<std::ptrdiff_t>(skip), data.end());
+		transfer.received += size;
+		transfer.lastActivity = Clock::now();
+		transfer.message.clear();
+		appendHeldLocked(transfer);
+		_signaled = true;
+	}
+
+	_cv.notify_one();
+	return true;
+}
+
+bool TransferManager::commit(const std::string& id, std::string& error)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto it = _transfers.find(id);
+		if (it == _transfers.end())
+		{
+			error = "传输不存在: " + id;
+			return false;
+		}
+
+		Transfer& transfer = *it->second;
+
+		if (transfer.state == State::Committed)
+			return true;
+
+		if (transfer.state != State::Receiving)
+		{
+			error = "传输已结束: " + id;
+			return false;
+		}
+
+		// 最后的分片可能仍在处理，接收完成后再提交；分片缺失时由空闲超时结束传输
+		transfer.commitPending = true;
+		transfer.lastActivity = Clock::now();
+		appendHeldLocked(transfer);
+		transfer.dirty = true;
+		_signaled = true;
+	}
+
+	_cv.notify_one();
+	return true;
+}
+
+bool TransferManager::ack(const std::string& id, uint64_t offset, std::string& error)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto it = _transfers.find(id);
+		if (it == _transfers.end())
+		{
+			error = "传输不存在: " + id;
+			return false;
+		}
+
+		Transfer& transfer = *it->second;
+
+		if (offset > transfer.received)
+		{
+			error = "确认偏移超出已接收的数据: " + std::to_string(offset) + "/" +
+					std::to_string(transfer.received);
+			return false;
+		}
+
+		// 重复或过期的确认
+		if (offset <= transfer.acked)
+			return true;
+
+		// 断开回退后，设备仍可能确认回退前已写出的数据
+		if (offset > transfer.written)
+			transfer.written = offset;
+
+		transfer.acked = offset;
+		transfer.lastActivity = Clock::now();
+		discardLocked(transfer, _options.ackRequired ? transfer.acked : transfer.written);
+		_signaled = true;
+	}
+
+	_cv.notify_one();
+	return true;
+}
+
+bool TransferManager::abort(const std::string& id, std::string& error)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto it = _transfers.find(id);
+		if (it == _transfers.end())
+		{
+			error = "传输不存在: " + id;
+			return false;
+		}
+
+		finishLocked(*it->second, State::Aborted, "传输已取消");
+		_signaled = true;
+	}
+
+	_cv.notify_one();
+	return true;
+}
+
+void TransferManager::resume(const std::string& address)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		bool found = std::any_of(_transfers.begin(), _transfers.end(), [&address](const auto& item) {
+			return item.second->address == address;
+		});
+
+		if (!found)
+			return;
+
+		_signaled = true;
+	}
+
+	_cv.notify_one();
+}
+
+Json::Value TransferManager::getStats() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	Json::Value root;
+	Json::Value transfers(Json::objectValue);
+
+	for (const auto& [id, transfer] : _transfers)
+	{
+		Json::Value item;
+		item["address"] = transfer->address;
+		item["state"] = stateName(transfer->state);
+		item["size"] = static_cast<Json::UInt64>(transfer->size);
+		item["received"] = static_cast<Json::UInt64>(transfer->received);
+		item["written"] = static_cast<Json::UInt64>(transfer->written);
+		item["acked"] = static_cast<Json::UInt64>(transfer->acked);
+		item["paused"] = transfer->paused;
+		item["bytesPerSec"] = static_cast<Json::UInt64>(transfer->bytesPerSec);
+		transfers[id] = item;
+	}
+
+	root["active"] = static_cast<Json::UInt64>(_transfers.size());
+	root["completed"] = static_cast<Json::UInt64>(_completed);
+	root["failed"] = static_cast<Json::UInt64>(_failed);
+	root["bytesWritten"] = static_cast<Json::UInt64>(_bytesWritten);
+	root["transfers"] = transfers;
+	return root;
+}
+
+void TransferManager::run()
+{
+	std::vector<std::shared_ptr<Transfer>> active;
+	std::vector<Json::Value> reports;
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (!_stopping)
+	{
+		// 有未确认数据的传输都须检查连接，断开时回退
+		for (const auto& [id, transfer] : _transfers)
+		{
+			if (transfer->received > transfer->acked)
+				active.push_back(transfer);
+		}
+
+		lock.unlock();
+
+		bool progressed = false;
+		for (const auto& transfer : active)
+			progressed |= writeSome(transfer);
+
+		active.clear();
+		lock.lock();
+
+		// 完成、超时检查及进度发布
+		Clock::time_point now = Clock::now();
+
+		for (auto it = _transfers.begin(); it != _transfers.end();)
+		{
+			Transfer& transfer = *it->second;
+
+			uint64_t delivered = _options.ackRequired ? transfer.acked : transfer.written;
+
+			if (transfer.state == State::Committed && delivered == transfer.size)
+				finishLocked(transfer, State::Completed, "");
+			else if (transfer.state <= State::Committed && now - transfer.lastActivity > _options.idleTimeout)
+				finishLocked(transfer, State::Failed, transfer.paused ? "设备未连接，传输超时" : "传输超时");
+
+			bool finished = transfer.state > State::Committed;
+
+			if (transfer.dirty || finished || now - transfer.lastProgress >= _options.progressInterval)
+				reports.push_back(progressLocked(transfer, now));
+
+			if (finished)
+				it = _transfers.erase(it);
+			else
+				++it;
+		}
+
+		if (!reports.empty())
+		{
+			lock.unlock();
+
+			if (_progress)
+			{
+				for (const auto& report : reports)
+					_progress(report);
+			}
+
+			reports.clear();
+			lock.lock();
+		}
+
+		if (!progressed)
+			_cv.wait_for(lock, kIdleWait, [this]() { return _stopping || _signaled; });
+
+		_signaled = false;
+	}
+}
+
+bool TransferManager::writeSome(const std::shared_ptr<Transfer>& transfer)
+{
+	std::shared_ptr<Session> session = _lookup ? _lookup(transfer->address) : nullptr;
+	bool open = session && session->isOpen();
+	std::vector<uint8_t> data;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if (transfer->state > State::Committed)
+			return false;
+
+		if (transfer->paused == open)
+		{
+			transfer->paused = !open;
+			transfer->dirty = true;
+
+			if (open)
+				LOG_INFO("{} 分片传输 {} 从偏移 {} 继续", transfer->address, transfer->id, transfer->written);
+			else
+				rewindLocked(*transfer);
+		}
+
+		if (!open || transfer->written == transfer->received)
+			return false;
+
+		// 复制待写数据，写出期间允许追加分片、确认或取消传输
+		uint64_t skip = transfer->written - transfer->bufferStart;
+		size_t remaining = _options.writeBytes;
+		size_t head = transfer->pendingHead;
+
+		for (const auto& block : transfer->pending)
+		{
+			size_t available = block.size() - head;
+
+			if (skip >= available)
+			{
+				skip -= available;
+				head = 0;
+				continue;
+			}
+
+			head += static_cast<size_t>(skip);
+			skip = 0;
+
+			size_t size = std::min(remaining, block.size() - head);
+			data.insert(data.end(), block.begin() + head, block.begin() + head + size);
+			remaining -= size;
+			head = 0;
+
+			if (remaining == 0)
+				break;
+		}
+	}
+
+	ssize_t written = session->write(data.data(), data.size(), kWriteWait);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (transfer->state > State::Committed || written == 0)
+		return false;
+
+	if (written < 0)
+	{
+		// 连接异常，回退到确认偏移，等待会话恢复
+		transfer->paused = true;
+		transfer->dirty = true;
+		rewindLocked(*transfer);
+		return false;
+	}
+
+	size_t advance = static_cast<size_t>(written);
+	transfer->written += advance;
+	transfer->lastActivity = Clock::now();
+	_bytesWritten += advance;
+
+	// 不要求确认时写出即释放
+	if (!_options.ackRequired)
+		discardLocked(*transfer, transfer->written);
+
+	return true;
+}
+
+Json::Value TransferManager::progressLocked(Transfer& transfer, Clock::time_point now)
+{
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - transfer.lastProgress);
+	auto total = std::chrono::duration_cast<std::chrono::milliseconds>(now - transfer.started);
+
+	// 状态变化触发的发布间隔很短，不更新速率
+	if (elapsed.count() >= 100)
+	{
+		transfer.bytesPerSec = (transfer.written - transfer.lastProgressWritten) * 1000 /
+							   static_cast<uint64_t>(elapsed.count());
+		transfer.lastProgress = now;
+		transfer.lastProgressWritten = transfer.written;
+	}
+
+	transfer.dirty = false;
+
+	uint64_t buffered = transfer.received - transfer.bufferStart;
+
+	Json::Value root;
+	root["transferId"] = transfer.id;
+	root["address"] = transfer.address;
+	root["state"] = stateName(transfer.state);
+	root["size"] = static_cast<Json::UInt64>(transfer.size);
+	root["received"] = static_cast<Json::UInt64>(transfer.received);
+	root["written"] = static_cast<Json::UInt64>(transfer.written);
+	root["acked"] = static_cast<Json::UInt64>(transfer.acked);
+	root["window"] = static_cast<Json::UInt64>(
+		buffered < _options.windowBytes ? _options.windowBytes - buffered : 0);
+	root["paused"] = transfer.paused;
+	root["bytesPerSec"] = static_cast<Json::UInt64>(transfer.bytesPerSec);
+	root["avgBytesPerSec"] = static_cast<Json::UInt64>(
+		total.count() > 0 ? transfer.written * 1000 / static_cast<uint64_t>(total.count()) : 0);
+	root["elapsedMs"] = static_cast<Json::Int64>(total.count());
+
+	if (!transfer.message.empty())
+		root["message"] = transfer.message;
+
+	return root;
+}
+
+void TransferManager::finishLocked(Transfer& transfer, State state, const std::string& message)
+{
+	if (transfer.state > State::Committed)
+		return;
+
+	transfer.state = state;
+	transfer.message = message;
+	transfer.pending.clear();
+	transfer.pendingHead = 0;
+	transfer.held.clear();
+	transfer.dirty = true;
+
+	if (state == State::Completed)
+	{
+		++_completed;
+		LOG_INFO("{} 分片传输 {} 完成({} bytes)", transfer.address, transfer.id, transfer.written);
+	}
+	else
+	{
+		if (state == State::Failed)
+			++_failed;
+
+		LOG_WARN("{} 分片传输 {} 结束于偏移 {} - {}",
+				 transfer.address,
+				 transfer.id,
+				 transfer.written,
+				 message);
+	}
+}
+
+void TransferManager::appendHeldLocked(Transfer& transfer)
+{
+	while (!transfer.held.empty() && transfer.held.begin()->first <= transfer.received)
+	{
+		auto it = transfer.held.begin();
+		uint64_t skip = transfer.received - it->first;
+
+		// 暂存时已检查大小和窗口，与已接收部分重叠的只取其后的数据
+		if (skip < it->second.size())
+		{
+			transfer.pending.emplace_back(it->second.begin() + static_cast<std::ptrdiff_t>(skip),
+										  it->second.end());
+			transfer.received += it->second.size() - skip;
+		}
+
+		transfer.held.erase(it);
+	}
+
+	if (transfer.commitPending && transfer.state == State::Receiving &&
+		transfer.received == transfer.size)
+	{
+		transfer.state = State::Committed;
+		transfer.dirty = true;
+	}
+}
+
+void TransferManager::discardLocked(Transfer& transfer, uint64_t offset)
+{
+	while (transfer.bufferStart < offset && !transfer.pending.empty())
+	{
+		std::vector<uint8_t>& front = transfer.pending.front();
+		size_t size = static_cast<size_t>(
+			std::min<uint64_t>(offset - transfer.bufferStart, front.size() - transfer.pendingHead));
+
+		transfer.pendingHead += size;
+		transfer.bufferStart += size;
+
+		if (transfer.pendingHead == front.size())
+		{
+			transfer.pending.pop_front();
+			transfer.pendingHead = 0;
+		}
+	}
+}
+
+void TransferManager::rewindLocked(Transfer& transfer)
+{
+	// 断开时套接字缓冲区和写出队列中的数据被丢弃，已写出不代表设备已收到
+	if (_options.ackRequired)
+	{
+		// 确认偏移之后的数据仍在缓冲区中，恢复后重新写出
+		transfer.written = transfer.acked;
+
+		LOG_WARN("{} 设备未连接，分片传输 {} 暂停，恢复后从确认偏移 {} 重新写出",
+				 transfer.address,
+				 transfer.id,
+				 transfer.acked);
+	}
+	else
+	{
+		// 未确认的数据已释放，须由上位机从确认偏移重新发送
+		if (transfer.received > transfer.acked)
+		{
+			transfer.message = "设备断开，须从偏移 " + std::to_string(transfer.acked) + " 重新发送";
+
+			// 已提交的传输在重新接收完成后自动提交
+			if (transfer.state == State::Committed)
+				transfer.state = State::Receiving;
+		}
+
+		transfer.pending.clear();
+		transfer.pendingHead = 0;
+		transfer.received = transfer.acked;
+		transfer.written = transfer.acked;
+		transfer.bufferStart = transfer.acked;
+
+		LOG_WARN("{} 设备未连接，分片传输 {} 回退到确认偏移 {}，等待重新发送",
+				 transfer.address,
+				 transfer.id,
+				 transfer.acked);
+	}
+
+	transfer.lastProgressWritten = std::min(transfer.lastProgressWritten, transfer.written);
+}
+
+const char* TransferManager::stateName(State state)
+{
+	switch (state)
+	{
+	case State::Receiving:
+		return "receiving";
+	case State::Committed:
+		return "committed";
+	case State::Completed:
+		return "completed";
+	case State::Failed:
+		return "failed";
+	case State::Aborted:
+		return "aborted";
+	}
+
+	return "unknown";
+}
@@ -0,0 +1,150 @@
+#ifndef MQTT_TRANSFER_MANAGER_H_
+#define MQTT_TRANSFER_MANAGER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <json/json.h>
+
+#include <defines.h>
+#include <bluetooth/rfcomm/session.h>
+
+// 大块数据(如固件镜像)分片下发
+//
+// 上位机以 begin/chunk/commit 分片发送，分片按偏移连续追加到传输的缓冲区，由发送线程
+// 按连接可写情况写出；缓冲区上限(窗口)之外的分片被拒绝，上位机按进度中的 received 续传。
+// 分片可能乱序到达，窗口内先到的后续分片暂存到前面的分片到达，提交在全部接收后生效。
+//
+// 写出到连接只表示进入了套接字缓冲区，断开时这部分数据可能丢失。只有设备确认的偏移
+// (acked，由上位机根据设备应答以 ack 上报)是可靠的：设备断开时传输暂停并回退到该偏移。
+// ackRequired 时已写出未确认的数据保留在缓冲区中，会话恢复后从确认偏移重新写出；
+// 否则写出即释放，断开时已接收的偏移也回退到确认偏移，由上位机从 received 重新发送。
+class CORE_API TransferManager
+{
+public:
+	using Clock = std::chrono::steady_clock;
+	using SessionLookup = std::function<std::shared_ptr<Session>(const std::string&)>;
+	using ProgressCallback = std::function<void(const Json::Value&)>;
+
+	struct Options
+	{
+		size_t windowBytes = 256 * 1024;				// 每个传输已接收未写出的最大字节数
+		size_t writeBytes = 4096;						// 单次写入连接的最大字节数
+		size_t maxTransfers = 8;						// 同时进行的传输数
+		std::chrono::milliseconds progressInterval{ 1000 }; // 进度发布间隔
+		std::chrono::seconds idleTimeout{ 120 };		// 无分片且无写出超过该时间时失败
+		bool ackRequired = false;						// 保留未确认的数据，全部确认后才完成
+	};
+
+	TransferManager(const Options& options, SessionLookup lookup, ProgressCallback progress);
+
+	~TransferManager();
+
+	TransferManager(const TransferManager&) = delete;
+	TransferManager& operator=(const TransferManager&) = delete;
+
+	// 以下失败时返回 false 并设置 error
+
+	// 开始传输；id 已存在且地址、大小一致时视为续传，立即发布当前进度
+	bool begin(const std::string& id, const std::string& address, uint64_t size, std::string& error);
+
+	// 追加 offset 处的分片，已接收部分自动跳过；offset 之前仍有缺口时在窗口内暂存
+	bool chunk(const std::string& id, uint64_t offset, const std::string& data, std::string& error);
+
+	// 全部分片已发送，写出完成后结束；尚未全部接收时在接收完成后生效
+	bool commit(const std::string& id, std::string& error);
+
+	// 设备已确认收到 offset 之前的数据
+	bool ack(const std::string& id, uint64_t offset, std::string& error);
+
+	bool abort(const std::string& id, std::string& error);
+
+	// 设备会话已建立，继续写出该设备暂停的传输
+	void resume(const std::string& address);
+
+	Json::Value getStats() const;
+
+private:
+	enum class State
+	{
+		Receiving,
+		Committed,
+		Completed,
+		Failed,
+		Aborted
+	};
+
+	struct Transfer
+	{
+		std::string id;
+		std::string address;
+		uint64_t size = 0;
+		uint64_t received = 0; // 已接收的连续字节数
+		uint64_t written = 0;  // 已写出到连接的字节数
+		uint64_t acked = 0;	   // 设备已确认的字节数
+		std::deque<std::vector<uint8_t>> pending; // 偏移 bufferStart 到 received 的数据
+		size_t pendingHead = 0;	  // pending 首块中已释放的字节数
+		uint64_t bufferStart = 0; // 缓冲区中第一个字节的偏移
+		std::map<uint64_t, std::string> held; // received 之后先到的分片，按偏移排列
+		bool commitPending = false;			  // 已收到提交，接收完成后转为 Committed
+		State state = State::Receiving;
+		bool paused = false;
+		std::string message;
+
+		Clock::time_point started;
+		Clock::time_point lastActivity;
+		Clock::time_point lastProgress;
+		uint64_t lastProgressWritten = 0;
+		uint64_t bytesPerSec = 0;
+		bool dirty = true; // 状态变化，需立即发布进度
+	};
+
+	void run();
+
+	// 写出一次，返回是否有进展；调用方不持有锁
+	bool writeSome(const std::shared_ptr<Transfer>& transfer);
+
+	// 以下调用方持有锁
+	Json::Value progressLocked(Transfer& transfer, Clock::time_point now);
+	void finishLocked(Transfer& transfer, State state, const std::string& message);
+
+	// 把与 received 相接的暂存分片追加到缓冲区，全部接收且已请求提交时提交
+	void appendHeldLocked(Transfer& transfer);
+
+	// 释放 offset 之前的数据
+	void discardLocked(Transfer& transfer, uint64_t offset);
+
+	// 连接断开，回退到设备确认的偏移
+	void rewindLocked(Transfer& transfer);
+
+	static const char* stateName(State state);
+
+private:
+	Options _options;
+	SessionLookup _lookup;
+	ProgressCallback _progress;
+
+	mutable std::mutex _mutex;
+	std::condition_variable _cv;
+	std::unordered_map<std::string, std::shared_ptr<Transfer>> _transfers;
+	bool _stopping;
+	bool _signaled; // 有新数据或状态变化，唤醒发送线程
+
+	uint64_t _completed;
+	uint64_t _failed;
+	uint64_t _bytesWritten;
+
+	std::thread _thread;
+};
+
+#endif // MQTT_TRANSFER_MANAGER_H_
@@ -0,0 +1,325 @@
+#include <mqtt/uplink_encoder.h>
+#include <utils/logger.h>
+#include <utils/spsc_ring.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+struct UplinkEncoder::Channel
+{
+	struct Item
+	{
+		Frame frame;
+		Clock::time_point enqueued;
+	};
+
+	Channel(const std::string& addr, size_t capacity, Worker* owner, const BatchOptions& options)
+		: address(addr), ring(capacity), worker(owner), closed(false), batch(options)
+	{
+	}
+
+	std::string address;
+	SpscRing<Item> ring;
+	Worker* worker;
+	std::atomic<bool> closed; // 生产者线程已退出
+	const BatchOptions batch;
+
+	// 以下仅由编码线程访问
+	std::vector<Frame> frames; // 聚合中的帧
+	size_t bytes = 0;
+	Clock::time_point deadline;
+};
+
+struct UplinkEncoder::Worker
+{
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::atomic<bool> sleeping{ false };
+
+	// 由 mutex 保护
+	bool signaled = false;
+	std::vector<std::shared_ptr<Channel>> channels;
+	std::vector<std::shared_ptr<Channel>> pending;
+};
+
+namespace {
+
+	std::atomic<uint64_t> nextEncoderId{ 1 };
+
+	// 读线程的队列缓存，一个读线程只服务一条连接
+	struct ProducerCache
+	{
+		uint64_t owner = 0;
+		std::string address;
+		std::shared_ptr<UplinkEncoder::Channel> channel;
+
+		void reset()
+		{
+			if (channel)
+				channel->closed = true;
+
+			channel.reset();
+		}
+
+		~ProducerCache() { reset(); }
+	};
+
+	thread_local ProducerCache producerCache;
+
+	// 每轮每条队列最多处理的帧数，避免单个设备占满编码线程
+	constexpr size_t kBatchPerChannel = 64;
+
+	// 无数据时的最长休眠时间
+	constexpr std::chrono::milliseconds kIdleWait(10);
+}
+
+UplinkEncoder::UplinkEncoder(const Options& options, EncodeCallback encode, BatchPolicy batchPolicy)
+	: _options(options),
+	  _encode(std::move(encode)),
+	  _batchPolicy(std::move(batchPolicy)),
+	  _id(nextEncoderId++),
+	  _running(true),
+	  _encoded(0),
+	  _messages(0),
+	  _waitTotalUs(0),
+	  _waitMaxUs(0),
+	  _maxOccupancy(0),
+	  _producerStalls(0)
+{
+	if (_options.workers == 0)
+		_options.workers = 1;
+
+	for (size_t i = 0; i < _options.workers; ++i)
+		_workers.push_back(std::make_unique<Worker>());
+
+	for (auto& worker : _workers)
+		worker->thread = std::thread(&UplinkEncoder::workerLoop, this, std::ref(*worker));
+}
+
+UplinkEncoder::~UplinkEncoder()
+{
+	_running = false;
+
+	for (auto& worker : _workers)
+	{
+		wake(*worker);
+
+		if (worker->thread.joinable())
+			worker->thread.join();
+	}
+}
+
+void UplinkEncoder::push(const std::string& address, BufferSlice frame)
+{
+	std::shared_ptr<Channel> channel = channelFor(address);
+
+	Channel::Item item{ { std::move(frame), std::chrono::system_clock::now() }, Clock::now() };
+	bool stalled = false;
+
+	while (!channel->ring.tryPush(std::move(item)))
+	{
+		if (!_running)
+			return;
+
+		if (!stalled)
+		{
+			++_producerStalls;
+			stalled = true;
+		}
+
+		wake(*channel->worker);
+		std::this_thread::sleep_for(std::chrono::microseconds(200));
+	}
+
+	updateMax(_maxOccupancy, channel->ring.size());
+
+	// 与编码线程的 sleeping 标记配对，避免丢失唤醒
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (channel->worker->sleeping.load(std::memory_order_relaxed))
+		wake(*channel->worker);
+}
+
+std::shared_ptr<UplinkEncoder::Channel> UplinkEncoder::channelFor(const std::string& address)
+{
+	ProducerCache& cache = producerCache;
+
+	if (cache.channel && cache.owner == _id && cache.address == address)
+		return cache.channel;
+
+	cache.reset();
+
+	Worker& worker = *_workers[std::hash<std::string>()(address) % _workers.size()];
+	BatchOptions batch = _batchPolicy ? _batchPolicy(address) : BatchOptions();
+	auto channel = std::make_shared<Channel>(address, _options.ringCapacity, &worker, batch);
+
+	{
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.pending.push_back(channel);
+	}
+
+	cache.owner = _id;
+	cache.address = address;
+	cache.channel = channel;
+
+	return channel;
+}
+
+void UplinkEncoder::workerLoop(Worker& worker)
+{
+	std::vector<std::shared_ptr<Channel>> channels;
+
+	while (true)
+	{
+		// 接收新建的队列，移除生产者已退出且已取空的队列
+		{
+			std::lock_guard<std::mutex> lock(worker.mutex);
+
+			for (auto& channel : worker.pending)
+				worker.channels.push_back(std::move(channel));
+
+			worker.pending.clear();
+
+			auto& list = worker.channels;
+			list.erase(std::remove_if(list.begin(),
+									  list.end(),
+									  [](const std::shared_ptr<Channel>& c) {
+										  return c->closed && c->ring.empty() && c->frames.empty();
+									  }),
+					   list.end());
+
+			channels = list;
+		}
+
+		size_t processed = 0;
+		Clock::time_point nextDeadline = Clock::now() + kIdleWait;
+		Channel::Item item;
+
+		for (auto& channel : channels)
+		{
+			const BatchOptions& batch = channel->batch;
+
+			for (size_t n = 0; n < kBatchPerChannel && channel->ring.tryPop(item); ++n)
+			{
+				auto wait = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+																				  item.enqueued);
+				uint64_t waitUs = static_cast<uint64_t>(wait.count());
+
+				_waitTotalUs += waitUs;
+				updateMax(_waitMaxUs, waitUs);
+
+				// 窗口从第一帧入队时开始计时
+				if (channel->frames.empty())
+					channel->deadline = item.enqueued + batch.maxDelay;
+
+				channel->bytes += item.frame.data.size();
+				channel->frames.push_back(std::move(item.frame));
+				item.frame = Frame();
+
+				if (batch.maxDelay.count() == 0 || channel->bytes >= batch.maxBytes)
+					flush(*channel);
+
+				++processed;
+			}
+
+			if (channel->frames.empty())
+				continue;
+
+			// 窗口到期、生产者已退出或正在停止时发布剩余帧
+			if (Clock::now() >= channel->deadline || channel->closed || !_running)
+				flush(*channel);
+			else
+				nextDeadline = std::min(nextDeadline, channel->deadline);
+		}
+
+		if (processed > 0)
+			continue;
+
+		if (!_running)
+			break;
+
+		// 无数据时休眠到最近的窗口到期，置位后重新检查一次队列
+		worker.sleeping = true;
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		bool idle = std::all_of(channels.begin(),
+								channels.end(),
+								[](const std::shared_ptr<Channel>& c) { return c->ring.empty(); });
+
+		if (idle)
+		{
+			std::unique_lock<std::mutex> lock(worker.mutex);
+			worker.cv.wait_until(lock, nextDeadline, [&worker, this]() {
+				return worker.signaled || !worker.pending.empty() || !_running;
+			});
+
+			worker.signaled = false;
+		}
+
+		worker.sleeping = false;
+	}
+}
+
+void UplinkEncoder::flush(Channel& channel)
+{
+	_encode(channel.address, channel.frames, channel.batch);
+
+	_encoded += channel.frames.size();
+	++_messages;
+
+	channel.frames.clear();
+	channel.bytes = 0;
+}
+
+void UplinkEncoder::wake(Worker& worker)
+{
+	{
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.signaled = true;
+	}
+
+	worker.cv.notify_one();
+}
+
+void UplinkEncoder::updateMax(std::atomic<uint64_t>& target, uint64_t value)
+{
+	uint64_t current = target.load(std::memory_order_relaxed);
+	while (value > current && !target.compare_exchange_weak(current, value))
+	{
+	}
+}
+
+Json::Value UplinkEncoder::getStats() const
+{
+	uint64_t queued = 0;
+	uint64_t channels = 0;
+
+	for (const auto& worker : _workers)
+	{
+		std::lock_guard<std::mutex> lock(worker->mutex);
+
+		for (const auto& channel : worker->channels)
+			queued += channel->ring.size();
+
+		for (const auto& channel : worker->pending)
+			queued += channel->ring.size();
+
+		channels += worker->channels.size() + worker->pending.size();
+	}
+
+	uint64_t encoded = _encoded.load();
+
+	Json::Value root;
+	root["workers"] = static_cast<Json::UInt64>(_workers.size());
+	root["channels"] = static_cast<Json::UInt64>(channels);
+	root["queued"] = static_cast<Json::UInt64>(queued);
+	root["maxOccupancy"] = static_cast<Json::UInt64>(_maxOccupancy.load());
+	root["encoded"] = static_cast<Json::UInt64>(encoded);
+	root["messages"] = static_cast<Json::UInt64>(_messages.load());
+	root["waitAvgUs"] = static_cast<Json::UInt64>(encoded ? _waitTotalUs.load() / encoded : 0);
+	root["waitMaxUs"] = static_cast<Json::UInt64>(_waitMaxUs.load());
+	root["producerStalls"] = static_cast<Json::UInt64>(_producerStalls.load());
+	return root;
+}
@@ -0,0 +1,100 @@
+#ifndef MQTT_UPLINK_ENCODER_H_
+#define MQTT_UPLINK_ENCODER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <json/json.h>
+
+#include <defines.h>
+#include <utils/buffer_pool.h>
+
+// 上行编码阶段：RFCOMM 读线程只负责把帧放入自己的单生产者环形队列，
+// 由编码线程池完成 UUID、时间、base64、JSON 和发布，读线程随即回到 recv。
+//
+// 每个读线程(即每条连接)拥有独立队列，队列按设备地址固定分配给一个编码线程，
+// 同一设备的帧按接收顺序编码。
+//
+// 可按设备开启聚合：窗口内(maxDelay)到达的帧累积到 maxBytes 或窗口到期后一次回调，
+// 以少量延迟换取更少的 MQTT 消息。
+class CORE_API UplinkEncoder
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	struct Frame
+	{
+		BufferSlice data;
+		std::chrono::system_clock::time_point received; // 读线程交出该帧的时间
+	};
+
+	struct BatchOptions
+	{
+		std::chrono::milliseconds maxDelay{ 0 }; // 聚合窗口，0 表示逐帧发布
+		size_t maxBytes = 16384;				  // 累积数据达到该值时立即发布
+		bool concat = false;					  // 拼接为一段数据，否则以帧数组发布
+	};
+
+	// frames 至少包含一帧，按接收顺序排列
+	using EncodeCallback = std::function<
+		void(const std::string&, const std::vector<Frame>&, const BatchOptions&)>;
+
+	// 按设备地址返回聚合策略，在该连接首次入队时调用
+	using BatchPolicy = std::function<BatchOptions(const std::string&)>;
+
+	struct Options
+	{
+		size_t workers = 2;		   // 编码线程数
+		size_t ringCapacity = 1024; // 每条连接的队列容量(帧)
+	};
+
+	struct Channel;
+	struct Worker;
+
+	UplinkEncoder(const Options& options, EncodeCallback encode, BatchPolicy batchPolicy = nullptr);
+
+	~UplinkEncoder();
+
+	UplinkEncoder(const UplinkEncoder&) = delete;
+	UplinkEncoder& operator=(const UplinkEncoder&) = delete;
+
+	// 读线程调用，队列满时等待编码线程腾出空间
+	void push(const std::string& address, BufferSlice frame);
+
+	// 队列占用、排队等待时间等统计
+	Json::Value getStats() const;
+
+private:
+	std::shared_ptr<Channel> channelFor(const std::string& address);
+
+	void workerLoop(Worker& worker);
+
+	// 发布聚合中的帧
+	void flush(Channel& channel);
+
+	static void wake(Worker& worker);
+
+	static void updateMax(std::atomic<uint64_t>& target, uint64_t value);
+
+private:
+	Options _options;
+	EncodeCallback _encode;
+	BatchPolicy _batchPolicy;
+	uint64_t _id;
+	std::atomic<bool> _running;
+	std::vector<std::unique_ptr<Worker>> _workers;
+
+	std::atomic<uint64_t> _encoded;
+	std::atomic<uint64_t> _messages;
+	std::atomic<uint64_t> _waitTotalUs;
+	std::atomic<uint64_t> _waitMaxUs;
+	std::atomic<uint64_t> _maxOccupancy;
+	std::atomic<uint64_t> _producerStalls;
+};
+
+#endif // MQTT_UPLINK_ENCODER_H_
@@ -0,0 +1,171 @@
+#include <mqtt/uplink_replay.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+UplinkReplay::UplinkReplay() : _replayed(0), _misses(0) {}
+
+void UplinkReplay::setOptions(const Options& options)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_options = options;
+}
+
+void UplinkReplay::reset(const std::string& address)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	Stream& stream = _streams[address];
+	uint64_t previous = stream.id;
+
+	// 以会话建立时间(毫秒)作为 stream，同一毫秒内重连时递增，保证不重复
+	uint64_t now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+											 std::chrono::system_clock::now().time_since_epoch())
+											 .count());
+
+	stream.id = std::max(now, previous + 1);
+	stream.next = 1;
+	stream.ring.clear();
+	stream.bytes = 0;
+}
+
+UplinkReplay::Stamp UplinkReplay::next(const std::string& address)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	Stream& stream = streamLocked(address);
+	return Stamp{ stream.id, stream.next++ };
+}
+
+void UplinkReplay::store(const std::string& address,
+						 const Stamp& stamp,
+						 const Buffer& payload,
+						 const PublishProperties& properties)
+{
+	size_t size = payload.size();
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (_options.maxMessages == 0)
+		return;
+
+	Stream& stream = streamLocked(address);
+
+	// 会话已更换，旧会话的消息不再缓存
+	if (stream.id != stamp.stream)
+		return;
+
+	// 缓存中的序号须连续，放不下的消息清空缓存
+	if (size > _options.maxBytes)
+	{
+		stream.ring.clear();
+		stream.bytes = 0;
+		return;
+	}
+
+	while (!stream.ring.empty() &&
+		   (stream.ring.size() >= _options.maxMessages || stream.bytes + size > _options.maxBytes))
+	{
+		stream.bytes -= stream.ring.front().message.payload.size();
+		stream.ring.pop_front();
+	}
+
+	Buffer copy = Buffer::allocate(size);
+	std::memcpy(copy.data(), payload.data(), size);
+	copy.resize(size);
+
+	stream.ring.push_back({ stamp.seq, { std::move(copy), properties } });
+	stream.bytes += size;
+}
+
+size_t UplinkReplay::collect(const std::string& address,
+							 uint64_t stream,
+							 uint64_t from,
+							 uint64_t to,
+							 std::vector<Message>& out,
+							 uint64_t& first,
+							 uint64_t& last)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	first = 0;
+	last = 0;
+
+	auto it = _streams.find(address);
+	if (it == _streams.end() || it->second.id != stream)
+		return 0;
+
+	const Stream& s = it->second;
+
+	if (!s.ring.empty())
+	{
+		first = s.ring.front().seq;
+		last = s.ring.back().seq;
+	}
+
+	if (to == 0 || to >= s.next)
+		to = s.next - 1;
+
+	if (from == 0)
+		from = 1;
+
+	if (from > to)
+		return 0;
+
+	size_t count = 0;
+
+	// 序号连续，按偏移直接定位
+	if (!s.ring.empty() && to >= first && from <= last)
+	{
+		uint64_t begin = std::max(from, first);
+		uint64_t end = std::min(to, last);
+
+		for (uint64_t seq = begin; seq <= end; ++seq)
+			out.push_back(s.ring[static_cast<size_t>(seq - first)].message);
+
+		count = static_cast<size_t>(end - begin + 1);
+	}
+
+	_replayed += count;
+	_misses += (to - from + 1) - count;
+
+	return count;
+}
+
+Json::Value UplinkReplay::getStats() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	uint64_t messages = 0;
+	uint64_t bytes = 0;
+
+	for (const auto& [address, stream] : _streams)
+	{
+		messages += stream.ring.size();
+		bytes += stream.bytes;
+	}
+
+	Json::Value root;
+	root["devices"] = static_cast<Json::UInt64>(_streams.size());
+	root["cachedMessages"] = static_cast<Json::UInt64>(messages);
+	root["cachedBytes"] = static_cast<Json::UInt64>(bytes);
+	root["replayed"] = static_cast<Json::UInt64>(_replayed);
+	root["misses"] = static_cast<Json::UInt64>(_misses);
+	return root;
+}
+
+UplinkReplay::Stream& UplinkReplay::streamLocked(const std::string& address)
+{
+	Stream& stream = _streams[address];
+
+	// 会话建立前已有上行数据
+	if (stream.id == 0)
+	{
+		stream.id = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+											  std::chrono::system_clock::now().time_since_epoch())
+											  .count());
+	}
+
+	return stream;
+}
@@ -0,0 +1,99 @@
+#ifndef MQTT_UPLINK_REPLAY_H_
+#define MQTT_UPLINK_REPLAY_H_
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <json/json.h>
+
+#include <defines.h>
+#include <mqtt/publish_properties.h>
+#include <utils/buffer_pool.h>
+
+// 上行消息序号与重放缓存
+//
+// 每个设备会话的 receiveFromDevice 消息带 stream(会话标识)和从 1 递增的 seq，消费端以
+// QoS 0 接收并据此发现丢失；最近的消息按设备保存在有界的环形缓存中，可按序号范围重放。
+class CORE_API UplinkReplay
+{
+public:
+	struct Options
+	{
+		size_t maxMessages = 256;	   // 每个设备缓存的消息数，0 表示不缓存
+		size_t maxBytes = 256 * 1024; // 每个设备缓存的字节数
+	};
+
+	struct Stamp
+	{
+		uint64_t stream;
+		uint64_t seq;
+	};
+
+	// 缓存的消息，v5 精简封装时 stream/seq 等在属性中
+	struct Message
+	{
+		Buffer payload;
+		PublishProperties properties;
+	};
+
+	UplinkReplay();
+
+	void setOptions(const Options& options);
+
+	// 设备会话建立：更换 stream，序号从 1 重新开始，丢弃上一会话的缓存
+	void reset(const std::string& address);
+
+	// 分配下一条消息的序号，同一设备须由同一线程按发布顺序调用
+	Stamp next(const std::string& address);
+
+	// 缓存已编码的消息，复制到堆上，不占用缓冲池
+	void store(const std::string& address,
+			   const Stamp& stamp,
+			   const Buffer& payload,
+			   const PublishProperties& properties = PublishProperties());
+
+	// 取 stream 中序号在 [from, to] 内仍在缓存的消息(to 为 0 表示到最新)；
+	// first/last 为当前缓存的序号范围，无缓存或 stream 不匹配时为 0
+	size_t collect(const std::string& address,
+				   uint64_t stream,
+				   uint64_t from,
+				   uint64_t to,
+				   std::vector<Message>& out,
+				   uint64_t& first,
+				   uint64_t& last);
+
+	Json::Value getStats() const;
+
+private:
+	struct Entry
+	{
+		uint64_t seq;
+		Message message;
+	};
+
+	struct Stream
+	{
+		uint64_t id = 0;
+		uint64_t next = 1;
+		std::deque<Entry> ring;
+		size_t bytes = 0;
+	};
+
+	// 调用方持有锁
+	Stream& streamLocked(const std::string& address);
+
+private:
+	Options _options;
+
+	mutable std::mutex _mutex;
+	std::unordered_map<std::string, Stream> _streams;
+
+	uint64_t _replayed; // 重放的消息数
+	uint64_t _misses;	// 请求范围已不在缓存中的消息数
+};
+
+#endif // MQTT_UPLINK_REPLAY_H_
@@ -147,6 +147,43 @@ std::string base64_encode(unsigned char const* bytes_to_encode, size_t in_len, b
 	return ret;
 }
 
+size_t base64_encode_to(unsigned char const* bytes_to_encode, size_t in_len, char* out, bool url)
+{
+	const char* base64_chars_ = base64_chars[url];
+	const char trailing_char = url ? '.' : '=';
+
+	char* p = out;
+	size_t pos = 0;
+
+	for (; pos + 2 < in_len; pos += 3)
+	{
+		*p++ = base64_chars_[(bytes_to_encode[pos + 0] & 0xfc) >> 2];
+		*p++ = base64_chars_[((bytes_to_encode[pos + 0] & 0x03) << 4) +
+							 ((bytes_to_encode[pos + 1] & 0xf0) >> 4)];
+		*p++ = base64_chars_[((bytes_to_encode[pos + 1] & 0x0f) << 2) +
+							 ((bytes_to_encode[pos + 2] & 0xc0) >> 6)];
+		*p++ = base64_chars_[bytes_to_encode[pos + 2] & 0x3f];
+	}
+
+	if (pos + 1 == in_len)
+	{
+		*p++ = base64_chars_[(bytes_to_encode[pos + 0] & 0xfc) >> 2];
+		*p++ = base64_chars_[(bytes_to_encode[pos + 0] & 0x03) << 4];
+		*p++ = trailing_char;
+		*p++ = trailing_char;
+	}
+	else if (pos + 2 == in_len)
+	{
+		*p++ = base64_chars_[(bytes_to_encode[pos + 0] & 0xfc) >> 2];
+		*p++ = base64_chars_[((bytes_to_encode[pos + 0] & 0x03) << 4) +
+							 ((bytes_to_encode[pos + 1] & 0xf0) >> 4)];
+		*p++ = base64_chars_[(bytes_to_encode[pos + 1] & 0x0f) << 2];
+		*p++ = trailing_char;
+	}
+
+	return static_cast<size_t>(p - out);
+}
+
 template <typename String>
 static std::string decode(String const& encoded_string, bool remove_linebreaks)
 {
@@ -14,6 +14,9 @@ std::string base64_encode_mime(std::string const& s);
 std::string base64_decode(std::string const& s, bool remove_linebreaks = false);
 std::string base64_encode(unsigned char const*, size_t len, bool url = false);
 
+// 编码到调用方提供的缓冲区(至少 (len + 2) / 3 * 4 字节)，返回写入的字节数
+size_t base64_encode_to(unsigned char const*, size_t len, char* out, bool url = false);
+
 #if __cplusplus >= 201703L
 //
 // Interface with std::string_view rather than const std::string&
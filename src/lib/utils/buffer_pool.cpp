@@ -0,0 +1,160 @@
+#include <utils/buffer_pool.h>
+
+#include <algorithm>
+#include <new>
+
+Buffer::Buffer(const Buffer& other) : _block(other._block)
+{
+	if (_block)
+		_block->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+Buffer Buffer::allocate(size_t capacity)
+{
+	void* memory = ::operator new(sizeof(Block) + capacity);
+
+	Block* block = new (memory) Block;
+	block->refs.store(1, std::memory_order_relaxed);
+	block->capacity = static_cast<uint32_t>(capacity);
+	block->size = 0;
+	block->pool = nullptr;
+	block->next = nullptr;
+
+	return Buffer(block);
+}
+
+void Buffer::reset()
+{
+	if (!_block)
+		return;
+
+	Block* block = _block;
+	_block = nullptr;
+
+	if (block->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		return;
+
+	if (block->pool)
+	{
+		block->pool->release(block);
+	}
+	else
+	{
+		block->~Block();
+		::operator delete(block);
+	}
+}
+
+void Buffer::resize(size_t size)
+{
+	if (_block)
+		_block->size = static_cast<uint32_t>(std::min<size_t>(size, _block->capacity));
+}
+
+BufferPool::BufferPool(size_t blockSize, size_t blocksPerSlab, size_t maxBlocks)
+	: _blockSize(std::max<size_t>(blockSize, 64)),
+	  _blocksPerSlab(std::max<size_t>(blocksPerSlab, 1)),
+	  _maxBlocks(maxBlocks),
+	  _free(nullptr),
+	  _blocks(0),
+	  _freeCount(0),
+	  _oversize(0),
+	  _exhausted(0)
+{
+	// 块头之后紧跟数据区，按块头对齐
+	const size_t align = alignof(Buffer::Block);
+	_blockStride = (sizeof(Buffer::Block) + _blockSize + align - 1) / align * align;
+}
+
+BufferPool::~BufferPool()
+{
+	// slab 内存随 _slabs 释放，块头均为平凡析构
+}
+
+Buffer BufferPool::acquire(size_t size)
+{
+	if (size > _blockSize)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		++_oversize;
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if (_free || grow())
+		{
+			Buffer::Block* block = _free;
+			_free = block->next;
+			--_freeCount;
+
+			block->refs.store(1, std::memory_order_relaxed);
+			block->size = 0;
+			block->next = nullptr;
+
+			return Buffer(block);
+		}
+
+		++_exhausted;
+	}
+
+	return Buffer::allocate(std::max(size, _blockSize));
+}
+
+Json::Value BufferPool::getStats() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	Json::Value stats;
+	stats["blockSize"] = static_cast<Json::UInt64>(_blockSize);
+	stats["blocks"] = static_cast<Json::UInt64>(_blocks);
+	stats["free"] = static_cast<Json::UInt64>(_freeCount);
+	stats["oversize"] = static_cast<Json::UInt64>(_oversize);
+	stats["exhausted"] = static_cast<Json::UInt64>(_exhausted);
+	return stats;
+}
+
+void BufferPool::release(Buffer::Block* block)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	block->next = _free;
+	_free = block;
+	++_freeCount;
+}
+
+bool BufferPool::grow()
+{
+	if (_maxBlocks > 0 && _blocks >= _maxBlocks)
+		return false;
+
+	size_t count = _blocksPerSlab;
+	if (_maxBlocks > 0)
+		count = std::min(count, _maxBlocks - _blocks);
+
+	std::unique_ptr<uint8_t[]> slab(new (std::nothrow) uint8_t[_blockStride * count + alignof(Buffer::Block)]);
+	if (!slab)
+		return false;
+
+	// new[] 只保证基本对齐，手动对齐到块头
+	uintptr_t base = reinterpret_cast<uintptr_t>(slab.get());
+	const uintptr_t align = alignof(Buffer::Block);
+	base = (base + align - 1) / align * align;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		auto* block = new (reinterpret_cast<void*>(base + i * _blockStride)) Buffer::Block;
+		block->refs.store(0, std::memory_order_relaxed);
+		block->capacity = static_cast<uint32_t>(_blockSize);
+		block->size = 0;
+		block->pool = this;
+		block->next = _free;
+		_free = block;
+	}
+
+	_slabs.push_back(std::move(slab));
+	_blocks += count;
+	_freeCount += count;
+
+	return true;
+}
@@ -0,0 +1,143 @@
+#ifndef UTILS_BUFFER_POOL_H_
+#define UTILS_BUFFER_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <json/json.h>
+
+class BufferPool;
+
+// 引用计数的缓冲区句柄，最后一个句柄释放时缓冲区归还缓冲池
+class Buffer
+{
+public:
+	Buffer() : _block(nullptr) {}
+
+	Buffer(const Buffer& other);
+
+	Buffer(Buffer&& other) noexcept : _block(other._block) { other._block = nullptr; }
+
+	Buffer& operator=(Buffer other) noexcept
+	{
+		std::swap(_block, other._block);
+		return *this;
+	}
+
+	~Buffer() { reset(); }
+
+	// 不经过缓冲池直接在堆上分配
+	static Buffer allocate(size_t capacity);
+
+	void reset();
+
+	explicit operator bool() const { return _block != nullptr; }
+
+	uint8_t* data() { return _block ? payload(_block) : nullptr; }
+
+	const uint8_t* data() const { return _block ? payload(_block) : nullptr; }
+
+	size_t size() const { return _block ? _block->size : 0; }
+
+	// 设置有效数据长度，不超过容量
+	void resize(size_t size);
+
+	size_t capacity() const { return _block ? _block->capacity : 0; }
+
+	// 与释放引用时的 release 配对：读到 1 时其他线程对缓冲区的读取都已完成，可安全复用
+	uint32_t useCount() const { return _block ? _block->refs.load(std::memory_order_acquire) : 0; }
+
+private:
+	friend class BufferPool;
+
+	struct alignas(16) Block
+	{
+		std::atomic<uint32_t> refs;
+		uint32_t capacity;
+		uint32_t size;
+		BufferPool* pool; // 为空时表示堆上分配
+		Block* next;
+	};
+
+	explicit Buffer(Block* block) : _block(block) {}
+
+	static uint8_t* payload(Block* block) { return reinterpret_cast<uint8_t*>(block + 1); }
+
+	Block* _block;
+};
+
+// 缓冲区中的一段数据，持有整个缓冲区的引用
+class BufferSlice
+{
+public:
+	BufferSlice() : _offset(0), _length(0) {}
+
+	BufferSlice(Buffer buffer, size_t offset, size_t length)
+		: _buffer(std::move(buffer)), _offset(offset), _length(length)
+	{
+	}
+
+	const uint8_t* data() const { return _buffer.data() + _offset; }
+
+	size_t size() const { return _length; }
+
+	bool empty() const { return _length == 0; }
+
+	const Buffer& buffer() const { return _buffer; }
+
+private:
+	Buffer _buffer;
+	size_t _offset;
+	size_t _length;
+};
+
+// 定长缓冲区池
+//
+// 缓冲区按 slab 成批分配并在空闲链表中复用，稳定运行时收发路径不再申请堆内存。
+// 超过块大小的请求或池已达上限时退化为堆上分配。缓冲池须比所有句柄存活更久。
+class BufferPool
+{
+public:
+	explicit BufferPool(size_t blockSize = 16384, size_t blocksPerSlab = 32, size_t maxBlocks = 1024);
+
+	~BufferPool();
+
+	BufferPool(const BufferPool&) = delete;
+	BufferPool& operator=(const BufferPool&) = delete;
+
+	// 获取容量不小于 size 的缓冲区
+	Buffer acquire(size_t size);
+
+	size_t blockSize() const { return _blockSize; }
+
+	// 块数、空闲块数以及退化为堆分配的次数
+	Json::Value getStats() const;
+
+private:
+	friend class Buffer;
+
+	void release(Buffer::Block* block);
+
+	// 分配新的 slab，调用方持有锁
+	bool grow();
+
+private:
+	size_t _blockSize;
+	size_t _blockStride;
+	size_t _blocksPerSlab;
+	size_t _maxBlocks;
+
+	mutable std::mutex _mutex;
+	Buffer::Block* _free;
+	std::vector<std::unique_ptr<uint8_t[]>> _slabs;
+	size_t _blocks;
+	size_t _freeCount;
+	size_t _oversize;
+	size_t _exhausted;
+};
+
+#endif // UTILS_BUFFER_POOL_H_
@@ -0,0 +1,78 @@
+#include <utils/mapped_file.h>
+#include <utils/logger.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile() : _fd(-1), _data(nullptr), _size(0) {}
+
+MappedFile::~MappedFile() { close(); }
+
+bool MappedFile::open(const std::string& path, size_t size)
+{
+	close();
+
+	int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd < 0)
+	{
+		LOG_ERROR("打开映射文件失败 - {} - {}", path, strerror(errno));
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		LOG_ERROR("读取映射文件信息失败 - {} - {}", path, strerror(errno));
+		::close(fd);
+		return false;
+	}
+
+	if (static_cast<size_t>(st.st_size) < size && ftruncate(fd, static_cast<off_t>(size)) != 0)
+	{
+		LOG_ERROR("扩展映射文件失败 - {} - {}", path, strerror(errno));
+		::close(fd);
+		return false;
+	}
+
+	void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED)
+	{
+		LOG_ERROR("映射文件失败 - {} - {}", path, strerror(errno));
+		::close(fd);
+		return false;
+	}
+
+	_path = path;
+	_fd = fd;
+	_data = static_cast<uint8_t*>(data);
+	_size = size;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (_data)
+	{
+		msync(_data, _size, MS_SYNC);
+		munmap(_data, _size);
+		_data = nullptr;
+	}
+
+	if (_fd >= 0)
+	{
+		::close(_fd);
+		_fd = -1;
+	}
+
+	_size = 0;
+}
+
+void MappedFile::sync(bool async)
+{
+	if (_data)
+		msync(_data, _size, async ? MS_ASYNC : MS_SYNC);
+}
@@ -0,0 +1,43 @@
+#ifndef UTILS_MAPPED_FILE_H_
+#define UTILS_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 固定大小的共享内存映射文件，文件不存在或不足 size 时创建/扩展(扩展部分为 0)
+class MappedFile
+{
+public:
+	MappedFile();
+
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open(const std::string& path, size_t size);
+
+	void close();
+
+	bool isOpen() const { return _data != nullptr; }
+
+	uint8_t* data() { return _data; }
+
+	const uint8_t* data() const { return _data; }
+
+	size_t size() const { return _size; }
+
+	const std::string& path() const { return _path; }
+
+	// 将修改写回文件，async 为 true 时只发起写回
+	void sync(bool async = true);
+
+private:
+	std::string _path;
+	int _fd;
+	uint8_t* _data;
+	size_t _size;
+};
+
+#endif // UTILS_MAPPED_FILE_H_
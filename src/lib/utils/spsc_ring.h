@@ -0,0 +1,91 @@
+#ifndef UTILS_SPSC_RING_H_
+#define UTILS_SPSC_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// 单生产者/单消费者无锁环形队列
+//
+// 生产者只写 _tail，消费者只写 _head，各自缓存对方的位置以减少跨核同步。
+// 容量向上取整为 2 的幂。
+template <typename T>
+class SpscRing
+{
+public:
+	explicit SpscRing(size_t capacity)
+	{
+		size_t size = 2;
+		while (size < capacity)
+			size <<= 1;
+
+		_slots.resize(size);
+		_mask = size - 1;
+	}
+
+	SpscRing(const SpscRing&) = delete;
+	SpscRing& operator=(const SpscRing&) = delete;
+
+	// 生产者调用，队列满时返回 false
+	bool tryPush(T&& value)
+	{
+		const size_t tail = _tail.load(std::memory_order_relaxed);
+
+		if (tail - _cachedHead > _mask)
+		{
+			_cachedHead = _head.load(std::memory_order_acquire);
+			if (tail - _cachedHead > _mask)
+				return false;
+		}
+
+		_slots[tail & _mask] = std::move(value);
+		_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// 消费者调用，队列空时返回 false
+	bool tryPop(T& value)
+	{
+		const size_t head = _head.load(std::memory_order_relaxed);
+
+		if (head == _cachedTail)
+		{
+			_cachedTail = _tail.load(std::memory_order_acquire);
+			if (head == _cachedTail)
+				return false;
+		}
+
+		T& slot = _slots[head & _mask];
+		value = std::move(slot);
+		slot = T(); // 尽早释放槽位持有的资源
+
+		_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// 近似值，任意线程可调用
+	size_t size() const
+	{
+		const size_t head = _head.load(std::memory_order_acquire);
+		const size_t tail = _tail.load(std::memory_order_acquire);
+		return tail - head;
+	}
+
+	bool empty() const { return size() == 0; }
+
+	size_t capacity() const { return _mask + 1; }
+
+private:
+	std::vector<T> _slots;
+	size_t _mask;
+
+	// 消费者
+	alignas(64) std::atomic<size_t> _head{ 0 };
+	size_t _cachedTail = 0;
+
+	// 生产者
+	alignas(64) std::atomic<size_t> _tail{ 0 };
+	size_t _cachedHead = 0;
+};
+
+#endif // UTILS_SPSC_RING_H_
@@ -0,0 +1,45 @@
+#include <utils/stream_buffer.h>
+
+#include <algorithm>
+#include <cstring>
+
+StreamBuffer::StreamBuffer(size_t capacity, BufferPool* pool) : _pool(pool), _head(0), _tail(0)
+{
+	_buffer = acquire(std::max<size_t>(capacity, 64));
+}
+
+uint8_t* StreamBuffer::prepare(size_t n)
+{
+	if (_buffer.capacity() - _tail >= n)
+		return _buffer.data() + _tail;
+
+	size_t used = size();
+	size_t capacity = _buffer.capacity();
+
+	// 单帧大于缓冲区时扩容
+	if (used + n > capacity)
+		capacity = std::max(capacity * 2, used + n);
+
+	if (capacity == _buffer.capacity() && _buffer.useCount() == 1)
+	{
+		// 尾部空间不足，将未消费数据搬回头部
+		std::memmove(_buffer.data(), _buffer.data() + _head, used);
+	}
+	else
+	{
+		// 已交出的帧仍引用当前缓冲区，换用新缓冲区
+		Buffer next = acquire(capacity);
+		std::memcpy(next.data(), _buffer.data() + _head, used);
+		_buffer = std::move(next);
+	}
+
+	_head = 0;
+	_tail = used;
+
+	return _buffer.data() + _tail;
+}
+
+Buffer StreamBuffer::acquire(size_t capacity)
+{
+	return _pool ? _pool->acquire(capacity) : Buffer::allocate(capacity);
+}
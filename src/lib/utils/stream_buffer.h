@@ -0,0 +1,60 @@
+#ifndef UTILS_STREAM_BUFFER_H_
+#define UTILS_STREAM_BUFFER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <utils/buffer_pool.h>
+
+// 字节流接收缓冲区
+//
+// 线性缓冲区，不回绕：recv 直接写入 prepare() 返回的尾部空间，帧以 data() 起始的
+// 连续内存交给上层，不做额外拷贝。数据全部消费后读写位置归零，尾部空间不足时把
+// 未消费的半帧搬回头部(压缩)，保证每一帧在内存中连续。
+//
+// 缓冲区来自 BufferPool 时，slice() 返回的帧持有缓冲区引用；此时若需要搬移，
+// 未消费的数据会复制到新缓冲区，已交出的帧不受影响。
+class StreamBuffer
+{
+public:
+	explicit StreamBuffer(size_t capacity = 4096, BufferPool* pool = nullptr);
+
+	// 返回至少 n 字节的可写空间
+	uint8_t* prepare(size_t n);
+
+	// 提交写入 prepare() 空间的 n 字节
+	void commit(size_t n) { _tail += n; }
+
+	// 丢弃头部 n 字节
+	void consume(size_t n)
+	{
+		_head += n;
+
+		// 帧仍被引用时不能复用头部空间
+		if (_head >= _tail && _buffer.useCount() == 1)
+			_head = _tail = 0;
+	}
+
+	void clear() { consume(size()); }
+
+	// 头部 n 字节的引用计数视图
+	BufferSlice slice(size_t n) const { return BufferSlice(_buffer, _head, n); }
+
+	const uint8_t* data() const { return _buffer.data() + _head; }
+
+	size_t size() const { return _tail - _head; }
+
+	bool empty() const { return _head == _tail; }
+
+	size_t capacity() const { return _buffer.capacity(); }
+
+private:
+	Buffer acquire(size_t capacity);
+
+	BufferPool* _pool;
+	Buffer _buffer;
+	size_t _head;
+	size_t _tail;
+};
+
+#endif // UTILS_STREAM_BUFFER_H_
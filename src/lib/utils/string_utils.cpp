@@ -0,0 +1,12 @@
+#include <utils/string_utils.h>
+
+#include <algorithm>
+#include <cctype>
+
+std::string toLower(std::string s)
+{
+	std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) {
+		return static_cast<char>(std::tolower(c));
+	});
+	return s;
+}
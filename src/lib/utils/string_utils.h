@@ -0,0 +1,9 @@
+#ifndef UTILS_STRING_UTILS_H_
+#define UTILS_STRING_UTILS_H_
+
+#include <string>
+
+// 转为小写(仅 ASCII)，设备地址、服务UUID等大小写不敏感的键统一用它归一化
+std::string toLower(std::string s);
+
+#endif // UTILS_STRING_UTILS_H_
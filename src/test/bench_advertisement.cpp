@@ -0,0 +1,201 @@
+// 广播风暴基准
+//
+// 模拟发现期间大量设备高频上报 RSSI/ManufacturerData/ServiceData，直接调用
+// Device::applyProperties 测量属性解码、合并限速和信标采集的单次开销，不经过 D-Bus 传输。
+// Device 代理须注册到一条总线上，优先使用会话总线，可在 dbus-run-session 下运行：
+//
+//   dbus-run-session -- ./bench_advertisement [设备数] [信号数]
+
+#include <bluetooth/advertisement_filter.h>
+#include <bluetooth/beacon_collector.h>
+#include <bluetooth/device.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+	using PropertyMap = std::map<sdbus::PropertyName, sdbus::Variant>;
+
+	std::string deviceAddress(int index)
+	{
+		char address[18];
+		std::snprintf(address,
+					  sizeof(address),
+					  "AA:BB:CC:DD:%02X:%02X",
+					  (index >> 8) & 0xFF,
+					  index & 0xFF);
+		return address;
+	}
+
+	PropertyMap initialProperties(int index)
+	{
+		PropertyMap properties;
+		properties[sdbus::PropertyName("Address")] = sdbus::Variant(deviceAddress(index));
+		properties[sdbus::PropertyName("AddressType")] = sdbus::Variant(std::string("random"));
+		properties[sdbus::PropertyName("Adapter")] =
+			sdbus::Variant(sdbus::ObjectPath("/org/bluez/hci0"));
+		std::string name = "sensor-" + std::to_string(index);
+
+		properties[sdbus::PropertyName("Name")] = sdbus::Variant(name);
+		properties[sdbus::PropertyName("Alias")] = sdbus::Variant(name);
+		properties[sdbus::PropertyName("Modalias")] =
+			sdbus::Variant(std::string("bluetooth:v004Cp0001d0001"));
+		properties[sdbus::PropertyName("RSSI")] = sdbus::Variant(static_cast<std::int16_t>(-60));
+		properties[sdbus::PropertyName("Paired")] = sdbus::Variant(false);
+		properties[sdbus::PropertyName("Connected")] = sdbus::Variant(false);
+		properties[sdbus::PropertyName("Trusted")] = sdbus::Variant(false);
+		return properties;
+	}
+
+	// 一轮风暴中的信号：大部分是 RSSI 抖动，部分带有变化的厂商数据或服务数据
+	std::vector<PropertyMap> stormSignals(size_t count)
+	{
+		std::vector<PropertyMap> signals;
+		signals.reserve(count);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			PropertyMap changed;
+			int jump = i % 50 == 0 ? 12 : 0;
+			auto rssi = static_cast<std::int16_t>(-63 + static_cast<int>(i % 7) + jump);
+			changed[sdbus::PropertyName("RSSI")] = sdbus::Variant(rssi);
+
+			if (i % 4 == 0)
+			{
+				// 每 16 条中负载只变化一次，其余为重复广播
+				std::vector<std::uint8_t> payload = {
+					0x02, 0x15, static_cast<std::uint8_t>(i / 16), 0x42
+				};
+				std::map<std::uint16_t, sdbus::Variant> manufacturer;
+				manufacturer[0x004C] = sdbus::Variant(payload);
+				changed[sdbus::PropertyName("ManufacturerData")] = sdbus::Variant(manufacturer);
+			}
+
+			if (i % 8 == 0)
+			{
+				std::vector<std::uint8_t> payload = { static_cast<std::uint8_t>(i / 32), 0x01 };
+				std::map<std::string, sdbus::Variant> service;
+				service["0000feaa-0000-1000-8000-00805f9b34fb"] = sdbus::Variant(payload);
+				changed[sdbus::PropertyName("ServiceData")] = sdbus::Variant(service);
+			}
+
+			signals.push_back(std::move(changed));
+		}
+
+		return signals;
+	}
+
+	std::unique_ptr<sdbus::IConnection> createConnection()
+	{
+		try
+		{
+			return sdbus::createSessionBusConnection();
+		}
+		catch (const sdbus::Error&)
+		{
+			return sdbus::createSystemBusConnection();
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int deviceCount = argc > 1 ? std::atoi(argv[1]) : 200;
+	long signalCount = argc > 2 ? std::atol(argv[2]) : 1000000;
+
+	if (deviceCount <= 0 || signalCount <= 0)
+	{
+		std::fprintf(stderr, "用法: %s [设备数] [信号数]\n", argv[0]);
+		return 1;
+	}
+
+	auto connection = createConnection();
+
+	AdvertisementFilter filter;
+	BeaconCollector beacons;
+	beacons.setEnabled(true);
+
+	std::vector<std::unique_ptr<Device>> devices;
+	devices.reserve(static_cast<size_t>(deviceCount));
+
+	for (int i = 0; i < deviceCount; ++i)
+	{
+		sdbus::ServiceName service("org.bluez");
+		sdbus::ObjectPath path("/org/bluez/hci0/dev_" + std::to_string(i));
+		devices.push_back(std::make_unique<Device>(
+			*connection, service, path, initialProperties(i), &filter, &beacons));
+	}
+
+	std::vector<PropertyMap> signals = stormSignals(4096);
+	std::vector<size_t> sequence(devices.size(), 0);
+	std::string body;
+	size_t published = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	auto lastFlush = start;
+
+	for (long i = 0; i < signalCount; ++i)
+	{
+		// 各设备按自己的顺序依次取风暴中的信号，重复负载才会连续出现在同一设备上
+		size_t index = static_cast<size_t>(i % deviceCount);
+		devices[index]->applyProperties(signals[sequence[index]++ % signals.size()]);
+
+		// 与主循环一样周期性地合并发布信标
+		if ((i & 0x3FF) == 0)
+		{
+			auto now = std::chrono::steady_clock::now();
+			if (now - lastFlush >= std::chrono::milliseconds(1000))
+			{
+				if (beacons.flush(body))
+					published += body.size();
+
+				lastFlush = now;
+			}
+		}
+	}
+
+	auto elapsed = std::chrono::steady_clock::now() - start;
+	double seconds = std::chrono::duration<double>(elapsed).count();
+
+	// 提交限速期间被合并的更新
+	size_t visible = 0;
+	auto now = AdvertisementFilter::Clock::now();
+	for (auto& device : devices)
+		visible += device->flushAdvertisement(now) ? 1 : 0;
+
+	if (beacons.flush(body))
+		published += body.size();
+
+	std::printf("设备数            %d\n", deviceCount);
+	std::printf("信号数            %ld\n", signalCount);
+	std::printf("耗时              %.3f s\n", seconds);
+	std::printf("吞吐              %.0f 信号/s\n", static_cast<double>(signalCount) / seconds);
+	std::printf("单次              %.1f ns\n", seconds * 1e9 / static_cast<double>(signalCount));
+	std::printf("信标负载          %llu 条, 重复 %llu 条\n",
+				static_cast<unsigned long long>(beacons.getReceivedCount()),
+				static_cast<unsigned long long>(beacons.getDuplicateCount()));
+	std::printf("信标消息字节      %zu\n", published);
+	std::printf("结束时待提交设备  %zu\n", visible);
+
+	// Modalias 解析
+	const long parseCount = 1000000;
+	size_t parsed = 0;
+
+	start = std::chrono::steady_clock::now();
+	for (long i = 0; i < parseCount; ++i)
+	{
+		const char* modalias = i & 1 ? "usb:v1D6Bp0246d0537" : "bluetooth:v004Cp0001d0001";
+		parsed += Device::parseModalias(modalias) ? 1 : 0;
+	}
+	seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::printf("Modalias 解析     %.1f ns/次 (%zu)\n",
+				seconds * 1e9 / static_cast<double>(parseCount),
+				parsed);
+	return 0;
+}
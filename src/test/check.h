@@ -0,0 +1,37 @@
+#ifndef TEST_CHECK_H_
+#define TEST_CHECK_H_
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+// 条件不成立时打印位置并使测试以非零状态退出
+#define CHECK(condition)                                                                           \
+	do                                                                                             \
+	{                                                                                              \
+		if (!(condition))                                                                          \
+		{                                                                                          \
+			std::fprintf(stderr, "%s:%d: 检查失败: %s\n", __FILE__, __LINE__, #condition);        \
+			return 1;                                                                              \
+		}                                                                                          \
+	} while (0)
+
+// 轮询等待异步条件成立，超时返回 false
+template <typename Predicate>
+bool waitFor(Predicate predicate,
+			 std::chrono::milliseconds timeout = std::chrono::milliseconds(3000))
+{
+	auto deadline = std::chrono::steady_clock::now() + timeout;
+
+	while (!predicate())
+	{
+		if (std::chrono::steady_clock::now() >= deadline)
+			return false;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+
+	return true;
+}
+
+#endif // TEST_CHECK_H_
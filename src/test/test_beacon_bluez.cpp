@@ -0,0 +1,204 @@
+// BLE 广播采集测试
+//
+// 在会话总线上以 org.bluez 名称运行一个模拟的 BlueZ(ObjectManager + Device1)，由
+// BluetoothManager 经 D-Bus 发现设备并接收 PropertiesChanged，验证 BeaconCollector 的
+// 去重、发布内容以及过期设备的移除。需要独立的会话总线，由 ctest 通过 dbus-run-session 启动：
+//
+//   dbus-run-session -- ./test_beacon_bluez
+
+#include "check.h"
+
+#include <bluetooth/bluetooth_manager.h>
+
+#include <json/json.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+	const sdbus::InterfaceName kDevice1("org.bluez.Device1");
+
+	// 模拟 BlueZ 导出的 Device1 对象，属性由测试修改后发出 PropertiesChanged
+	class MockDevice
+	{
+	public:
+		using ManufacturerData = std::map<std::uint16_t, sdbus::Variant>;
+		using ServiceData = std::map<std::string, sdbus::Variant>;
+
+		MockDevice(sdbus::IConnection& connection, const std::string& address)
+			: _address(address)
+		{
+			std::string path = "/org/bluez/hci0/dev_" + address;
+			for (auto& c : path)
+			{
+				if (c == ':')
+					c = '_';
+			}
+
+			_object = sdbus::createObject(connection, sdbus::ObjectPath(path));
+			_object
+				->addVTable(
+					sdbus::registerProperty("Address").withGetter([this]() { return _address; }),
+					sdbus::registerProperty("AddressType").withGetter([]() {
+						return std::string("random");
+					}),
+					sdbus::registerProperty("RSSI").withGetter([this]() {
+						std::lock_guard<std::mutex> lock(_mutex);
+						return _rssi;
+					}),
+					sdbus::registerProperty("ManufacturerData").withGetter([this]() {
+						std::lock_guard<std::mutex> lock(_mutex);
+						return _manufacturer;
+					}),
+					sdbus::registerProperty("ServiceData").withGetter([this]() {
+						std::lock_guard<std::mutex> lock(_mutex);
+						return _service;
+					}))
+				.forInterface(kDevice1);
+		}
+
+		void setManufacturerData(std::uint16_t company, std::vector<std::uint8_t> payload)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_manufacturer.clear();
+			_manufacturer[company] = sdbus::Variant(payload);
+		}
+
+		void setServiceData(const std::string& uuid, std::vector<std::uint8_t> payload)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_service.clear();
+			_service[uuid] = sdbus::Variant(payload);
+		}
+
+		void setRssi(std::int16_t rssi)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_rssi = rssi;
+		}
+
+		// 与 BlueZ 一样，一次扫描结果的变化合并到一个信号中
+		void advertise()
+		{
+			_object->emitPropertiesChangedSignal(kDevice1,
+												 { sdbus::PropertyName("ManufacturerData"),
+												   sdbus::PropertyName("RSSI") });
+		}
+
+		void announce() { _object->emitInterfacesAddedSignal(); }
+
+	private:
+		std::string _address;
+		std::unique_ptr<sdbus::IObject> _object;
+
+		std::mutex _mutex;
+		std::int16_t _rssi = -70;
+		ManufacturerData _manufacturer;
+		ServiceData _service;
+	};
+
+	// 在发布的消息中按地址查找设备
+	const Json::Value* findBeacon(const Json::Value& root, const std::string& address)
+	{
+		for (const auto& beacon : root["beacons"])
+		{
+			if (beacon["address"].asString() == address)
+				return &beacon;
+		}
+
+		return nullptr;
+	}
+
+	bool parseBody(const std::string& body, Json::Value& root)
+	{
+		Json::CharReaderBuilder builder;
+		std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+		std::string errors;
+		return reader->parse(body.data(), body.data() + body.size(), &root, &errors);
+	}
+}
+
+int main()
+{
+	const std::string addressA = "C0:00:00:00:00:0A";
+	const std::string addressB = "C0:00:00:00:00:0B";
+	const std::string eddystone = "0000feaa-0000-1000-8000-00805f9b34fb";
+
+	// 模拟的 BlueZ
+	auto bluez = sdbus::createSessionBusConnection(sdbus::ServiceName("org.bluez"));
+	auto root = sdbus::createObject(*bluez, sdbus::ObjectPath("/"));
+	root->addObjectManager();
+
+	auto deviceA = std::make_unique<MockDevice>(*bluez, addressA);
+	deviceA->setManufacturerData(0x004C, { 0x01, 0x02, 0x03 });
+	bluez->enterEventLoopAsync();
+
+	// 桥接程序一侧
+	auto connection = sdbus::createSessionBusConnection();
+	auto manager = std::make_unique<BluetoothManager>(*connection, *connection);
+	auto& beacons = manager->getBeaconCollector();
+	beacons.setEnabled(true);
+	connection->enterEventLoopAsync();
+
+	// 负载变化: 记录并待发布
+	auto received = beacons.getReceivedCount();
+	deviceA->setManufacturerData(0x004C, { 0x01, 0x02, 0x04 });
+	deviceA->setRssi(-55);
+	deviceA->advertise();
+	CHECK(waitFor([&]() { return beacons.getReceivedCount() > received; }));
+
+	// 相同负载: 计为重复
+	auto duplicates = beacons.getDuplicateCount();
+	deviceA->advertise();
+	CHECK(waitFor([&]() { return beacons.getDuplicateCount() > duplicates; }));
+
+	// 扫描中新出现的设备
+	auto deviceB = std::make_unique<MockDevice>(*bluez, addressB);
+	deviceB->setServiceData(eddystone, { 0x10, 0x20 });
+	deviceB->announce();
+	CHECK(waitFor([&]() { return beacons.getEntryCount() == 2; }));
+
+	std::string body;
+	CHECK(beacons.flush(body));
+
+	Json::Value message;
+	CHECK(parseBody(body, message));
+	CHECK(message["beacons"].size() == 2);
+
+	const Json::Value* beaconA = findBeacon(message, addressA);
+	CHECK(beaconA != nullptr);
+	CHECK((*beaconA)["rssi"].asInt() == -55);
+	CHECK((*beaconA)["m"]["76"].asString() == "AQIE");
+
+	const Json::Value* beaconB = findBeacon(message, addressB);
+	CHECK(beaconB != nullptr);
+	CHECK((*beaconB)["s"][eddystone].asString() == "ECA=");
+
+	// 没有新的变化时不发布
+	CHECK(!beacons.flush(body));
+
+	// 超过 ttl 未再广播的设备被移除，再次出现时按新设备发布
+	beacons.setTtl(std::chrono::milliseconds(100));
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	CHECK(!beacons.flush(body));
+	CHECK(beacons.getEntryCount() == 0);
+
+	deviceA->advertise();
+	CHECK(waitFor([&]() { return beacons.getEntryCount() == 1; }));
+	CHECK(beacons.flush(body));
+	CHECK(parseBody(body, message));
+	CHECK(message["beacons"].size() == 1);
+	CHECK(findBeacon(message, addressA) != nullptr);
+
+	connection->leaveEventLoop();
+	bluez->leaveEventLoop();
+	manager.reset();
+
+	std::printf("test_beacon_bluez 通过\n");
+	return 0;
+}
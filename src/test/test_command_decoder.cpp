@@ -0,0 +1,91 @@
+// 下行命令解码测试
+//
+// 验证 data 字段的 base64 解码：完整填充的内容(含 URL 安全字符集和 "\/" 转义)按原样解出；
+// 填充出现在末组之外、末组不足 4 个字符或填充过多时记录解码失败，但仍扫描完整条消息，
+// 取得其后的 publishId。另外验证只请求地址时跳过 data。
+
+#include "check.h"
+
+#include <mqtt/command_decoder.h>
+
+#include <string>
+
+namespace {
+
+	const std::string kBase64Error = "JSON解析错误: 数据Base64解码失败";
+
+	bool decode(const std::string& body,
+				CommandDecoder::Command& command,
+				uint32_t wanted = CommandDecoder::kAllFields)
+	{
+		CommandDecoder decoder;
+		std::string error;
+		return decoder.decode(reinterpret_cast<const uint8_t*>(body.data()),
+							  body.size(),
+							  "device",
+							  command,
+							  error,
+							  wanted);
+	}
+
+	std::string deviceBody(const std::string& data)
+	{
+		return R"({"device":{"address":"AA:BB:CC:DD:EE:03","data":")" + data +
+			   R"(","publishId":"p-1"}})";
+	}
+
+	std::string decodedData(const CommandDecoder::Command& command)
+	{
+		return std::string(reinterpret_cast<const char*>(command.data.data()), command.data.size());
+	}
+}
+
+int main()
+{
+	CommandDecoder::Command command;
+
+	// 有效内容
+	const std::pair<std::string, std::string> valid[] = {
+		{ "aGVsbG8=", "hello" },
+		{ "aGVsbA==", "hell" },
+		{ "aGVs", "hel" },
+		{ "aGVsbA..", "hell" },
+		{ "P_8=", "?\xff" },
+		{ "P\\/8=", "?\xff" },
+		{ "", "" },
+	};
+
+	for (const auto& [data, expected] : valid)
+	{
+		CHECK(decode(deviceBody(data), command));
+		CHECK(command.error.empty());
+		CHECK(command.has(CommandDecoder::kData));
+		CHECK(decodedData(command) == expected);
+	}
+
+	// 无效内容：填充在末组之外、末组不足 4 个字符、填充过多或位置不对
+	const std::string invalid[] = {
+		"aGVs/bG8=", "aGVsbA=", "aGVsbA", "aGVsb", "aG=sbA==",
+		"aGVsbA===", "aGVs====", "=aGV", "aGVsbA=x",
+	};
+
+	for (const auto& data : invalid)
+	{
+		CHECK(decode(deviceBody(data), command));
+		CHECK(!command.has(CommandDecoder::kData));
+		CHECK(command.error == kBase64Error);
+
+		// 解码失败后继续扫描，可用 publishId 回报错误
+		CHECK(command.has(CommandDecoder::kAddress | CommandDecoder::kPublishId));
+		CHECK(command.publishId == "p-1");
+	}
+
+	// 只请求地址时不解码 data，无效的 data 也不记录错误
+	CHECK(decode(deviceBody("aGVsbA="), command, CommandDecoder::kAddress));
+	CHECK(command.error.empty());
+	CHECK(command.fields == CommandDecoder::kAddress);
+	CHECK(command.address == "AA:BB:CC:DD:EE:03");
+
+	std::printf("test_command_decoder 通过\n");
+	return 0;
+}
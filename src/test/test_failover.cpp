@@ -0,0 +1,187 @@
+// 主备代理故障切换测试
+//
+// 启动两个 mosquitto，客户端按 [A, B] 顺序连接并与 B 保持备用连接。验证启动时由 A 承载
+// 发布和订阅，kill -9 A 后切换到 B 且消息仍能收发，A 重新启动后成为新的备用连接。
+// mosquitto 的路径由 ctest 作为第一个参数传入：
+//
+//   ./test_failover /usr/sbin/mosquitto
+
+#include "check.h"
+
+#include <mqtt/mqtt_client.h>
+
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace {
+
+	const std::string kTopic = "/org/booway/bluetooth/test/failover";
+
+	// 由内核分配一个空闲端口
+	int freePort()
+	{
+		int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+
+		sockaddr_in address{};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		socklen_t length = sizeof(address);
+		::bind(fd, reinterpret_cast<sockaddr*>(&address), length);
+		::getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+		::close(fd);
+
+		return ntohs(address.sin_port);
+	}
+
+	bool accepting(int port)
+	{
+		int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+
+		sockaddr_in address{};
+		address.sin_family = AF_INET;
+		address.sin_port = htons(static_cast<uint16_t>(port));
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		bool connected = ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+		::close(fd);
+		return connected;
+	}
+
+	// 在本地端口上运行的 mosquitto 进程
+	class Broker
+	{
+	public:
+		Broker(const std::string& program, int port) : _program(program), _port(port) {}
+
+		~Broker() { kill(); }
+
+		bool start()
+		{
+			_pid = ::fork();
+			if (_pid == 0)
+			{
+				std::string port = std::to_string(_port);
+				::execl(_program.c_str(), _program.c_str(), "-p", port.c_str(), static_cast<char*>(nullptr));
+				::_exit(127);
+			}
+
+			return _pid > 0 && waitFor([this]() { return accepting(_port); });
+		}
+
+		// 模拟代理崩溃，不发送 DISCONNECT
+		void kill()
+		{
+			if (_pid <= 0)
+				return;
+
+			::kill(_pid, SIGKILL);
+			::waitpid(_pid, nullptr, 0);
+			_pid = -1;
+		}
+
+		int port() const { return _port; }
+
+	private:
+		std::string _program;
+		int _port;
+		pid_t _pid = -1;
+	};
+
+	std::string endpointName(const Broker& broker)
+	{
+		return "127.0.0.1:" + std::to_string(broker.port());
+	}
+
+	// 在当前主连接上发布，直到经订阅收回一条
+	bool roundTrip(MqttClientImpl& client, std::atomic<int>& received)
+	{
+		received = 0;
+
+		return waitFor([&]() {
+			client.publishAsync(kTopic, std::vector<uint8_t>{ 'p', 'i', 'n', 'g' }, 1);
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			return received > 0;
+		});
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "用法: %s <mosquitto>\n", argv[0]);
+		return 1;
+	}
+
+	// 被 kill 的代理上的连接写入时不因 SIGPIPE 退出
+	::signal(SIGPIPE, SIG_IGN);
+
+	Broker primary(argv[1], freePort());
+	Broker backup(argv[1], freePort());
+	CHECK(primary.start());
+	CHECK(backup.start());
+
+	MqttClientImpl client("test-failover");
+
+	MqttClientImpl::ReconnectOptions reconnect;
+	reconnect.minDelay = std::chrono::milliseconds(100);
+	reconnect.maxDelay = std::chrono::milliseconds(500);
+	reconnect.connectTimeout = std::chrono::milliseconds(1000);
+	client.setReconnect(reconnect);
+
+	MqttClientImpl::FailoverOptions failover;
+	failover.warmStandby = true;
+	failover.probeInterval = std::chrono::milliseconds(200);
+	client.setFailover(failover);
+
+	std::atomic<int> received{ 0 };
+	client.setMessageCallback(kTopic, [&](const std::string&, const std::vector<uint8_t>&) { ++received; });
+	client.subscribeAsync(kTopic, 1);
+
+	CHECK(client.connect({ { "127.0.0.1", primary.port() }, { "127.0.0.1", backup.port() } }, 5));
+
+	// 启动时主连接在第一个地址上，备用连接不会抢先成为主连接
+	CHECK(waitFor([&]() { return client.getConnectionStats()["standby"].asBool(); }));
+
+	Json::Value stats = client.getConnectionStats();
+	CHECK(stats["connected"].asBool());
+	CHECK(stats["endpoint"].asString() == endpointName(primary));
+	CHECK(stats["failovers"].asUInt64() == 0);
+	CHECK(roundTrip(client, received));
+
+	// 主代理崩溃: 切换到备用连接并重新订阅
+	primary.kill();
+	CHECK(waitFor(
+		[&]() {
+			Json::Value current = client.getConnectionStats();
+			return current["connected"].asBool() && current["failovers"].asUInt64() == 1;
+		},
+		std::chrono::milliseconds(10000)));
+
+	stats = client.getConnectionStats();
+	CHECK(stats["endpoint"].asString() == endpointName(backup));
+	CHECK(roundTrip(client, received));
+
+	// 原主代理恢复后成为备用连接，不切回
+	CHECK(primary.start());
+	CHECK(waitFor([&]() { return client.getConnectionStats()["standby"].asBool(); },
+				  std::chrono::milliseconds(10000)));
+
+	stats = client.getConnectionStats();
+	CHECK(stats["endpoint"].asString() == endpointName(backup));
+	CHECK(stats["failovers"].asUInt64() == 1);
+
+	client.disconnect();
+
+	std::printf("test_failover 通过 (切换耗时 %llums)\n",
+				static_cast<unsigned long long>(stats["lastReconnectMs"].asUInt64()));
+	return 0;
+}
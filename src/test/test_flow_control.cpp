@@ -0,0 +1,186 @@
+// 上行信用流控测试
+//
+// 多个读线程按设备交出帧，发布线程异步归还信用，同时反复断开/恢复 MQTT 连接，
+// 验证未确认帧数从不超过高水位、全部归还后计数归零，以及会话关闭移除记录时
+// 等待中的读线程立即返回。多线程行为建议在 ThreadSanitizer 下运行：
+//
+//   cmake -DCMAKE_BUILD_TYPE=Debug -DENABLE_TSAN=ON ...
+
+#include "check.h"
+
+#include <mqtt/flow_control.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+	constexpr int kHighWatermark = 8;
+	constexpr int kLowWatermark = 2;
+	constexpr int kDevices = 4;
+	constexpr int kFrames = 20000;
+
+	// 模拟 mosquitto 的发布队列，on_publish 在另一个线程中归还信用
+	class Publisher
+	{
+	public:
+		explicit Publisher(FlowControl& flow) : _flow(flow) {}
+
+		void push(int device)
+		{
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_queue.push_back(device);
+			}
+
+			_cv.notify_one();
+		}
+
+		void run(std::vector<std::atomic<int>>& outstanding, const std::atomic<bool>& done)
+		{
+			size_t published = 0;
+
+			while (true)
+			{
+				int device;
+
+				{
+					std::unique_lock<std::mutex> lock(_mutex);
+					_cv.wait_for(lock, std::chrono::milliseconds(10), [this]() {
+						return !_queue.empty();
+					});
+
+					if (_queue.empty())
+					{
+						if (done)
+							return;
+
+						continue;
+					}
+
+					device = _queue.front();
+					_queue.pop_front();
+				}
+
+				// 偶尔让出，使读线程碰到高水位
+				if (++published % 64 == 0)
+					std::this_thread::sleep_for(std::chrono::microseconds(200));
+
+				--outstanding[device];
+				_flow.release("dev-" + std::to_string(device));
+			}
+		}
+
+	private:
+		FlowControl& _flow;
+		std::mutex _mutex;
+		std::condition_variable _cv;
+		std::deque<int> _queue;
+	};
+}
+
+int main()
+{
+	FlowControl flow;
+	FlowControl::Options options;
+	options.highWatermark = kHighWatermark;
+	options.lowWatermark = kLowWatermark;
+	options.pauseWhenDisconnected = true;
+	flow.setOptions(options);
+	flow.setConnected(true);
+
+	std::vector<std::atomic<int>> outstanding(kDevices);
+	std::atomic<int> maxOutstanding{ 0 };
+	std::atomic<bool> readersDone{ false };
+	Publisher publisher(flow);
+
+	std::thread publishThread([&]() { publisher.run(outstanding, readersDone); });
+
+	// 周期性断开/恢复代理连接
+	std::thread brokerThread([&]() {
+		while (!readersDone)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(3));
+			flow.setConnected(false);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			flow.setConnected(true);
+		}
+	});
+
+	std::vector<std::thread> readers;
+	for (int device = 0; device < kDevices; ++device)
+	{
+		readers.emplace_back([&, device]() {
+			std::string address = "dev-" + std::to_string(device);
+
+			for (int i = 0; i < kFrames; ++i)
+			{
+				while (!flow.waitReadable(address, std::chrono::milliseconds(100)))
+				{
+				}
+
+				flow.acquire(address);
+
+				int current = ++outstanding[device];
+				int seen = maxOutstanding;
+				while (current > seen && !maxOutstanding.compare_exchange_weak(seen, current))
+				{
+				}
+
+				publisher.push(device);
+			}
+		});
+	}
+
+	for (auto& reader : readers)
+		reader.join();
+
+	readersDone = true;
+	brokerThread.join();
+	publishThread.join();
+
+	CHECK(maxOutstanding <= kHighWatermark);
+
+	flow.setConnected(true);
+	Json::Value stats = flow.getStats();
+	for (int device = 0; device < kDevices; ++device)
+	{
+		CHECK(outstanding[device] == 0);
+		CHECK(stats["devices"]["dev-" + std::to_string(device)]["outstanding"].asInt() == 0);
+	}
+
+	// 会话关闭: 停在高水位的读线程被唤醒，记录被移除
+	const std::string closed = "dev-closed";
+	for (int i = 0; i < kHighWatermark; ++i)
+		flow.acquire(closed);
+
+	std::atomic<bool> woke{ false };
+	auto start = std::chrono::steady_clock::now();
+	std::thread waiter([&]() { woke = flow.waitReadable(closed, std::chrono::seconds(5)); });
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	flow.remove(closed);
+	waiter.join();
+
+	CHECK(woke);
+	CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(2));
+	CHECK(!flow.getStats()["devices"].isMember(closed));
+
+	// 移除后迟到的确认不会重新建立记录
+	flow.release(closed, kHighWatermark);
+	CHECK(!flow.getStats()["devices"].isMember(closed));
+
+	for (int device = 0; device < kDevices; ++device)
+		flow.remove("dev-" + std::to_string(device));
+
+	CHECK(flow.getStats()["devices"].empty());
+
+	std::printf("test_flow_control 通过 (最大未确认帧 %d)\n", maxOutstanding.load());
+	return 0;
+}
@@ -0,0 +1,139 @@
+// 分片传输乱序到达测试
+//
+// 经 MqttProxy::transfer 同时处理同一传输的分片 N、分片 N+1 和提交，验证无论三者以何种
+// 顺序执行，先到的后续分片都暂存到前面的分片到达，提交在全部接收后生效，不会报告
+// "分片不连续"或"传输未完整接收"。MqttProxy 需要 BluetoothManager，在 dbus-run-session
+// 启动的会话总线上模拟一个空的 BlueZ：
+//
+//   dbus-run-session -- ./test_transfer_order
+
+#include "check.h"
+
+#include <mqtt/mqtt_proxy.h>
+#include <utils/base64.h>
+
+#include <json/json.h>
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+	const std::string kImage = "0123456789abcdefghijklmnopqrstuvwxyz";
+	const size_t kSplit = 16;
+	const int kRounds = 32;
+
+	// 公开 transfer，直接调用命令处理函数
+	class TestProxy : public MqttProxy
+	{
+	public:
+		using MqttProxy::MqttProxy;
+		using MqttProxy::transfer;
+	};
+
+	std::vector<uint8_t> command(const Json::Value& transfer)
+	{
+		Json::Value root;
+		root["transfer"] = transfer;
+
+		std::string body = root.toStyledString();
+		return std::vector<uint8_t>(body.begin(), body.end());
+	}
+
+	std::vector<uint8_t> chunkCommand(const std::string& id, size_t offset, const std::string& data)
+	{
+		Json::Value transfer;
+		transfer["transferId"] = id;
+		transfer["offset"] = static_cast<Json::UInt64>(offset);
+		transfer["data"] = base64_encode(data);
+		return command(transfer);
+	}
+
+	// 同一设备同时只能有一个传输，每轮使用不同的设备
+	std::string deviceAddress(int round)
+	{
+		char address[18];
+		std::snprintf(address, sizeof(address), "AA:BB:CC:DD:EE:%02X", round);
+		return address;
+	}
+
+	std::string topic(const std::string& action)
+	{
+		return "/org/booway/bluetooth/" + action;
+	}
+}
+
+int main()
+{
+	// 模拟的 BlueZ，没有任何设备
+	auto bluez = sdbus::createSessionBusConnection(sdbus::ServiceName("org.bluez"));
+	auto root = sdbus::createObject(*bluez, sdbus::ObjectPath("/"));
+	root->addObjectManager();
+	bluez->enterEventLoopAsync();
+
+	auto connection = sdbus::createSessionBusConnection();
+	BluetoothManager manager(*connection, *connection);
+	connection->enterEventLoopAsync();
+
+	BluetoothServer server;
+
+	// 代理不可达，客户端在后台重试，不影响直接调用命令处理函数。设备未连接，须保留未确认
+	// 的数据，否则发送线程回退已接收的偏移
+	JsonConfig config("");
+	config.getRoot()["mqtt"]["host"] = "127.0.0.1";
+	config.getRoot()["mqtt"]["port"] = 1;
+	config.getRoot()["mqtt"]["transfer"]["ack_required"] = true;
+	config.getRoot()["mqtt"]["transfer"]["max_transfers"] = kRounds;
+
+	TestProxy proxy(manager, server, config);
+	CHECK(proxy.setup());
+
+	for (int round = 0; round < kRounds; ++round)
+	{
+		std::string id = "order-" + std::to_string(round);
+
+		Json::Value begin;
+		begin["transferId"] = id;
+		begin["address"] = deviceAddress(round);
+		begin["size"] = static_cast<Json::UInt64>(kImage.size());
+		proxy.transfer(topic("transferBegin"), command(begin));
+
+		Json::Value commit;
+		commit["transferId"] = id;
+
+		std::vector<std::pair<std::string, std::vector<uint8_t>>> messages = {
+			{ topic("transferChunk"), chunkCommand(id, 0, kImage.substr(0, kSplit)) },
+			{ topic("transferChunk"), chunkCommand(id, kSplit, kImage.substr(kSplit)) },
+			{ topic("transferCommit"), command(commit) },
+		};
+
+		// 三条消息同时开始处理
+		std::atomic<bool> go{ false };
+		std::vector<std::thread> threads;
+
+		for (const auto& [name, payload] : messages)
+		{
+			threads.emplace_back([&, name = name, payload = payload]() {
+				while (!go)
+					std::this_thread::yield();
+
+				proxy.transfer(name, payload);
+			});
+		}
+
+		go = true;
+		for (auto& thread : threads)
+			thread.join();
+
+		Json::Value transfer = proxy.getStats()["transfer"]["transfers"][id];
+		CHECK(transfer["received"].asUInt64() == kImage.size());
+		CHECK(transfer["state"].asString() == "committed");
+	}
+
+	std::printf("test_transfer_order 通过 (%d 轮)\n", kRounds);
+	return 0;
+}
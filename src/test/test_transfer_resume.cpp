@@ -0,0 +1,166 @@
+// 分片传输断线续传测试
+//
+// 用 socketpair 上的会话代替设备连接，写出部分数据并确认一部分后断开，验证传输回退到
+// 设备确认的偏移：ackRequired 时从缓冲区重新写出，否则回退 received 由上位机重新发送。
+// 两种方式下设备最终收到的数据都与镜像一致，且只在全部确认(或写出)后完成。
+
+#include "check.h"
+
+#include <mqtt/transfer_manager.h>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace {
+
+	const std::string kAddress = "AA:BB:CC:DD:EE:01";
+
+	// 模拟的设备连接，对端读取桥接写出的数据
+	class DeviceLink
+	{
+	public:
+		~DeviceLink() { disconnect(); }
+
+		void connect()
+		{
+			::socketpair(AF_UNIX, SOCK_STREAM, 0, _fds);
+
+			std::lock_guard<std::mutex> lock(_mutex);
+			_session = std::make_shared<Session>(
+				kAddress, Session::Role::Inbound, _fds[0], DownlinkWriter::Options(), nullptr);
+		}
+
+		// 断开时丢弃对端未读取的数据，与 RFCOMM 断线时一样
+		void disconnect()
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			if (!_session)
+				return;
+
+			_session->close();
+			_session.reset();
+			::close(_fds[0]);
+			::close(_fds[1]);
+		}
+
+		std::shared_ptr<Session> find(const std::string&)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _session;
+		}
+
+		// 读取到 size 字节或超时
+		std::string read(size_t size)
+		{
+			std::string data;
+			char buffer[4096];
+
+			while (data.size() < size)
+			{
+				pollfd pfd{ _fds[1], POLLIN, 0 };
+				if (::poll(&pfd, 1, 2000) <= 0)
+					break;
+
+				ssize_t n = ::read(_fds[1], buffer, sizeof(buffer));
+				if (n <= 0)
+					break;
+
+				data.append(buffer, static_cast<size_t>(n));
+			}
+
+			return data;
+		}
+
+	private:
+		std::mutex _mutex;
+		std::shared_ptr<Session> _session;
+		int _fds[2] = { -1, -1 };
+	};
+
+	std::string makeImage(size_t size)
+	{
+		std::string image(size, '\0');
+		for (size_t i = 0; i < size; ++i)
+			image[i] = static_cast<char>('a' + i % 26);
+		return image;
+	}
+
+	Json::Value transferStats(const TransferManager& transfers, const std::string& id)
+	{
+		return transfers.getStats()["transfers"][id];
+	}
+
+	int runResume(bool ackRequired)
+	{
+		const std::string id = ackRequired ? "fw-ack" : "fw-resend";
+		const std::string image = makeImage(1000);
+		std::string error;
+
+		DeviceLink link;
+		link.connect();
+
+		TransferManager::Options options;
+		options.ackRequired = ackRequired;
+		options.writeBytes = 100;
+		options.windowBytes = 4096;
+
+		TransferManager transfers(
+			options,
+			[&link](const std::string& address) { return link.find(address); },
+			nullptr);
+
+		CHECK(transfers.begin(id, kAddress, image.size(), error));
+		CHECK(transfers.chunk(id, 0, image.substr(0, 600), error));
+		CHECK(link.read(600) == image.substr(0, 600));
+
+		// 设备只确认了前 300 字节，其余数据随断线丢失
+		CHECK(transfers.ack(id, 300, error));
+		link.disconnect();
+
+		CHECK(waitFor([&]() { return transferStats(transfers, id)["paused"].asBool(); }));
+
+		Json::Value stats = transferStats(transfers, id);
+		CHECK(stats["acked"].asUInt64() == 300);
+		CHECK(stats["written"].asUInt64() == 300);
+		CHECK(stats["received"].asUInt64() == (ackRequired ? 600 : 300));
+
+		link.connect();
+		transfers.resume(kAddress);
+
+		// 上位机按 received 继续发送
+		uint64_t from = stats["received"].asUInt64();
+		CHECK(transfers.chunk(id, from, image.substr(from), error));
+		CHECK(transfers.commit(id, error));
+		CHECK(link.read(700) == image.substr(300));
+
+		if (ackRequired)
+		{
+			// 全部确认前不完成
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			CHECK(transfers.getStats()["active"].asUInt64() == 1);
+			CHECK(!transfers.ack(id, image.size() + 1, error));
+			CHECK(transfers.ack(id, image.size(), error));
+		}
+
+		CHECK(waitFor([&]() { return transfers.getStats()["completed"].asUInt64() == 1; }));
+		return 0;
+	}
+}
+
+int main()
+{
+	if (runResume(true) != 0)
+		return 1;
+
+	if (runResume(false) != 0)
+		return 1;
+
+	std::printf("test_transfer_resume 通过\n");
+	return 0;
+}